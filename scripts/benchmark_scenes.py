@@ -0,0 +1,183 @@
+#! /usr/bin/env python3
+
+# renders scenes with each acceleration structure and thread count, and saves
+# the timings, rays per second and peak memory usage of every run. this script
+# should be run from the base directory of project after building it:
+#
+# $ ./scripts/benchmark_scenes.py --app build/PathTracerApp
+#
+# a report can be saved as a baseline and later runs compared against it:
+#
+# $ ./scripts/benchmark_scenes.py --save-baseline build/baseline.json
+# $ ./scripts/benchmark_scenes.py --baseline build/baseline.json
+#
+# the comparison fails with a non-zero exit code if a time or the memory usage
+# grows, or the number of rays per second drops, by more than the tolerance
+
+import argparse
+import csv
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+STRUCTURES = ["bf", "bb", "bvh", "bvh-sah", "sbvh", "lbvh", "kd", "auto"]
+
+# metrics of a run, and whether a larger value is better
+METRICS = {
+    "parseMs": False,
+    "buildMs": False,
+    "traceMs": False,
+    "encodeMs": False,
+    "peakRssKb": False,
+    "primaryRaysPerSecond": True,
+    "secondaryRaysPerSecond": True,
+    "shadowRaysPerSecond": True,
+}
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(
+        description="Render scenes with every acceleration structure and "
+        "compare the timings with a baseline.")
+    parser.add_argument("--app", default="build/PathTracerApp",
+                        help="path tracer executable")
+    parser.add_argument("--scenes", nargs="+",
+                        default=sorted(glob.glob("scenes/**/*.xml",
+                                                 recursive=True)),
+                        help="scene files, default is every scene in scenes/")
+    parser.add_argument("--structures", nargs="+", default=STRUCTURES,
+                        choices=STRUCTURES, help="acceleration structures")
+    parser.add_argument("--threads", nargs="+", type=int, default=[0],
+                        help="thread counts, 0 uses all cores")
+    parser.add_argument("--repeat", type=int, default=1,
+                        help="renders per run, the fastest one is kept")
+    parser.add_argument("--json", default="build/benchmark_scenes.json",
+                        help="JSON file to write the results in")
+    parser.add_argument("--csv", default="build/benchmark_scenes.csv",
+                        help="CSV file to write the results in")
+    parser.add_argument("--baseline",
+                        help="JSON results of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="allowed relative regression, default is 0.1")
+    parser.add_argument("--save-baseline", metavar="FILE",
+                        help="also write the results to FILE as a baseline")
+    return parser.parse_args()
+
+
+def render(app, scene, structure, threads, output_directory):
+    """Renders a scene and returns the report written by the path tracer"""
+    report_file = os.path.join(output_directory, "report.json")
+    command = [app, "-a", structure, "-j", str(threads),
+               "-o", output_directory + "/", "--report", report_file, scene]
+    result = subprocess.run(command, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError("{} failed:\n{}".format(" ".join(command),
+                                                   result.stdout))
+    with open(report_file) as file:
+        return json.load(file)
+
+
+def summarize(report):
+    """Sums the timings and ray counts of all cameras of a report"""
+    scene = report["scenes"][0]
+    cameras = scene["cameras"]
+    trace_ms = sum(camera["traceMs"] for camera in cameras)
+    run = {
+        "parseMs": scene["parseMs"],
+        "buildMs": scene["buildMs"],
+        "traceMs": trace_ms,
+        "encodeMs": sum(camera["encodeMs"] for camera in cameras),
+        "peakRssKb": report["peakRssKb"],
+    }
+    for kind in ["primary", "secondary", "shadow"]:
+        rays = sum(camera[kind + "Rays"] for camera in cameras)
+        run[kind + "Rays"] = rays
+        run[kind + "RaysPerSecond"] = rays * 1000 / trace_ms if trace_ms else 0
+    return run
+
+
+def fastest(runs):
+    """Keeps the best value of each metric among repeated runs"""
+    best = dict(runs[0])
+    for run in runs[1:]:
+        for metric, larger_is_better in METRICS.items():
+            pick = max if larger_is_better else min
+            best[metric] = pick(best[metric], run[metric])
+    return best
+
+
+def run_key(run):
+    return (run["scene"], run["structure"], run["threads"])
+
+
+def compare(results, baseline, tolerance):
+    """Prints the metrics that got worse than the baseline, returns their
+    count"""
+    baseline_runs = {run_key(run): run for run in baseline}
+    regressions = 0
+    for run in results:
+        old = baseline_runs.get(run_key(run))
+        if old is None:
+            continue
+        for metric, larger_is_better in METRICS.items():
+            before, after = old[metric], run[metric]
+            if before <= 0:
+                continue
+            change = (after - before) / before
+            if larger_is_better:
+                change = -change
+            if change > tolerance:
+                regressions += 1
+                print("REGRESSION {} -a {} -j {}: {} {:.6g} -> {:.6g} "
+                      "({:+.1f}%)".format(*run_key(run), metric, before,
+                                          after, 100 * (after - before) /
+                                          before))
+    return regressions
+
+
+def main():
+    args = parse_arguments()
+    results = []
+    with tempfile.TemporaryDirectory() as output_directory:
+        for scene in args.scenes:
+            for structure in args.structures:
+                for threads in args.threads:
+                    runs = [summarize(render(args.app, scene, structure,
+                                             threads, output_directory))
+                            for _ in range(args.repeat)]
+                    run = {"scene": scene, "structure": structure,
+                           "threads": threads}
+                    run.update(fastest(runs))
+                    results.append(run)
+                    print("{} -a {} -j {}: trace {:.1f} ms, build {:.1f} ms, "
+                          "{:.0f} KB".format(scene, structure, threads,
+                                             run["traceMs"], run["buildMs"],
+                                             run["peakRssKb"]))
+
+    for file_name in filter(None, [args.json, args.save_baseline]):
+        with open(file_name, "w") as file:
+            json.dump(results, file, indent=2)
+    if args.csv and results:
+        with open(args.csv, "w", newline="") as file:
+            writer = csv.DictWriter(file, fieldnames=list(results[0]))
+            writer.writeheader()
+            writer.writerows(results)
+
+    if args.baseline:
+        with open(args.baseline) as file:
+            baseline = json.load(file)
+        regressions = compare(results, baseline, args.tolerance)
+        if regressions:
+            print("{} metrics regressed by more than {:.0f}%".format(
+                regressions, 100 * args.tolerance))
+            return 1
+        print("No regressions compared to " + args.baseline)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
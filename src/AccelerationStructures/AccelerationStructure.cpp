@@ -0,0 +1,107 @@
+#include "AccelerationStructure.hpp"
+
+namespace AccelerationStructures {
+void
+AccelerationStructure::build(
+  std::shared_ptr<const Objects::MeshGeometry> meshGeometry)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    geometry = std::move(meshGeometry);
+    buildOrLoad();
+    buildTime = std::chrono::steady_clock::now() - startTime;
+}
+
+AccelerationStructure::UpdateType
+AccelerationStructure::update(
+  std::shared_ptr<const Objects::MeshGeometry> meshGeometry)
+{
+    if (geometry && geometry == meshGeometry)
+        return UpdateType::Built;
+
+    auto startTime = std::chrono::steady_clock::now();
+    bool sameTopology = geometry && geometry->hasSameTopology(*meshGeometry);
+    geometry = std::move(meshGeometry);
+    UpdateType type;
+    if (sameTopology && refitStructure())
+        type = UpdateType::Refit;
+    else
+        type = buildOrLoad() ? UpdateType::Loaded : UpdateType::Built;
+    buildTime = std::chrono::steady_clock::now() - startTime;
+    return type;
+}
+
+void
+AccelerationStructure::setCache(
+  std::shared_ptr<const AccelerationStructureCache> structureCache)
+{
+    cache = std::move(structureCache);
+}
+
+void
+AccelerationStructure::build(std::vector<Objects::Triangle>&& triangles)
+{
+    auto meshGeometry =
+      std::make_shared<const Objects::MeshGeometry>(triangles);
+    triangles.clear();
+    triangles.shrink_to_fit();
+    build(std::move(meshGeometry));
+}
+
+AccelerationStructureStats
+AccelerationStructure::getStats() const
+{
+    AccelerationStructureStats stats;
+    stats.triangleCount = geometry ? geometry->getTriangleCount() : 0;
+    stats.memoryUsage = getMemoryUsage();
+    stats.buildMs =
+      std::chrono::duration<double, std::milli>(buildTime).count();
+    collectStats(stats);
+    return stats;
+}
+
+bool
+AccelerationStructure::refitStructure()
+{
+    return false;
+}
+
+void
+AccelerationStructure::collectStats(AccelerationStructureStats& stats) const
+{
+    // without a hierarchy, every ray is tested with every triangle
+    stats.addLeaf(0, 1, stats.triangleCount);
+}
+
+std::uint64_t
+AccelerationStructure::getCacheSettingsHash() const
+{
+    return 0;
+}
+
+std::vector<CacheSection>
+AccelerationStructure::getCacheSections() const
+{
+    return {};
+}
+
+bool
+AccelerationStructure::loadCacheSections(const std::vector<CacheSection>&,
+                                         std::shared_ptr<const MappedFile>)
+{
+    return false;
+}
+
+bool
+AccelerationStructure::buildOrLoad()
+{
+    if (cache && cache->load(*this))
+        return true;
+
+    buildStructure();
+    // the structure doesn't refer to the old file anymore
+    cacheFile.reset();
+    if (cache)
+        cache->save(*this);
+    return false;
+}
+}
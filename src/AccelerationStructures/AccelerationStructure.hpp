@@ -11,9 +11,16 @@
 
 #pragma once
 
+#include "AccelerationStructureCache.hpp"
+#include "AccelerationStructureStats.hpp"
+#include "MeshGeometry.hpp"
 #include "Ray.hpp"
 #include "Triangle.hpp"
 #include "Vector.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace AccelerationStructures {
@@ -24,10 +31,26 @@ namespace AccelerationStructures {
  * provide fast intersection tests compared to checking for intersection one by
  * one
  *
+ * Triangles are kept in a MeshGeometry that is shared with the mesh. The
+ * structures refer to them by primitive ID.
+ *
  */
 class AccelerationStructure
 {
 public:
+    /**
+     * @brief How update() prepared the structure
+     *
+     */
+    enum class UpdateType
+    {
+        Built,
+        Refit,
+        Loaded
+    };
+
+    virtual ~AccelerationStructure() = default;
+
     /**
      * @brief Finds the closest intersection in front of the ray
      *
@@ -44,13 +67,178 @@ public:
     virtual FloatT intersect(const Objects::Ray& ray,
                              LinearAlgebra::Vec3& normalOut) const = 0;
 
+    /**
+     * @brief Checks if any triangle is hit in front of the ray before tMax
+     *
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
+     */
+    virtual bool occluded(const Objects::Ray& ray, FloatT tMax) const = 0;
+
+    /**
+     * @brief Builds the acceleration structure for the triangles of a mesh
+     *
+     * If a cache is set and has the structure for these triangles, it is
+     * loaded from the cache instead.
+     *
+     * @param meshGeometry Triangles in this acceleration structure
+     */
+    void build(std::shared_ptr<const Objects::MeshGeometry> meshGeometry);
+
+    /**
+     * @brief Updates the structure for new vertex positions
+     *
+     * If the structure was built for a geometry with the same topology, i.e.
+     * only the vertices moved, it is refit if the structure supports it.
+     * Otherwise it is loaded from the cache or built from scratch, like
+     * build(). If it was already built for the same geometry object, e.g. for
+     * the trial rays of AccelerationStructureSelector, it is kept as it is.
+     *
+     * @param meshGeometry Triangles in this acceleration structure
+     * @return UpdateType How the structure was prepared, Built if it was kept
+     */
+    UpdateType update(
+      std::shared_ptr<const Objects::MeshGeometry> meshGeometry);
+
+    /**
+     * @brief Sets the cache to load built structures from and save them to
+     *
+     * @param structureCache May be null to disable caching
+     */
+    void setCache(
+      std::shared_ptr<const AccelerationStructureCache> structureCache);
+
     /**
      * @brief Builds the acceleration structure from a vector of triangles
      *
+     * Creates a MeshGeometry with the triangles, mostly for tests.
+     *
      * @param triangles Triangles in this acceleration structure. The vector
      * will be destroyed by this function. Use std::move to convert vector to
      * an rvalue.
      */
-    virtual void build(std::vector<Objects::Triangle>&& triangles) = 0;
+    void build(std::vector<Objects::Triangle>&& triangles);
+
+    /**
+     * @brief Memory allocated by this structure
+     *
+     * The MeshGeometry is not included, since it is shared with the mesh.
+     *
+     * @return std::size_t Size in bytes
+     */
+    virtual std::size_t getMemoryUsage() const = 0;
+
+    /**
+     * @brief Describes the shape, cost and size of the structure
+     *
+     * @return AccelerationStructureStats
+     */
+    AccelerationStructureStats getStats() const;
+
+protected:
+    /**
+     * @brief Builds the structure for the triangles in geometry
+     *
+     * Called by build() after geometry is set.
+     *
+     */
+    virtual void buildStructure() = 0;
+
+    /**
+     * @brief Adapts the structure to the new vertex positions in geometry
+     *
+     * Called by update() if only the vertex positions have changed since the
+     * last build. The default implementation does nothing and returns false.
+     *
+     * @return true The structure is refit and ready to use
+     * @return false The structure should be built from scratch
+     */
+    virtual bool refitStructure();
+
+    /**
+     * @brief Hash of the type and build settings of the structure
+     *
+     * Structures with the same hash built for the same triangles must be
+     * identical. The default implementation returns 0, which means the
+     * structure can't be cached.
+     *
+     * @return std::uint64_t
+     */
+    virtual std::uint64_t getCacheSettingsHash() const;
+
+    /**
+     * @brief Arrays that make up the built structure, to be saved in a cache
+     * file
+     *
+     * @return std::vector<CacheSection> Arrays in the same order that
+     * loadCacheSections() expects
+     */
+    virtual std::vector<CacheSection> getCacheSections() const;
+
+    /**
+     * @brief Uses arrays from a cache file as the structure
+     *
+     * The arrays are used in place, so they must stay valid while the
+     * structure is used. The default implementation returns false.
+     *
+     * @param sections Arrays returned by getCacheSections() when the structure
+     * was saved, for the same geometry
+     * @param file File that contains the arrays, to be kept open
+     * @return true The structure is ready to use
+     * @return false The sections are not valid, the structure should be built
+     */
+    virtual bool loadCacheSections(const std::vector<CacheSection>& sections,
+                                   std::shared_ptr<const MappedFile> file);
+
+    /**
+     * @brief Loads the structure from cache if possible, builds it otherwise
+     *
+     * Built structures are saved to the cache.
+     *
+     * @return true Structure was loaded from the cache
+     * @return false Structure was built
+     */
+    bool buildOrLoad();
+
+    /**
+     * @brief Adds the nodes of the structure to stats
+     *
+     * The default implementation adds a single leaf with all triangles.
+     *
+     * @param stats
+     */
+    virtual void collectStats(AccelerationStructureStats& stats) const;
+
+    /**
+     * @brief Triangles in this structure
+     *
+     */
+    std::shared_ptr<const Objects::MeshGeometry> geometry;
+
+    /**
+     * @brief Cache to load built structures from, may be null
+     *
+     */
+    std::shared_ptr<const AccelerationStructureCache> cache;
+
+    /**
+     * @brief Memory mapped cache file the structure was loaded from. Null if
+     * the structure was built.
+     *
+     */
+    std::shared_ptr<const MappedFile> cacheFile;
+
+    /**
+     * @brief Time taken by the last build() or update()
+     *
+     */
+    std::chrono::steady_clock::duration buildTime{};
+
+    friend class AccelerationStructureCache;
 };
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "AccelerationStructureCache.hpp"
+#include "AccelerationStructure.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include "TriangleBlock.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace AccelerationStructures {
+namespace {
+constexpr char CACHE_MAGIC[8] = "PTACCEL";
+
+// increase when the layout of the file or of any section changes
+constexpr std::uint32_t CACHE_VERSION = 1;
+
+// sections start at multiples of this, enough for any SIMD load
+constexpr std::size_t CACHE_ALIGNMENT = 64;
+constexpr int CACHE_MAX_SECTIONS = 8;
+
+/**
+ * @brief Start of a cache file
+ *
+ */
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sectionCount;
+    std::uint64_t key;
+    std::uint64_t sectionOffsets[CACHE_MAX_SECTIONS];
+    std::uint64_t sectionSizes[CACHE_MAX_SECTIONS];
+};
+
+std::size_t
+alignOffset(std::size_t offset)
+{
+    return (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+}
+
+void
+CacheKeyHasher::add(const void* data, std::size_t size)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+std::uint64_t
+CacheKeyHasher::getValue() const
+{
+    return hash;
+}
+
+AccelerationStructureCache::AccelerationStructureCache(std::string directory)
+  : directory(std::move(directory))
+{
+    if (!this->directory.empty() && this->directory.back() != '/')
+        this->directory += '/';
+}
+
+bool
+AccelerationStructureCache::load(AccelerationStructure& structure) const
+{
+    auto key = getKey(structure);
+    if (!key)
+        return false;
+    auto file = MappedFile::open(getFileName(key));
+    if (!file || file->getSize() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, file->getData(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION || header.key != key ||
+        header.sectionCount > CACHE_MAX_SECTIONS)
+        return false;
+
+    std::vector<CacheSection> sections;
+    for (std::uint32_t i = 0; i < header.sectionCount; i++) {
+        auto offset = header.sectionOffsets[i];
+        auto size = header.sectionSizes[i];
+        if (offset % CACHE_ALIGNMENT || offset > file->getSize() ||
+            size > file->getSize() - offset)
+            return false;
+        sections.push_back({ file->getData() + offset, size });
+    }
+    return structure.loadCacheSections(sections, std::move(file));
+}
+
+void
+AccelerationStructureCache::save(const AccelerationStructure& structure) const
+{
+    auto key = getKey(structure);
+    if (!key)
+        return;
+    auto sections = structure.getCacheSections();
+    if (sections.size() > CACHE_MAX_SECTIONS)
+        return;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.sectionCount = sections.size();
+    header.key = key;
+    std::size_t offset = alignOffset(sizeof(header));
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        header.sectionOffsets[i] = offset;
+        header.sectionSizes[i] = sections[i].size;
+        offset = alignOffset(offset + sections[i].size);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    auto fileName = getFileName(key);
+    auto temporaryName = fileName + ".tmp" + std::to_string(getpid());
+    std::ofstream stream(temporaryName, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[CACHE_ALIGNMENT] = {};
+    std::size_t position = sizeof(header);
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        stream.write(padding, header.sectionOffsets[i] - position);
+        stream.write(static_cast<const char*>(sections[i].data),
+                     sections[i].size);
+        position = header.sectionOffsets[i] + sections[i].size;
+    }
+    stream.close();
+
+    if (!stream || std::rename(temporaryName.c_str(), fileName.c_str())) {
+        std::cout << "Could not write cache file \"" << fileName << '"'
+                  << std::endl;
+        std::remove(temporaryName.c_str());
+    }
+}
+
+std::uint64_t
+AccelerationStructureCache::getKey(const AccelerationStructure& structure)
+{
+    auto settings = structure.getCacheSettingsHash();
+    if (!settings)
+        return 0;
+
+    CacheKeyHasher hasher;
+    hasher.add(CACHE_VERSION);
+    hasher.add(sizeof(FloatT));
+    hasher.add(TRIANGLE_BLOCK_WIDTH);
+    hasher.add(sizeof(TriangleBlock));
+    hasher.add(settings);
+
+    auto& geometry = *structure.geometry;
+    std::uint32_t triangleCount = geometry.getTriangleCount();
+    hasher.add(triangleCount);
+    for (std::uint32_t i = 0; i < triangleCount; i++) {
+        for (int corner = 0; corner < 3; corner++) {
+            auto& vertex = geometry.getVertex(i, corner);
+            hasher.add(vertex.x);
+            hasher.add(vertex.y);
+            hasher.add(vertex.z);
+        }
+    }
+    // 0 means no key
+    return hasher.getValue() ? hasher.getValue() : 1;
+}
+
+std::string
+AccelerationStructureCache::getFileName(std::uint64_t key) const
+{
+    std::ostringstream name;
+    name << directory << std::hex << key << ".accel";
+    return name.str();
+}
+}
@@ -0,0 +1,161 @@
+/**
+ * @file AccelerationStructureCache.hpp
+ * @author Cem Gundogdu
+ * @brief Stores built acceleration structures on disk
+ * @version 1.0
+ * @date 2021-05-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "MappedFile.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AccelerationStructures {
+class AccelerationStructure;
+
+/**
+ * @brief A contiguous array of an acceleration structure, saved to or loaded
+ * from a cache file
+ *
+ */
+struct CacheSection
+{
+    /**
+     * @brief Start of the array
+     *
+     */
+    const void* data;
+
+    /**
+     * @brief Size of the array in bytes
+     *
+     */
+    std::size_t size;
+};
+
+/**
+ * @brief 64-bit FNV-1a hash, used to identify cached structures
+ *
+ */
+class CacheKeyHasher
+{
+public:
+    /**
+     * @brief Adds bytes to the hash
+     *
+     * @param data
+     * @param size Number of bytes
+     */
+    void add(const void* data, std::size_t size);
+
+    /**
+     * @brief Adds the bytes of a trivially copyable value to the hash
+     *
+     * @tparam T
+     * @param value
+     */
+    template<typename T>
+    void add(const T& value);
+
+    /**
+     * @brief Hash of everything added so far
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t getValue() const;
+
+private:
+    /**
+     * @brief Current hash, starts with the FNV offset basis
+     *
+     */
+    std::uint64_t hash = 14695981039346656037ull;
+};
+
+template<typename T>
+void
+CacheKeyHasher::add(const T& value)
+{
+    add(&value, sizeof(T));
+}
+
+/**
+ * @brief Directory of acceleration structures that were built before
+ *
+ * Each structure is saved in its own file, named after a hash of the mesh's
+ * triangles, the builder's settings and the cache format. A structure with
+ * the same key is the same structure, so it can be loaded instead of being
+ * built.
+ *
+ * A file starts with a header and the sections of the structure follow. Each
+ * section starts at a multiple of 64 bytes, so that a memory mapped file can
+ * be used directly for SIMD intersection tests. Files are written to a
+ * temporary name and renamed, so a partially written file is never read.
+ *
+ */
+class AccelerationStructureCache
+{
+public:
+    /**
+     * @brief Construct a new AccelerationStructureCache object
+     *
+     * @param directory Directory for cache files. Created when the first file
+     * is saved.
+     */
+    AccelerationStructureCache(std::string directory);
+
+    /**
+     * @brief Loads the structure for its geometry from the cache
+     *
+     * The file is memory mapped, the structure refers to the mapping instead
+     * of copying the data.
+     *
+     * @param structure A structure whose geometry is set
+     * @return true Structure was found and loaded
+     * @return false Structure doesn't support caching, isn't in the cache, or
+     * the file is invalid. The structure should be built.
+     */
+    bool load(AccelerationStructure& structure) const;
+
+    /**
+     * @brief Saves a built structure to the cache
+     *
+     * Failures are reported but otherwise ignored, the cache is only an
+     * optimization.
+     *
+     * @param structure
+     */
+    void save(const AccelerationStructure& structure) const;
+
+private:
+    /**
+     * @brief Key that identifies the structure in the cache
+     *
+     * @param structure
+     * @return std::uint64_t 0 if the structure doesn't support caching
+     */
+    static std::uint64_t getKey(const AccelerationStructure& structure);
+
+    /**
+     * @brief Path of the cache file for a key
+     *
+     * @param key
+     * @return std::string
+     */
+    std::string getFileName(std::uint64_t key) const;
+
+    /**
+     * @brief Directory of cache files, ends with '/'
+     *
+     */
+    std::string directory;
+};
+}
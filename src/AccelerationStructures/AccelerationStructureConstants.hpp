@@ -11,9 +11,99 @@
 
 #pragma once
 
+#include "Config.hpp"
+
 namespace AccelerationStructures {
 
-constexpr int KD_BRUTE_FORCE_THRESHOLD = 128;
 constexpr int BVH_BRUTE_FORCE_THRESHOLD = 8;
 
+// number of triangles tested together in the leaves of acceleration
+// structures, one SIMD lane each. 8 fits an AVX register, 4 an SSE register
+#ifdef USE_AVX2
+constexpr int TRIANGLE_BLOCK_WIDTH = 8;
+#else
+constexpr int TRIANGLE_BLOCK_WIDTH = 4;
+#endif
+
+// surface area heuristic for BVH. costs are relative to each other, so only
+// their ratio matters
+constexpr int BVH_SAH_BIN_COUNT = 16;
+constexpr int BVH_SAH_MAX_LEAF_SIZE = 32;
+constexpr FloatT BVH_SAH_TRAVERSAL_COST = 1;
+constexpr FloatT BVH_SAH_INTERSECTION_COST = 1;
+
+// spatial splits for BVH. triangles are clipped into SBVH_SPATIAL_BIN_COUNT
+// bins along each axis. spatial splits are only tried when the children of
+// the best object split overlap by more than SBVH_OVERLAP_THRESHOLD of the
+// root's area, and at most SBVH_DUPLICATION_BUDGET times the triangle count
+// extra references are created
+constexpr int SBVH_SPATIAL_BIN_COUNT = 16;
+constexpr FloatT SBVH_OVERLAP_THRESHOLD = 1e-5;
+constexpr FloatT SBVH_DUPLICATION_BUDGET = 0.3;
+constexpr int SBVH_MAX_SPATIAL_DEPTH = 48;
+
+// surface area heuristic for k-d tree. a node becomes a leaf if splitting it
+// costs more than intersecting all of its triangles. splits with an empty
+// child get a discount of KD_SAH_EMPTY_BONUS, so that empty space is cut off.
+// depth is limited to KD_SAH_BASE_DEPTH + KD_SAH_DEPTH_FACTOR * log2(N)
+constexpr FloatT KD_SAH_TRAVERSAL_COST = 1;
+constexpr FloatT KD_SAH_INTERSECTION_COST = 1.5;
+constexpr FloatT KD_SAH_EMPTY_BONUS = 0.2;
+constexpr int KD_SAH_BASE_DEPTH = 8;
+constexpr FloatT KD_SAH_DEPTH_FACTOR = 1.3;
+
+// primitive IDs remembered by the mailbox of each ray in k-d tree traversal,
+// so that triangles in several leaves are tested once
+constexpr int KD_MAILBOX_SIZE = 16;
+
+// linear BVH. triangle centroids are sorted by Morton codes of
+// LBVH_MORTON_BITS bits, 30 or 63. about LBVH_TOP_CLUSTER_COUNT subtrees at
+// the top are joined by agglomerative clustering instead, 0 disables it
+constexpr int LBVH_MORTON_BITS = 30;
+constexpr int LBVH_TOP_CLUSTER_COUNT = 64;
+
+// automatic selection with -a auto. meshes with at most
+// AUTO_BRUTE_FORCE_MAX_TRIANGLES use brute force and with at most
+// AUTO_BOUNDING_BOX_MAX_TRIANGLES a bounding box. larger meshes use a k-d tree
+// if they have at most AUTO_KD_MAX_TRIANGLES, since k-d trees take much longer
+// to build, and if the average triangle is smaller than
+// AUTO_KD_MAX_TRIANGLE_SIZE of the mesh, since large triangles are cut by
+// many planes. the others use a BVH
+constexpr int AUTO_BRUTE_FORCE_MAX_TRIANGLES = TRIANGLE_BLOCK_WIDTH;
+constexpr int AUTO_BOUNDING_BOX_MAX_TRIANGLES = 32;
+constexpr int AUTO_KD_MAX_TRIANGLES = 16384;
+constexpr FloatT AUTO_KD_MAX_TRIANGLE_SIZE = 0.05;
+
+// a refit BVH is built again when its surface area cost grows by more than
+// this ratio since the last build
+constexpr FloatT BVH_REFIT_REBUILD_THRESHOLD = 1.5;
+
+// entries of the fixed-size stack used in BVH traversal. trees deeper than
+// this are still traversed correctly, but less efficiently
+constexpr int BVH_TRAVERSAL_STACK_SIZE = 64;
+
+// bits per coordinate of BVH node bounds. full precision nodes store floats,
+// quantized nodes store 8 or 16-bit offsets from the bounds of their parent
+constexpr int BVH_FULL_NODE_BITS = 32;
+
+// children per BVH node. 2 traverses the binary tree as it is built, 4 or 8
+// collapse it into nodes that test all of their children's boxes at once
+constexpr int BVH_DEFAULT_WIDTH = 2;
+
+// nodes with at least this many triangles are built in parallel. binning,
+// partitioning and building the children are divided between threads
+constexpr int BVH_PARALLEL_BUILD_THRESHOLD = 8192;
+constexpr int KD_PARALLEL_BUILD_THRESHOLD = 8192;
+
+// meshes with at most this many triangles are put in the hierarchy over the
+// surfaces of a scene triangle by triangle, instead of being tested through
+// their own acceleration structure
+constexpr int SURFACE_BVH_MAX_INLINE_TRIANGLES = 16;
+
+// costs of the surface area heuristic reported by --accel-stats. the same
+// costs are used for all structures, so that their reported costs can be
+// compared
+constexpr FloatT STATS_SAH_TRAVERSAL_COST = 1;
+constexpr FloatT STATS_SAH_INTERSECTION_COST = 1;
+
 }
\ No newline at end of file
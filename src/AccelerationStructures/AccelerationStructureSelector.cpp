@@ -0,0 +1,142 @@
+#include "AccelerationStructureSelector.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include "AxisAlignedBox.hpp"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace AccelerationStructures {
+AccelerationStructureSelector::AccelerationStructureSelector(Factory factory,
+                                                             int trialRayCount)
+  : factory(std::move(factory))
+  , trialRayCount(trialRayCount)
+{}
+
+AccelerationStructureSelector::Selection
+AccelerationStructureSelector::select(
+  const std::shared_ptr<const Objects::MeshGeometry>& geometry) const
+{
+    int count = geometry->getTriangleCount();
+    std::ostringstream reason;
+    reason << count << " triangles";
+    if (count <= AUTO_BRUTE_FORCE_MAX_TRIANGLES) {
+        reason << ", fit in one triangle block";
+        return { SelectableStructure::BruteForce, reason.str() };
+    }
+    if (count <= AUTO_BOUNDING_BOX_MAX_TRIANGLES) {
+        reason << ", too few to divide";
+        return { SelectableStructure::BoundingBox, reason.str() };
+    }
+    if (count > AUTO_KD_MAX_TRIANGLES) {
+        reason << ", too many to build a k-d tree quickly";
+        return { SelectableStructure::BoundingVolumeHierarchy, reason.str() };
+    }
+    if (trialRayCount > 0)
+        return runTrial(geometry);
+
+    FloatT size = relativeTriangleSize(*geometry);
+    reason << ", average size " << size << " of the mesh";
+    if (size > AUTO_KD_MAX_TRIANGLE_SIZE) {
+        reason << " is too large for a k-d tree";
+        return { SelectableStructure::BoundingVolumeHierarchy, reason.str() };
+    }
+    return { SelectableStructure::KDTree, reason.str() };
+}
+
+const char*
+AccelerationStructureSelector::getName(SelectableStructure structure)
+{
+    switch (structure) {
+        case SelectableStructure::BruteForce:
+            return "bf";
+        case SelectableStructure::BoundingBox:
+            return "bb";
+        case SelectableStructure::BoundingVolumeHierarchy:
+            return "bvh";
+        case SelectableStructure::KDTree:
+            return "kd";
+    }
+    return "";
+}
+
+FloatT
+AccelerationStructureSelector::relativeTriangleSize(
+  const Objects::MeshGeometry& geometry)
+{
+    int count = geometry.getTriangleCount();
+    AxisAlignedBox bounds;
+    FloatT sizeSum = 0;
+    for (int i = 0; i < count; i++) {
+        AxisAlignedBox box(geometry.getTriangle(i));
+        sizeSum += (box.max - box.min).norm();
+        bounds.extend(box);
+    }
+    FloatT diagonal = (bounds.max - bounds.min).norm();
+    if (!(diagonal > 0))
+        return std::numeric_limits<FloatT>::infinity();
+    return sizeSum / count / diagonal;
+}
+
+AccelerationStructureSelector::Selection
+AccelerationStructureSelector::runTrial(
+  const std::shared_ptr<const Objects::MeshGeometry>& geometry) const
+{
+    AxisAlignedBox bounds;
+    for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++)
+        bounds.extend(AxisAlignedBox(geometry->getTriangle(i)));
+    auto center = bounds.center();
+    FloatT radius = (bounds.max - bounds.min).norm() / 2;
+
+    std::mt19937 generator(trialRayCount);
+    std::normal_distribution<FloatT> normal;
+    std::uniform_real_distribution<FloatT> uniform(0, 1);
+    std::vector<Objects::Ray> rays;
+    rays.reserve(trialRayCount);
+    for (int i = 0; i < trialRayCount; i++) {
+        LinearAlgebra::Vec3 direction{ normal(generator),
+                                       normal(generator),
+                                       normal(generator) };
+        auto origin = center + direction.normalize() * radius;
+        LinearAlgebra::Vec3 target;
+        for (int axis = 0; axis < 3; axis++) {
+            target[axis] = bounds.min[axis] +
+                           uniform(generator) *
+                             (bounds.max[axis] - bounds.min[axis]);
+        }
+        rays.emplace_back(origin, target - origin);
+    }
+
+    // the first pass loads the structure into the caches, the second one is
+    // timed
+    auto time = [&](const AccelerationStructure& structure) {
+        LinearAlgebra::Vec3 normalOut;
+        std::chrono::steady_clock::duration duration{};
+        for (int pass = 0; pass < 2; pass++) {
+            auto start = std::chrono::steady_clock::now();
+            for (auto& ray : rays)
+                structure.intersect(ray, normalOut);
+            duration = std::chrono::steady_clock::now() - start;
+        }
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+    auto bvh = factory(SelectableStructure::BoundingVolumeHierarchy);
+    bvh->build(geometry);
+    double bvhMs = time(*bvh);
+    auto kdTree = factory(SelectableStructure::KDTree);
+    kdTree->build(geometry);
+    double kdMs = time(*kdTree);
+
+    std::ostringstream reason;
+    reason << geometry->getTriangleCount() << " triangles, " << trialRayCount
+           << " trial rays took " << bvhMs << " ms with bvh and " << kdMs
+           << " ms with kd";
+    if (kdMs < bvhMs)
+        return { SelectableStructure::KDTree, reason.str(), std::move(kdTree) };
+    return { SelectableStructure::BoundingVolumeHierarchy,
+             reason.str(),
+             std::move(bvh) };
+}
+}
@@ -0,0 +1,150 @@
+/**
+ * @file AccelerationStructureSelector.hpp
+ * @author Cem Gundogdu
+ * @brief
+ * @version 1.0
+ * @date 2021-05-19
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AccelerationStructure.hpp"
+#include "MeshGeometry.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace AccelerationStructures {
+/**
+ * @brief Acceleration structures that AccelerationStructureSelector chooses
+ * from
+ *
+ */
+enum class SelectableStructure
+{
+    BruteForce,
+    BoundingBox,
+    BoundingVolumeHierarchy,
+    KDTree
+};
+
+/**
+ * @brief Chooses an acceleration structure for each mesh
+ *
+ * Meshes that fit in a single triangle block get BruteForce, small meshes get
+ * BoundingBox. Larger meshes get a k-d tree if their triangles are small
+ * compared to the mesh, so that few of them are cut by the splitting planes,
+ * and if the mesh is small enough that the slower k-d tree build pays off.
+ * Other meshes get a BVH.
+ *
+ * The parser doesn't select structures for meshes with at most
+ * SURFACE_BVH_MAX_INLINE_TRIANGLES triangles that are not instanced, their
+ * triangles are put in the scene's hierarchy instead. So BruteForce and
+ * BoundingBox are only chosen for the base meshes of instances.
+ *
+ * If trial rays are enabled, meshes that could use either of a BVH and a k-d
+ * tree are built with both, and the one that traces the trial rays faster is
+ * chosen.
+ *
+ */
+class AccelerationStructureSelector
+{
+public:
+    /**
+     * @brief Creates an empty structure of the given type
+     *
+     */
+    using Factory = std::function<std::unique_ptr<AccelerationStructure>(
+      SelectableStructure)>;
+
+    /**
+     * @brief A chosen structure and why it was chosen
+     *
+     */
+    struct Selection
+    {
+        /**
+         * @brief Chosen structure
+         *
+         */
+        SelectableStructure structure;
+
+        /**
+         * @brief Explanation of the choice, for logging
+         *
+         */
+        std::string reason;
+
+        /**
+         * @brief The chosen structure, already built for the mesh, if it was
+         * built for trial rays. Null otherwise.
+         *
+         */
+        std::unique_ptr<AccelerationStructure> built = nullptr;
+    };
+
+    /**
+     * @brief Construct a new AccelerationStructureSelector object
+     *
+     * @param factory Creates the structures built for trial rays
+     * @param trialRayCount Number of rays traced by both a BVH and a k-d tree
+     * to choose between them. 0 chooses without building them.
+     */
+    AccelerationStructureSelector(Factory factory, int trialRayCount = 0);
+
+    /**
+     * @brief Chooses a structure for the triangles of a mesh
+     *
+     * @param geometry
+     * @return Selection
+     */
+    Selection select(
+      const std::shared_ptr<const Objects::MeshGeometry>& geometry) const;
+
+    /**
+     * @brief Name of a structure, the same as its -a argument
+     *
+     * @param structure
+     * @return const char*
+     */
+    static const char* getName(SelectableStructure structure);
+
+protected:
+    /**
+     * @brief Average diagonal of the bounding boxes of the triangles, as a
+     * ratio of the diagonal of the bounding box of the mesh
+     *
+     * @param geometry A mesh with at least one triangle
+     * @return FloatT Infinity if the mesh is a single point
+     */
+    static FloatT relativeTriangleSize(const Objects::MeshGeometry& geometry);
+
+    /**
+     * @brief Builds a BVH and a k-d tree and times the trial rays with each
+     *
+     * Rays start on the bounding sphere of the mesh and go through random
+     * points of its bounding box. The same rays are used for every mesh of
+     * the same size.
+     *
+     * @param geometry
+     * @return Selection The faster structure, with the built structure
+     */
+    Selection runTrial(
+      const std::shared_ptr<const Objects::MeshGeometry>& geometry) const;
+
+    /**
+     * @brief Creates the structures built for trial rays
+     *
+     */
+    Factory factory;
+
+    /**
+     * @brief Number of trial rays, 0 if trials are disabled
+     *
+     */
+    int trialRayCount;
+};
+}
@@ -0,0 +1,109 @@
+#include "AccelerationStructureStats.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include <algorithm>
+#include <string>
+
+namespace AccelerationStructures {
+namespace {
+/**
+ * @brief Range of leaf sizes counted by an element of leafSizes
+ *
+ * @param bucket
+ * @return std::string Like "4-7", or a single number
+ */
+std::string
+bucketName(std::size_t bucket)
+{
+    if (bucket <= 1)
+        return std::to_string(bucket);
+    std::size_t low = std::size_t(1) << (bucket - 1);
+    return std::to_string(low) + '-' + std::to_string(2 * low - 1);
+}
+}
+
+void
+AccelerationStructureStats::addInterior(int depth, FloatT area)
+{
+    if (depth == 0)
+        rootArea = area;
+    nodeCount++;
+    interiorArea += area;
+}
+
+void
+AccelerationStructureStats::addLeaf(int depth,
+                                    FloatT area,
+                                    std::size_t triangleCount)
+{
+    if (depth == 0)
+        rootArea = area;
+    nodeCount++;
+    leafCount++;
+    triangleReferences += triangleCount;
+    maxDepth = std::max(maxDepth, depth);
+    depthSum += depth;
+    leafArea += area * triangleCount;
+
+    std::size_t bucket = 0;
+    while (triangleCount >> bucket)
+        bucket++;
+    if (leafSizes.size() <= bucket)
+        leafSizes.resize(bucket + 1);
+    leafSizes[bucket]++;
+}
+
+double
+AccelerationStructureStats::averageDepth() const
+{
+    return leafCount ? double(depthSum) / leafCount : 0;
+}
+
+double
+AccelerationStructureStats::sahCost() const
+{
+    double cost = interiorArea * STATS_SAH_TRAVERSAL_COST +
+                  leafArea * STATS_SAH_INTERSECTION_COST;
+    // a flat mesh may have a root with no area
+    return rootArea > 0 ? cost / rootArea : cost;
+}
+
+void
+AccelerationStructureStats::print(std::ostream& stream) const
+{
+    stream << triangleCount << " triangles, " << nodeCount << " nodes, "
+           << leafCount << " leaves with " << triangleReferences
+           << " triangle references, max depth " << maxDepth
+           << ", average depth " << averageDepth() << ", SAH cost "
+           << sahCost() << ", " << memoryUsage / (1024 * 1024.0)
+           << " MB, built in " << buildMs << " ms\n  leaf sizes";
+    const char* separator = " ";
+    for (std::size_t i = 0; i < leafSizes.size(); i++) {
+        if (!leafSizes[i])
+            continue;
+        stream << separator << bucketName(i) << ": " << leafSizes[i];
+        separator = ", ";
+    }
+    stream << '\n';
+}
+
+void
+AccelerationStructureStats::printJson(std::ostream& stream) const
+{
+    stream << "{\"triangles\": " << triangleCount
+           << ", \"nodes\": " << nodeCount << ", \"leaves\": " << leafCount
+           << ", \"triangleReferences\": " << triangleReferences
+           << ", \"maxDepth\": " << maxDepth
+           << ", \"averageDepth\": " << averageDepth()
+           << ", \"leafSizes\": {";
+    const char* separator = "";
+    for (std::size_t i = 0; i < leafSizes.size(); i++) {
+        if (!leafSizes[i])
+            continue;
+        stream << separator << '"' << bucketName(i) << "\": " << leafSizes[i];
+        separator = ", ";
+    }
+    stream << "}, \"sahCost\": " << sahCost()
+           << ", \"memoryBytes\": " << memoryUsage
+           << ", \"buildMs\": " << buildMs << '}';
+}
+}
@@ -0,0 +1,154 @@
+/**
+ * @file AccelerationStructureStats.hpp
+ * @author Cem Gundogdu
+ * @brief Statistics about the shape and cost of an acceleration structure
+ * @version 1.0
+ * @date 2021-05-13
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace AccelerationStructures {
+/**
+ * @brief Shape, cost, size and build time of an acceleration structure
+ *
+ * Every structure is described as a tree of boxes with triangles in its
+ * leaves, so that different structures can be compared. A structure without a
+ * hierarchy is a single leaf.
+ *
+ */
+struct AccelerationStructureStats
+{
+    /**
+     * @brief Counts an interior node
+     *
+     * @param depth 0 for the root
+     * @param area Surface area of the node's box
+     */
+    void addInterior(int depth, FloatT area);
+
+    /**
+     * @brief Counts a leaf
+     *
+     * @param depth 0 for the root
+     * @param area Surface area of the leaf's box
+     * @param triangleCount Number of triangles in the leaf
+     */
+    void addLeaf(int depth, FloatT area, std::size_t triangleCount);
+
+    /**
+     * @brief Average depth of the leaves
+     *
+     * @return double
+     */
+    double averageDepth() const;
+
+    /**
+     * @brief Expected cost of testing a ray that hits the root
+     *
+     * Surface area heuristic with STATS_SAH_TRAVERSAL_COST and
+     * STATS_SAH_INTERSECTION_COST.
+     *
+     * @return double
+     */
+    double sahCost() const;
+
+    /**
+     * @brief Writes the stats as text, in two lines
+     *
+     * @param stream
+     */
+    void print(std::ostream& stream) const;
+
+    /**
+     * @brief Writes the stats as a JSON object, in one line
+     *
+     * @param stream
+     */
+    void printJson(std::ostream& stream) const;
+
+    /**
+     * @brief Number of triangles in the mesh
+     *
+     */
+    std::size_t triangleCount = 0;
+
+    /**
+     * @brief Number of interior nodes and leaves
+     *
+     */
+    std::size_t nodeCount = 0;
+
+    /**
+     * @brief Number of leaves
+     *
+     */
+    std::size_t leafCount = 0;
+
+    /**
+     * @brief Sum of triangle counts of leaves. Larger than triangleCount if
+     * triangles are referenced by more than one leaf.
+     *
+     */
+    std::size_t triangleReferences = 0;
+
+    /**
+     * @brief Depth of the deepest leaf
+     *
+     */
+    int maxDepth = 0;
+
+    /**
+     * @brief Sum of depths of leaves
+     *
+     */
+    std::size_t depthSum = 0;
+
+    /**
+     * @brief Histogram of triangle counts of leaves
+     *
+     * Element 0 is the number of empty leaves. Element i counts the leaves
+     * with at least 2^(i-1) and less than 2^i triangles.
+     *
+     */
+    std::vector<std::size_t> leafSizes;
+
+    /**
+     * @brief Surface area of the root
+     *
+     */
+    double rootArea = 0;
+
+    /**
+     * @brief Sum of surface areas of interior nodes
+     *
+     */
+    double interiorArea = 0;
+
+    /**
+     * @brief Sum of surface areas of leaves, weighted by their triangle counts
+     *
+     */
+    double leafArea = 0;
+
+    /**
+     * @brief Memory used by the structure in bytes
+     *
+     */
+    std::size_t memoryUsage = 0;
+
+    /**
+     * @brief Time it took to build, refit or load the structure
+     *
+     */
+    double buildMs = 0;
+};
+}
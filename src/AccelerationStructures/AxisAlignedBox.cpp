@@ -0,0 +1,82 @@
+#include "AxisAlignedBox.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace AccelerationStructures {
+AxisAlignedBox::AxisAlignedBox()
+  : min(std::numeric_limits<FloatT>::infinity(),
+        std::numeric_limits<FloatT>::infinity(),
+        std::numeric_limits<FloatT>::infinity())
+  , max(-std::numeric_limits<FloatT>::infinity(),
+        -std::numeric_limits<FloatT>::infinity(),
+        -std::numeric_limits<FloatT>::infinity())
+{}
+
+AxisAlignedBox::AxisAlignedBox(const Objects::Triangle& triangle)
+  : AxisAlignedBox()
+{
+    extend(triangle.v1);
+    extend(triangle.v2);
+    extend(triangle.v3);
+}
+
+void
+AxisAlignedBox::extend(const LinearAlgebra::Vec3& point)
+{
+    min.x = std::min(min.x, point.x);
+    min.y = std::min(min.y, point.y);
+    min.z = std::min(min.z, point.z);
+    max.x = std::max(max.x, point.x);
+    max.y = std::max(max.y, point.y);
+    max.z = std::max(max.z, point.z);
+}
+
+void
+AxisAlignedBox::extend(const AxisAlignedBox& box)
+{
+    min.x = std::min(min.x, box.min.x);
+    min.y = std::min(min.y, box.min.y);
+    min.z = std::min(min.z, box.min.z);
+    max.x = std::max(max.x, box.max.x);
+    max.y = std::max(max.y, box.max.y);
+    max.z = std::max(max.z, box.max.z);
+}
+
+FloatT
+AxisAlignedBox::surfaceArea() const
+{
+    if (empty())
+        return 0;
+    auto size = max - min;
+    return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+LinearAlgebra::Vec3
+AxisAlignedBox::center() const
+{
+    return (min + max) / 2;
+}
+
+int
+AxisAlignedBox::longestAxis() const
+{
+    auto size = max - min;
+    if (size.x > size.y && size.x > size.z)
+        return 0;
+    if (size.y > size.z)
+        return 1;
+    return 2;
+}
+
+bool
+AxisAlignedBox::empty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+FloatT
+AxisAlignedBox::intersect(const TraversalRay& ray) const
+{
+    return ray.intersectBox(min.x, max.x, min.y, max.y, min.z, max.z);
+}
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+/**
+ * @file AxisAlignedBox.hpp
+ * @author Cem Gundogdu
+ * @brief Plain axis-aligned box used while building acceleration structures
+ * @version 1.0
+ * @date 2021-05-02
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "TraversalRay.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+namespace AccelerationStructures {
+/**
+ * @brief Axis-aligned box with no triangles attached to it
+ *
+ * Unlike BoundingBox, this is not an acceleration structure. It is a small
+ * value type used for bounds calculations during construction, such as
+ * evaluating the surface area heuristic.
+ *
+ */
+class AxisAlignedBox
+{
+public:
+    /**
+     * @brief Construct an empty box
+     *
+     * An empty box has min > max on all axes. Extending it with a point results
+     * in a box containing only that point.
+     *
+     */
+    AxisAlignedBox();
+
+    /**
+     * @brief Construct the smallest box containing the given triangle
+     *
+     * @param triangle
+     */
+    AxisAlignedBox(const Objects::Triangle& triangle);
+
+    /**
+     * @brief Grow this box so that it contains the given point
+     *
+     * @param point
+     */
+    void extend(const LinearAlgebra::Vec3& point);
+
+    /**
+     * @brief Grow this box so that it contains the given box
+     *
+     * @param box
+     */
+    void extend(const AxisAlignedBox& box);
+
+    /**
+     * @brief Surface area of the box
+     *
+     * @return 0 if the box is empty
+     */
+    FloatT surfaceArea() const;
+
+    /**
+     * @brief Center point of the box
+     *
+     * @return LinearAlgebra::Vec3
+     */
+    LinearAlgebra::Vec3 center() const;
+
+    /**
+     * @brief Axis with the largest extent
+     *
+     * @return 0, 1 or 2 for x, y and z
+     */
+    int longestAxis() const;
+
+    /**
+     * @brief Whether the box contains no points
+     *
+     * @return true min > max on some axis
+     * @return false
+     */
+    bool empty() const;
+
+    /**
+     * @brief Finds where the ray enters this box
+     *
+     * @param ray
+     * @return -1 if the ray doesn't hit the box. 0 if the origin is inside the
+     * box. Else, the t value where the ray enters the box.
+     */
+    FloatT intersect(const TraversalRay& ray) const;
+
+    /**
+     * @name Limits
+     *
+     */
+    ///@{
+    /**
+     * @brief Corner with the lowest coordinates
+     *
+     */
+    LinearAlgebra::Vec3 min;
+
+    /**
+     * @brief Corner with the highest coordinates
+     *
+     */
+    LinearAlgebra::Vec3 max;
+    ///@}
+};
+}
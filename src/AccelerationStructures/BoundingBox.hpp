@@ -12,6 +12,7 @@
 #pragma once
 
 #include "BruteForce.hpp"
+#include "TraversalRay.hpp"
 
 namespace AccelerationStructures {
 /**
@@ -42,15 +43,27 @@ public:
                      LinearAlgebra::Vec3& normalOut) const override;
 
     /**
-     * @brief Builds the acceleration structure from a vector of triangles
+     * @brief Checks if any triangle is hit in front of the ray before tMax
      *
-     * @param triangles Triangles in this acceleration structure. The vector
-     * will be destroyed by this function. Use std::move to convert vector to
-     * an rvalue. Must be nonempty.
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
      */
-    void build(std::vector<Objects::Triangle>&& triangles) override;
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const override;
 
 protected:
+    /**
+     * @brief Finds the bounding box and packs the triangles into blocks
+     *
+     * If geometry has no triangles, the box is empty and no ray hits it.
+     *
+     */
+    void buildStructure() override;
+
     /**
      * @brief Checks for intersection with bounding box
      *
@@ -59,7 +72,7 @@ protected:
      * ray is inside the bounding box
      * @return false Ray doesn't hit the box
      */
-    bool hitsBoundingBox(const Objects::Ray& ray) const;
+    bool hitsBoundingBox(const TraversalRay& ray) const;
 
     /**
      * @brief Checks for intersection with bounding box
@@ -72,15 +85,16 @@ protected:
      * If ray's origin is inside the box, 0. Otherwise t at the entry point to
      * the box.
      */
-    FloatT intersectBoundingBox(const Objects::Ray& ray) const;
+    FloatT intersectBoundingBox(const TraversalRay& ray) const;
 
     /**
-     * @brief Set the limits of bounding box
+     * @brief Set the limits of bounding box to contain all triangles in
+     * geometry
+     *
+     * Without triangles, minimums are +infinity and maximums are -infinity.
      *
-     * @param triangles Triangles that should be inside this bounding box. Must
-     * be nonempty.
      */
-    void createBoundingBox(const std::vector<Objects::Triangle>& triangles);
+    void createBoundingBox();
 
     /**
      * @name Limits
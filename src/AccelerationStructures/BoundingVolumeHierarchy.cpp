@@ -1,33 +1,1065 @@
 #include "BoundingVolumeHierarchy.hpp"
 #include "AccelerationStructureConstants.hpp"
+#include "SIMDLanes.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <type_traits>
 
 namespace AccelerationStructures {
+namespace {
+/**
+ * @brief Checks for intersection with the bounding box of a node
+ *
+ * @param node
+ * @param ray
+ * @param tLimit Boxes entered at this t value or farther are treated as
+ * missed
+ * @return If the ray doesn't hit the box before tLimit or the box is behind
+ * the ray, -1. If ray's origin is inside the box, 0. Otherwise t at the entry
+ * point to the box.
+ */
+FloatT
+intersectNodeBox(const LinearBVHNode& node,
+                 const TraversalRay& ray,
+                 FloatT tLimit)
+{
+    return ray.intersectBox(node.xMin,
+                            node.xMax,
+                            node.yMin,
+                            node.yMax,
+                            node.zMin,
+                            node.zMax,
+                            tLimit);
+}
+
+/**
+ * @brief Checks for intersection with the boxes of all children of a wide node
+ *
+ * Does the same operations as intersectNodeBox() for each child, on
+ * Lanes::width children at once, so that the results are the same. Unused
+ * slots are never hit.
+ *
+ * @tparam Width 4 or 8
+ * @param node
+ * @param ray
+ * @param tLimit Boxes entered at this t value or farther are treated as
+ * missed
+ * @param tOut Set to the t values at the entry points to the boxes that are
+ * hit, or 0 if ray's origin is inside them
+ * @return Bit mask of the children that are hit
+ */
+template<int Width>
+int
+intersectChildBoxes(const WideBVHNode<Width>& node,
+                    const TraversalRay& ray,
+                    FloatT tLimit,
+                    FloatT (&tOut)[Width])
+{
+#ifdef SIMD_LANES_SSE
+    // 4-wide nodes are tested with SSE even if AVX is available
+    using L = std::conditional_t<Width % Lanes::width == 0, Lanes, SSELanes>;
+    constexpr FloatT exitScale =
+      1 + 4 * std::numeric_limits<FloatT>::epsilon();
+    constexpr FloatT infinity = std::numeric_limits<FloatT>::infinity();
+
+    int mask = 0;
+    for (int lane = 0; lane < Width; lane += L::width) {
+        auto tEnter = L::broadcast(-infinity);
+        auto tExit = L::broadcast(infinity);
+        for (int axis = 0; axis < 3; axis++) {
+            // rows of minimum and maximum coordinates are next to each other
+            int near = 2 * axis + ray.negative[axis];
+            int far = 2 * axis + !ray.negative[axis];
+            auto origin = L::broadcast(ray.ray.origin[axis]);
+            auto inverse = L::broadcast(ray.inverseDirection[axis]);
+            auto tNear = L::multiply(
+              L::subtract(L::load(&node.bounds[near][lane]), origin), inverse);
+            auto tFar = L::multiply(
+              L::subtract(L::load(&node.bounds[far][lane]), origin), inverse);
+            tEnter = L::max(tNear, tEnter);
+            tExit = L::min(tFar, tExit);
+        }
+        tExit = L::multiply(tExit, L::broadcast(exitScale));
+
+        auto zero = L::broadcast(0);
+        auto hit = L::both(L::lessOrEqual(tEnter, tExit),
+                           L::lessOrEqual(zero, tExit));
+        hit = L::both(hit, L::less(tEnter, L::broadcast(tLimit)));
+        L::store(tOut + lane, L::max(tEnter, zero));
+        mask |= L::bits(hit) << lane;
+    }
+    return mask;
+#else
+    int mask = 0;
+    for (int slot = 0; slot < Width; slot++) {
+        tOut[slot] = ray.intersectBox(node.bounds[0][slot],
+                                      node.bounds[1][slot],
+                                      node.bounds[2][slot],
+                                      node.bounds[3][slot],
+                                      node.bounds[4][slot],
+                                      node.bounds[5][slot],
+                                      tLimit);
+        if (tOut[slot] != -1)
+            mask |= 1 << slot;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief Full precision nodes for traversal
+ *
+ * Nodes are referred to by pointers into the array, so that they are not
+ * copied.
+ *
+ */
+struct FullNodeArray
+{
+    using Handle = const LinearBVHNode*;
+
+    const LinearBVHNode* nodes;
+
+    Handle child(int index, const LinearBVHNode&) const
+    {
+        return nodes + index;
+    }
+
+    static Handle handle(const LinearBVHNode& node) { return &node; }
+
+    static const LinearBVHNode& get(Handle node) { return *node; }
+};
+
+/**
+ * @brief Quantized nodes for traversal, decoded when they are visited
+ *
+ * Nodes are referred to by their decoded copies, which are needed to decode
+ * their children.
+ *
+ */
+template<typename T>
+struct QuantizedNodeArray
+{
+    using Handle = LinearBVHNode;
+
+    const QuantizedBVHNode<T>* nodes;
+
+    Handle child(int index, const LinearBVHNode& parent) const
+    {
+        return nodes[index].decode(parent);
+    }
+
+    static Handle handle(const LinearBVHNode& node) { return node; }
+
+    static const LinearBVHNode& get(const Handle& node) { return node; }
+};
+
+/**
+ * @brief Node waiting on the traversal stack
+ *
+ * @tparam Handle Refers to a node in one of the node formats
+ */
+template<typename Handle>
+struct TraversalEntry
+{
+    /**
+     * @brief The node
+     *
+     */
+    Handle node;
+
+    /**
+     * @brief Index of the node in the node array
+     *
+     */
+    int index;
+
+    /**
+     * @brief t at the entry point to the box of the node
+     *
+     */
+    FloatT t;
+};
+
+/**
+ * @brief Child of a wide node waiting on the traversal stack
+ *
+ */
+struct WideTraversalEntry
+{
+    /**
+     * @brief Index of the node, or of the first triangle block of a leaf
+     *
+     */
+    std::uint32_t offset;
+
+    /**
+     * @brief Number of triangles of a leaf, 0 for interior nodes
+     *
+     */
+    std::uint16_t primitiveCount;
+
+    /**
+     * @brief t at the entry point to the box of the child
+     *
+     */
+    FloatT t;
+};
+
+/**
+ * @brief Quantizes the nodes of a tree
+ *
+ * @param nodes Full precision nodes in depth-first order
+ * @param output Set to the quantized nodes
+ */
+template<typename T>
+void
+quantizeNodes(const std::vector<LinearBVHNode>& nodes,
+              std::vector<QuantizedBVHNode<T>>& output)
+{
+    output.resize(nodes.size());
+    output[0].encode(nodes[0], nodes[0]);
+
+    // parents come before their children, so the decoded box of a node is
+    // known by the time its children are quantized
+    std::vector<LinearBVHNode> decoded(nodes.size());
+    decoded[0] = nodes[0];
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        // a single node is a leaf, even without primitives
+        if (nodes[i].primitiveCount || nodes.size() == 1)
+            continue;
+        std::size_t secondChild = nodes[i].secondChildOffset;
+        for (std::size_t child : { i + 1, secondChild }) {
+            output[child].encode(nodes[child], decoded[i]);
+            decoded[child] = output[child].decode(decoded[i]);
+        }
+    }
+    output.shrink_to_fit();
+}
+
+/**
+ * @brief Surface area heuristic cost of a wide tree, like
+ * BoundingVolumeHierarchy::treeCost()
+ *
+ * @tparam Width 4 or 8
+ * @param nodes
+ * @return FloatT
+ */
+template<int Width>
+FloatT
+wideTreeCost(const std::vector<WideBVHNode<Width>>& nodes)
+{
+    FloatT rootArea = nodes[0].getBounds().surfaceArea();
+    FloatT cost = rootArea;
+    for (auto& node : nodes) {
+        for (int slot = 0; slot < node.childCount; slot++) {
+            FloatT area = node.getBounds(slot).surfaceArea();
+            if (node.primitiveCount[slot])
+                cost += area * node.primitiveCount[slot];
+            else
+                cost += area;
+        }
+    }
+    return rootArea > 0 ? cost / rootArea : cost;
+}
+
+/**
+ * @brief Adds the children of a wide node and their subtrees to stats
+ *
+ * @tparam Width 4 or 8
+ * @param nodes Nodes of the tree
+ * @param nodeIndex Index of the node
+ * @param depth Depth of the node, 0 for the root of the tree
+ * @param stats
+ */
+template<int Width>
+void
+collectWideNodeStats(const WideBVHNode<Width>* nodes,
+                     int nodeIndex,
+                     int depth,
+                     AccelerationStructureStats& stats)
+{
+    auto& node = nodes[nodeIndex];
+    for (int slot = 0; slot < node.childCount; slot++) {
+        FloatT area = node.getBounds(slot).surfaceArea();
+        if (node.primitiveCount[slot])
+            stats.addLeaf(depth + 1, area, node.primitiveCount[slot]);
+        else {
+            stats.addInterior(depth + 1, area);
+            collectWideNodeStats(
+              nodes, node.childOffset[slot], depth + 1, stats);
+        }
+    }
+}
+
+/**
+ * @brief Checks that the nodes of a tree loaded from a file refer to valid
+ * nodes and blocks
+ *
+ * @tparam Node LinearBVHNode or QuantizedBVHNode
+ * @param section Node array
+ * @param blockCount Number of triangle blocks
+ * @param root Full precision root, should match the first node
+ * @return true
+ * @return false
+ */
+template<typename Node>
+bool
+validNodes(const CacheSection& section,
+           std::size_t blockCount,
+           const LinearBVHNode& root)
+{
+    auto nodes = static_cast<const Node*>(section.data);
+    std::size_t nodeCount = section.size / sizeof(Node);
+    if (section.size % sizeof(Node) || !nodeCount ||
+        nodes[0].primitiveCount != root.primitiveCount ||
+        nodes[0].primitiveOffset != root.primitiveOffset)
+        return false;
+
+    for (std::size_t i = 0; i < nodeCount; i++) {
+        auto& node = nodes[i];
+        if (node.primitiveCount) {
+            if (node.primitiveOffset +
+                  TriangleBlock::blockCount(node.primitiveCount) >
+                blockCount)
+                return false;
+        } else if (i + 1 >= nodeCount || node.secondChildOffset <= i ||
+                   node.secondChildOffset >= nodeCount)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that the wide nodes of a tree loaded from a file refer to
+ * valid nodes and blocks, and that their unused slots can't be hit
+ *
+ * @tparam Width 4 or 8
+ * @param section Node array
+ * @param blockCount Number of triangle blocks
+ * @return true
+ * @return false
+ */
+template<int Width>
+bool
+validWideNodes(const CacheSection& section, std::size_t blockCount)
+{
+    auto nodes = static_cast<const WideBVHNode<Width>*>(section.data);
+    std::size_t nodeCount = section.size / sizeof(WideBVHNode<Width>);
+    if (section.size % sizeof(WideBVHNode<Width>) || !nodeCount)
+        return false;
+
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    for (std::size_t i = 0; i < nodeCount; i++) {
+        auto& node = nodes[i];
+        if (node.childCount > Width)
+            return false;
+        for (int slot = 0; slot < Width; slot++) {
+            std::size_t offset = node.childOffset[slot];
+            int count = node.primitiveCount[slot];
+            if (slot >= node.childCount) {
+                for (int axis = 0; axis < 3; axis++) {
+                    if (node.bounds[2 * axis][slot] != infinity ||
+                        node.bounds[2 * axis + 1][slot] != -infinity)
+                        return false;
+                }
+            } else if (count) {
+                if (offset + TriangleBlock::blockCount(count) > blockCount)
+                    return false;
+            } else if (offset <= i || offset >= nodeCount)
+                return false;
+        }
+    }
+    return true;
+}
+}
+
+AxisAlignedBox
+LinearBVHNode::getBounds() const
+{
+    AxisAlignedBox box;
+    box.min = { xMin, yMin, zMin };
+    box.max = { xMax, yMax, zMax };
+    return box;
+}
+
+void
+LinearBVHNode::setBounds(const AxisAlignedBox& box)
+{
+    xMin = box.min.x;
+    xMax = box.max.x;
+    yMin = box.min.y;
+    yMax = box.max.y;
+    zMin = box.min.z;
+    zMax = box.max.z;
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(FloatT rebuildThreshold,
+                                                 int nodeBits,
+                                                 int width)
+  : nodeBits(width == BVH_DEFAULT_WIDTH ? nodeBits : BVH_FULL_NODE_BITS)
+  , width(width)
+  , rebuildThreshold(rebuildThreshold)
+{}
+
 FloatT
 BoundingVolumeHierarchy::intersect(const Objects::Ray& ray,
                                    LinearAlgebra::Vec3& normalOut) const
 {
-    if (hitsBoundingBox(ray))
-        return intersectTriangle(ray, normalOut);
+    // the box of a mesh without triangles is empty, so its root leaf with no
+    // primitives is never visited
+    TraversalRay traversalRay(ray);
+    if (!hitsBoundingBox(traversalRay))
+        return -1;
+
+    FloatT t = std::numeric_limits<FloatT>::infinity();
+    int closest;
+    if (width == 4)
+        closest = intersectWideNode(wideNodeData4, 0, traversalRay, t);
+    else if (width == 8)
+        closest = intersectWideNode(wideNodeData8, 0, traversalRay, t);
+    else if (nodeBits == 8)
+        closest = intersectNode(QuantizedNodeArray<std::uint8_t>{ nodeData8 },
+                                0,
+                                rootNode,
+                                traversalRay,
+                                t);
+    else if (nodeBits == 16)
+        closest =
+          intersectNode(QuantizedNodeArray<std::uint16_t>{ nodeData16 },
+                        0,
+                        rootNode,
+                        traversalRay,
+                        t);
     else
+        closest = intersectNode(
+          FullNodeArray{ nodeData }, 0, rootNode, traversalRay, t);
+    if (closest == -1)
         return -1;
+
+    // the normal is needed only for the closest triangle
+    normalOut = geometry->getNormal(idData[closest]);
+    return t;
+}
+
+bool
+BoundingVolumeHierarchy::occluded(const Objects::Ray& ray, FloatT tMax) const
+{
+    TraversalRay traversalRay(ray);
+    FloatT t = intersectBoundingBox(traversalRay);
+    if (t == -1 || t >= tMax)
+        return false;
+
+    if (width == 4)
+        return occludedWideNode(wideNodeData4, 0, traversalRay, tMax);
+    if (width == 8)
+        return occludedWideNode(wideNodeData8, 0, traversalRay, tMax);
+    switch (nodeBits) {
+        case 8:
+            return occludedNode(QuantizedNodeArray<std::uint8_t>{ nodeData8 },
+                                0,
+                                rootNode,
+                                traversalRay,
+                                tMax);
+        case 16:
+            return occludedNode(
+              QuantizedNodeArray<std::uint16_t>{ nodeData16 },
+              0,
+              rootNode,
+              traversalRay,
+              tMax);
+        default:
+            return occludedNode(
+              FullNodeArray{ nodeData }, 0, rootNode, traversalRay, tMax);
+    }
+}
+
+std::size_t
+BoundingVolumeHierarchy::getMemoryUsage() const
+{
+    return BruteForce::getMemoryUsage() +
+           nodes.capacity() * sizeof(LinearBVHNode) +
+           nodes8.capacity() * sizeof(QuantizedBVHNode<std::uint8_t>) +
+           nodes16.capacity() * sizeof(QuantizedBVHNode<std::uint16_t>) +
+           wideNodes4.capacity() * sizeof(WideBVHNode<4>) +
+           wideNodes8.capacity() * sizeof(WideBVHNode<8>);
+}
+
+void
+BoundingVolumeHierarchy::buildStructure()
+{
+    createBoundingBox();
+
+    int count = geometry->getTriangleCount();
+    auto& pool = ThreadPool::shared();
+    buildPrimitives.resize(count);
+    pool.parallelFor(
+      0, count, buildChunkCount(count), [&](int, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              AxisAlignedBox box(geometry->getTriangle(i));
+              buildPrimitives[i] = { box, box.center(), std::uint32_t(i) };
+          }
+      });
+
+    nodes.clear();
+    nodes.reserve(2 * count);
+    bruteForceLeafCount = 0;
+    bruteForceTriangleCount = 0;
+    buildNode(0, count, nodes);
+    nodes.shrink_to_fit();
+    if (bruteForceLeafCount) {
+        std::cout << "Switched to brute force in " << bruteForceLeafCount
+                  << " leaves with " << bruteForceTriangleCount
+                  << " triangles\n";
+    }
+
+    // put the triangles of each leaf next to each other
+    std::vector<std::uint32_t> orderedIds;
+    orderedIds.reserve(count);
+    for (auto& primitive : buildPrimitives)
+        orderedIds.push_back(primitive.index);
+
+    buildPrimitives.clear();
+    buildPrimitives.shrink_to_fit();
+
+    addLeafBlocks(orderedIds);
+}
+
+void
+BoundingVolumeHierarchy::addLeafBlocks(
+  const std::vector<std::uint32_t>& orderedIds)
+{
+    blocks.clear();
+    primitiveIds.clear();
+    for (auto& node : nodes) {
+        if (node.primitiveCount)
+            node.primitiveOffset = addBlocks(
+              orderedIds, node.primitiveOffset, node.primitiveCount);
+    }
+    useOwnedBlocks();
+
+    // the cost of a wide tree is measured on the collapsed nodes, since
+    // refitting works on them
+    if (width == BVH_DEFAULT_WIDTH) {
+        builtCost = treeCost();
+        compressNodes();
+    } else {
+        compressNodes();
+        builtCost = treeCost();
+    }
+}
+
+void
+BoundingVolumeHierarchy::compressNodes()
+{
+    rootNode = nodes[0];
+    nodes8.clear();
+    nodes16.clear();
+    wideNodes4.clear();
+    wideNodes8.clear();
+    if (width == 4)
+        collapseNodes(wideNodes4);
+    else if (width == 8)
+        collapseNodes(wideNodes8);
+    else if (nodeBits == 8)
+        quantizeNodes(nodes, nodes8);
+    else if (nodeBits == 16)
+        quantizeNodes(nodes, nodes16);
+    nodeData8 = nodes8.data();
+    nodeData16 = nodes16.data();
+    wideNodeData4 = wideNodes4.data();
+    wideNodeData8 = wideNodes8.data();
+
+    if (nodeBits != BVH_FULL_NODE_BITS || width != BVH_DEFAULT_WIDTH) {
+        nodes.clear();
+        nodes.shrink_to_fit();
+    }
+    nodeData = nodes.data();
+}
+
+template<int Width>
+void
+BoundingVolumeHierarchy::collapseNodes(
+  std::vector<WideBVHNode<Width>>& output) const
+{
+    output.clear();
+    if (nodes[0].primitiveCount || nodes.size() == 1) {
+        // the whole tree is a single leaf, which is empty if there are no
+        // triangles
+        output.emplace_back();
+        output[0].clear();
+        if (nodes[0].primitiveCount) {
+            output[0].childCount = 1;
+            output[0].setBounds(0, nodes[0].getBounds());
+            output[0].childOffset[0] = nodes[0].primitiveOffset;
+            output[0].primitiveCount[0] = nodes[0].primitiveCount;
+        }
+        return;
+    }
+
+    // every wide node replaces at least one binary interior node
+    output.reserve(nodes.size() / 2);
+    collapseNode(0, output);
+    output.shrink_to_fit();
+}
+
+template<int Width>
+int
+BoundingVolumeHierarchy::collapseNode(
+  int nodeIndex,
+  std::vector<WideBVHNode<Width>>& output) const
+{
+    int children[Width] = { nodeIndex + 1,
+                            int(nodes[nodeIndex].secondChildOffset) };
+    int childCount = 2;
+    while (childCount < Width) {
+        // the child with the largest box is the most likely to be hit, so it
+        // saves the most node visits to test its children directly
+        int largest = -1;
+        FloatT largestArea = -1;
+        for (int i = 0; i < childCount; i++) {
+            auto& child = nodes[children[i]];
+            FloatT area = child.getBounds().surfaceArea();
+            if (!child.primitiveCount && area > largestArea) {
+                largest = i;
+                largestArea = area;
+            }
+        }
+        if (largest == -1)
+            break;
+
+        int opened = children[largest];
+        children[largest] = opened + 1;
+        children[childCount++] = nodes[opened].secondChildOffset;
+    }
+
+    int wideIndex = output.size();
+    output.emplace_back();
+    output[wideIndex].clear();
+    output[wideIndex].childCount = childCount;
+    for (int i = 0; i < childCount; i++) {
+        auto& child = nodes[children[i]];
+        int offset = child.primitiveOffset;
+        if (!child.primitiveCount)
+            offset = collapseNode(children[i], output);
+
+        // don't keep a reference to the wide node while collapsing children,
+        // the vector may be reallocated
+        auto& wideNode = output[wideIndex];
+        wideNode.setBounds(i, child.getBounds());
+        wideNode.childOffset[i] = offset;
+        wideNode.primitiveCount[i] = child.primitiveCount;
+    }
+    return wideIndex;
+}
+
+void
+BoundingVolumeHierarchy::decompressNodes()
+{
+    std::size_t count = std::max(nodes8.size(), nodes16.size());
+    nodes.resize(count);
+    for (std::size_t i = 0; i < count; i++) {
+        // any box will do, only offsets and counts are needed
+        nodes[i] = nodeBits == 8 ? nodes8[i].decode(rootNode)
+                                 : nodes16[i].decode(rootNode);
+    }
 }
 
+bool
+BoundingVolumeHierarchy::refitStructure()
+{
+    // a tree loaded from a cache file is read-only
+    if (cacheFile)
+        return false;
+
+    createBoundingBox();
+    if (width != BVH_DEFAULT_WIDTH) {
+        // wide nodes are refit in place, the binary tree is gone
+        if (width == 4)
+            refitWideNodes(wideNodes4);
+        else
+            refitWideNodes(wideNodes8);
+        return treeCost() <= rebuildThreshold * builtCost;
+    }
+    if (nodeBits != BVH_FULL_NODE_BITS)
+        decompressNodes();
+
+    // children come after their parents in the array, so going backwards
+    // visits both children of a node before the node itself
+    for (int i = nodes.size() - 1; i >= 0; i--) {
+        auto& node = nodes[i];
+        AxisAlignedBox box;
+        if (node.primitiveCount)
+            box = refitLeaf(node.primitiveOffset, node.primitiveCount);
+        else if (nodes.size() > 1) {
+            box = nodes[i + 1].getBounds();
+            box.extend(nodes[node.secondChildOffset].getBounds());
+        }
+        node.setBounds(box);
+    }
+
+    bool good = treeCost() <= rebuildThreshold * builtCost;
+    compressNodes();
+    return good;
+}
+
+template<int Width>
 void
-BoundingVolumeHierarchy::build(std::vector<Objects::Triangle>&& triangles)
+BoundingVolumeHierarchy::refitWideNodes(
+  std::vector<WideBVHNode<Width>>& wideNodes)
 {
-    createBoundingBox(triangles);
+    // as in the binary tree, going backwards visits the children of a node
+    // before the node itself
+    for (int i = wideNodes.size() - 1; i >= 0; i--) {
+        auto& node = wideNodes[i];
+        for (int slot = 0; slot < node.childCount; slot++) {
+            auto box =
+              node.primitiveCount[slot]
+                ? refitLeaf(node.childOffset[slot], node.primitiveCount[slot])
+                : wideNodes[node.childOffset[slot]].getBounds();
+            node.setBounds(slot, box);
+        }
+    }
+    rootNode.setBounds(wideNodes[0].getBounds());
+}
 
-    if (triangles.size() <= BVH_BRUTE_FORCE_THRESHOLD) {
-        BruteForce::build(std::move(triangles));
+AxisAlignedBox
+BoundingVolumeHierarchy::refitLeaf(std::uint32_t blockOffset,
+                                   int primitiveCount)
+{
+    AxisAlignedBox box;
+    int first = blockOffset * TriangleBlock::width;
+    for (int j = 0; j < primitiveCount; j++) {
+        auto triangle = geometry->getTriangle(primitiveIds[first + j]);
+        box.extend(AxisAlignedBox(triangle));
+        blocks[blockOffset + j / TriangleBlock::width].set(
+          j % TriangleBlock::width, PrecomputedTriangle(triangle));
+    }
+    return box;
+}
+
+void
+BoundingVolumeHierarchy::collectStats(AccelerationStructureStats& stats) const
+{
+    if (width != BVH_DEFAULT_WIDTH) {
+        FloatT area = rootNode.getBounds().surfaceArea();
+        // without triangles, the root is a leaf with no primitives
+        if (rootNode.primitiveCount || !geometry->getTriangleCount())
+            stats.addLeaf(0, area, rootNode.primitiveCount);
+        else {
+            stats.addInterior(0, area);
+            if (width == 4)
+                collectWideNodeStats(wideNodeData4, 0, 0, stats);
+            else
+                collectWideNodeStats(wideNodeData8, 0, 0, stats);
+        }
         return;
     }
 
+    switch (nodeBits) {
+        case 8:
+            collectNodeStats(QuantizedNodeArray<std::uint8_t>{ nodeData8 },
+                             0,
+                             rootNode,
+                             0,
+                             stats);
+            break;
+        case 16:
+            collectNodeStats(QuantizedNodeArray<std::uint16_t>{ nodeData16 },
+                             0,
+                             rootNode,
+                             0,
+                             stats);
+            break;
+        default:
+            collectNodeStats(FullNodeArray{ nodeData }, 0, rootNode, 0, stats);
+    }
+}
+
+std::uint64_t
+BoundingVolumeHierarchy::getCacheSettingsHash() const
+{
+    CacheKeyHasher hasher;
+    hasher.add("bvh", 3);
+    hasher.add(nodeBits);
+    hasher.add(width);
+    return hasher.getValue();
+}
+
+std::vector<CacheSection>
+BoundingVolumeHierarchy::getCacheSections() const
+{
+    CacheSection nodeSection = { nodes.data(),
+                                 nodes.size() * sizeof(LinearBVHNode) };
+    if (nodeBits == 8)
+        nodeSection = {
+            nodes8.data(),
+            nodes8.size() * sizeof(QuantizedBVHNode<std::uint8_t>)
+        };
+    else if (nodeBits == 16)
+        nodeSection = {
+            nodes16.data(),
+            nodes16.size() * sizeof(QuantizedBVHNode<std::uint16_t>)
+        };
+    if (width == 4)
+        nodeSection = { wideNodes4.data(),
+                        wideNodes4.size() * sizeof(WideBVHNode<4>) };
+    else if (width == 8)
+        nodeSection = { wideNodes8.data(),
+                        wideNodes8.size() * sizeof(WideBVHNode<8>) };
+    return { nodeSection,
+             { blocks.data(), blocks.size() * sizeof(TriangleBlock) },
+             { primitiveIds.data(),
+               primitiveIds.size() * sizeof(std::uint32_t) },
+             { &builtCost, sizeof(builtCost) },
+             { &rootNode, sizeof(rootNode) } };
+}
+
+bool
+BoundingVolumeHierarchy::loadCacheSections(
+  const std::vector<CacheSection>& sections,
+  std::shared_ptr<const MappedFile> file)
+{
+    if (sections.size() != 5 || sections[3].size != sizeof(FloatT) ||
+        sections[4].size != sizeof(LinearBVHNode) ||
+        sections[1].size % sizeof(TriangleBlock) ||
+        sections[2].size !=
+          sections[1].size / sizeof(TriangleBlock) * TriangleBlock::width *
+            sizeof(std::uint32_t))
+        return false;
+
+    auto& root = *static_cast<const LinearBVHNode*>(sections[4].data);
+    auto loadedIds = static_cast<const std::uint32_t*>(sections[2].data);
+    std::size_t blockCount = sections[1].size / sizeof(TriangleBlock);
+    bool valid;
+    if (width == 4)
+        valid = validWideNodes<4>(sections[0], blockCount);
+    else if (width == 8)
+        valid = validWideNodes<8>(sections[0], blockCount);
+    else if (nodeBits == 8)
+        valid = validNodes<QuantizedBVHNode<std::uint8_t>>(
+          sections[0], blockCount, root);
+    else if (nodeBits == 16)
+        valid = validNodes<QuantizedBVHNode<std::uint16_t>>(
+          sections[0], blockCount, root);
+    else
+        valid = validNodes<LinearBVHNode>(sections[0], blockCount, root);
+    if (!valid)
+        return false;
+    for (std::size_t i = 0; i < blockCount * TriangleBlock::width; i++) {
+        if (loadedIds[i] >= geometry->getTriangleCount())
+            return false;
+    }
+
+    createBoundingBox();
+    nodes.clear();
+    nodes.shrink_to_fit();
+    blocks.clear();
+    blocks.shrink_to_fit();
+    primitiveIds.clear();
+    primitiveIds.shrink_to_fit();
+    nodes8.clear();
+    nodes8.shrink_to_fit();
+    nodes16.clear();
+    nodes16.shrink_to_fit();
+    wideNodes4.clear();
+    wideNodes4.shrink_to_fit();
+    wideNodes8.clear();
+    wideNodes8.shrink_to_fit();
+    nodeData = static_cast<const LinearBVHNode*>(sections[0].data);
+    nodeData8 =
+      static_cast<const QuantizedBVHNode<std::uint8_t>*>(sections[0].data);
+    nodeData16 =
+      static_cast<const QuantizedBVHNode<std::uint16_t>*>(sections[0].data);
+    wideNodeData4 = static_cast<const WideBVHNode<4>*>(sections[0].data);
+    wideNodeData8 = static_cast<const WideBVHNode<8>*>(sections[0].data);
+    rootNode = root;
+    blockData = static_cast<const TriangleBlock*>(sections[1].data);
+    blockDataSize = blockCount;
+    idData = loadedIds;
+    builtCost = *static_cast<const FloatT*>(sections[3].data);
+    cacheFile = std::move(file);
+    return true;
+}
+
+FloatT
+BoundingVolumeHierarchy::treeCost() const
+{
+    if (width == 4)
+        return wideTreeCost(wideNodes4);
+    if (width == 8)
+        return wideTreeCost(wideNodes8);
+
+    FloatT cost = 0;
+    for (auto& node : nodes) {
+        FloatT area = node.getBounds().surfaceArea();
+        if (node.primitiveCount)
+            cost += area * node.primitiveCount;
+        else
+            cost += area;
+    }
+    FloatT rootArea = nodes[0].getBounds().surfaceArea();
+    return rootArea > 0 ? cost / rootArea : cost;
+}
+
+int
+BoundingVolumeHierarchy::buildNode(int begin,
+                                   int end,
+                                   std::vector<LinearBVHNode>& output)
+{
+    auto bounds = rangeBounds(begin, end);
+
+    int nodeIndex = output.size();
+    output.emplace_back();
+    output[nodeIndex].setBounds(bounds);
+
+    int middle, axis = 0;
+    bool divided = split(begin, end, bounds, middle, axis);
+
+    constexpr int maxLeafSize =
+      std::numeric_limits<decltype(LinearBVHNode::primitiveCount)>::max();
+    if (!divided && end - begin > maxLeafSize) {
+        // too many triangles to fit in a leaf. split() must have failed, so
+        // the division doesn't matter much
+        middle = (begin + end) / 2;
+        divided = true;
+    }
+
+    if (!divided) {
+        // replaced with the index of the first block at the end of build()
+        output[nodeIndex].primitiveOffset = begin;
+        output[nodeIndex].primitiveCount = end - begin;
+        output[nodeIndex].axis = 0;
+        return nodeIndex;
+    }
+
+    int secondChild;
+    if (end - begin >= BVH_PARALLEL_BUILD_THRESHOLD) {
+        // build the second child on another thread. it gets its own node
+        // array since we don't know the size of the first child yet
+        auto& pool = ThreadPool::shared();
+        std::vector<LinearBVHNode> secondNodes;
+        auto future =
+          pool.submit([&] { buildNode(middle, end, secondNodes); });
+        buildNode(begin, middle, output);
+        pool.wait(future);
+
+        secondChild = output.size();
+        for (auto node : secondNodes) {
+            if (!node.primitiveCount)
+                node.secondChildOffset += secondChild;
+            output.push_back(node);
+        }
+    } else {
+        // first child is the next node in the array, no need to save its index
+        buildNode(begin, middle, output);
+        secondChild = buildNode(middle, end, output);
+    }
+
+    // don't keep a reference to the node before building children, the vector
+    // may be reallocated
+    output[nodeIndex].secondChildOffset = secondChild;
+    output[nodeIndex].primitiveCount = 0;
+    output[nodeIndex].axis = axis;
+    return nodeIndex;
+}
+
+AxisAlignedBox
+BoundingVolumeHierarchy::rangeBounds(int begin, int end) const
+{
+    int chunkCount = buildChunkCount(end - begin);
+    std::vector<AxisAlignedBox> chunkBounds(chunkCount);
+    ThreadPool::shared().parallelFor(
+      begin, end, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++)
+              chunkBounds[chunk].extend(buildPrimitives[i].box);
+      });
+
+    AxisAlignedBox bounds;
+    for (auto& box : chunkBounds)
+        bounds.extend(box);
+    return bounds;
+}
+
+int
+BoundingVolumeHierarchy::partition(
+  int begin,
+  int end,
+  const std::function<bool(const BuildPrimitive&)>& isLow)
+{
+    int chunkCount = buildChunkCount(end - begin);
+    if (chunkCount == 1) {
+        // stable, so that the tree doesn't depend on the number of threads
+        auto middle = std::stable_partition(buildPrimitives.begin() + begin,
+                                            buildPrimitives.begin() + end,
+                                            isLow);
+        return middle - buildPrimitives.begin();
+    }
+
+    // count the low primitives in each chunk, then every chunk knows where to
+    // write its primitives in a scratch array
+    auto& pool = ThreadPool::shared();
+    std::vector<int> chunkBegins(chunkCount), lowCounts(chunkCount);
+    pool.parallelFor(
+      begin, end, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          chunkBegins[chunk] = chunkBegin;
+          for (int i = chunkBegin; i < chunkEnd; i++)
+              lowCounts[chunk] += isLow(buildPrimitives[i]);
+      });
+
+    std::vector<int> lowOffsets(chunkCount), highOffsets(chunkCount);
+    int lowTotal = 0;
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        lowOffsets[chunk] = lowTotal;
+        lowTotal += lowCounts[chunk];
+    }
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        // number of high primitives before this chunk
+        highOffsets[chunk] =
+          lowTotal + chunkBegins[chunk] - begin - lowOffsets[chunk];
+    }
+
+    std::vector<BuildPrimitive> scratch(end - begin);
+    pool.parallelFor(
+      begin, end, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          int low = lowOffsets[chunk], high = highOffsets[chunk];
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              if (isLow(buildPrimitives[i]))
+                  scratch[low++] = buildPrimitives[i];
+              else
+                  scratch[high++] = buildPrimitives[i];
+          }
+      });
+    pool.parallelFor(
+      0, end - begin, chunkCount, [&](int, int chunkBegin, int chunkEnd) {
+          std::copy(scratch.begin() + chunkBegin,
+                    scratch.begin() + chunkEnd,
+                    buildPrimitives.begin() + begin + chunkBegin);
+      });
+    return begin + lowTotal;
+}
+
+int
+BoundingVolumeHierarchy::buildChunkCount(int primitiveCount)
+{
+    if (primitiveCount < BVH_PARALLEL_BUILD_THRESHOLD)
+        return 1;
+    return ThreadPool::shared().getThreadCount();
+}
+
+bool
+BoundingVolumeHierarchy::split(int begin,
+                               int end,
+                               const AxisAlignedBox& bounds,
+                               int& middle,
+                               int& axis)
+{
+    if (end - begin <= BVH_BRUTE_FORCE_THRESHOLD)
+        return false;
+
     // divide on longest side of the bounding box
-    FloatT xLen = xMax - xMin;
-    FloatT yLen = yMax - yMin;
-    FloatT zLen = zMax - zMin;
-    FloatT middle;
+    auto lengths = bounds.max - bounds.min;
 
     // we invert this variable each time we see a triangle in the middle,
     // so that they are divided evenly. I want to divide them evenly because
@@ -35,141 +1067,357 @@ BoundingVolumeHierarchy::build(std::vector<Objects::Triangle>&& triangles)
     // least makes the tree balanced.
     bool toLeft = false;
 
+    std::vector<BuildPrimitive> lowPrimitives, highPrimitives;
+
     // we choose the longest axis, but if it results in a bad division, we
     // will try other axes before switching to brute force. hence the for loop
     for (int i = 0; i < 3; i++) {
-        std::vector<Objects::Triangle> lowTriangles, highTriangles;
-
-        if (xLen > yLen && xLen > zLen) {
-            // divide on x
-            middle = (xMin + xMax) / 2;
-            for (auto& triangle : triangles) {
-                if (triangle.v1.x < middle && triangle.v2.x < middle &&
-                    triangle.v3.x < middle)
-                    lowTriangles.push_back(triangle);
-                else if (triangle.v1.x > middle && triangle.v2.x > middle &&
-                         triangle.v3.x > middle)
-                    highTriangles.push_back(triangle);
-                else {
-                    if (toLeft)
-                        lowTriangles.push_back(triangle);
-                    else
-                        highTriangles.push_back(triangle);
-                    toLeft = !toLeft;
-                }
+        lowPrimitives.clear();
+        highPrimitives.clear();
+
+        if (lengths.x > lengths.y && lengths.x > lengths.z)
+            axis = 0;
+        else if (lengths.y > lengths.z)
+            axis = 1;
+        else
+            axis = 2;
+
+        FloatT splitPlane = (bounds.min[axis] + bounds.max[axis]) / 2;
+        for (int j = begin; j < end; j++) {
+            auto& primitive = buildPrimitives[j];
+            if (primitive.box.max[axis] < splitPlane)
+                lowPrimitives.push_back(primitive);
+            else if (primitive.box.min[axis] > splitPlane)
+                highPrimitives.push_back(primitive);
+            else {
+                if (toLeft)
+                    lowPrimitives.push_back(primitive);
+                else
+                    highPrimitives.push_back(primitive);
+                toLeft = !toLeft;
             }
-            // for the next iteration
-            xLen = 0;
-        } else if (yLen > zLen) {
-            // divide on y
-            middle = (yMin + yMax) / 2;
-            for (auto& triangle : triangles) {
-                if (triangle.v1.y < middle && triangle.v2.y < middle &&
-                    triangle.v3.y < middle)
-                    lowTriangles.push_back(triangle);
-                else if (triangle.v1.y > middle && triangle.v2.y > middle &&
-                         triangle.v3.y > middle)
-                    highTriangles.push_back(triangle);
-                else {
-                    if (toLeft)
-                        lowTriangles.push_back(triangle);
-                    else
-                        highTriangles.push_back(triangle);
-                    toLeft = !toLeft;
+        }
+        // for the next iteration
+        lengths[axis] = 0;
+
+        if (lowPrimitives.size() && highPrimitives.size()) {
+            middle = begin + lowPrimitives.size();
+            std::copy(lowPrimitives.begin(),
+                      lowPrimitives.end(),
+                      &buildPrimitives[begin]);
+            std::copy(highPrimitives.begin(),
+                      highPrimitives.end(),
+                      &buildPrimitives[middle]);
+            return true;
+        }
+    }
+
+    bruteForceLeafCount++;
+    bruteForceTriangleCount += end - begin;
+    return false;
+}
+
+template<typename NodeArray>
+int
+BoundingVolumeHierarchy::intersectNode(const NodeArray& nodeArray,
+                                       int nodeIndex,
+                                       const LinearBVHNode& node,
+                                       const TraversalRay& ray,
+                                       FloatT& tMax) const
+{
+    using Handle = typename NodeArray::Handle;
+    TraversalEntry<Handle> stack[BVH_TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    int closest = -1;
+    Handle current = NodeArray::handle(node);
+    while (true) {
+        auto& currentNode = NodeArray::get(current);
+        if (currentNode.primitiveCount) {
+            int hit = closestInRange(
+              ray.ray,
+              tMax,
+              currentNode.primitiveOffset,
+              TriangleBlock::blockCount(currentNode.primitiveCount));
+            if (hit != -1)
+                closest = hit;
+        } else {
+            int left = nodeIndex + 1;
+            int right = currentNode.secondChildOffset;
+            Handle leftNode = nodeArray.child(left, currentNode);
+            Handle rightNode = nodeArray.child(right, currentNode);
+            FloatT tLeft =
+              intersectNodeBox(NodeArray::get(leftNode), ray, tMax);
+            FloatT tRight =
+              intersectNodeBox(NodeArray::get(rightNode), ray, tMax);
+
+            if (tLeft != -1 && tRight != -1) {
+                // visit the closer child now and the other one later
+                bool leftFirst = tLeft <= tRight;
+                int far = leftFirst ? right : left;
+                const Handle& farNode = leftFirst ? rightNode : leftNode;
+                if (stackSize == BVH_TRAVERSAL_STACK_SIZE) {
+                    // the tree is deeper than the stack, search the farther
+                    // child right away
+                    int hit = intersectNode(
+                      nodeArray, far, NodeArray::get(farNode), ray, tMax);
+                    if (hit != -1)
+                        closest = hit;
+                } else {
+                    FloatT tFar = std::max(tLeft, tRight);
+                    stack[stackSize++] = { farNode, far, tFar };
                 }
+                nodeIndex = leftFirst ? left : right;
+                current = leftFirst ? leftNode : rightNode;
+                continue;
+            }
+            if (tLeft != -1) {
+                nodeIndex = left;
+                current = leftNode;
+                continue;
             }
-            // for the next iteration
-            yLen = 0;
+            if (tRight != -1) {
+                nodeIndex = right;
+                current = rightNode;
+                continue;
+            }
+        }
+
+        // skip the nodes that are entered after the closest hit
+        while (stackSize && stack[stackSize - 1].t >= tMax)
+            stackSize--;
+        if (!stackSize)
+            return closest;
+        stackSize--;
+        nodeIndex = stack[stackSize].index;
+        current = stack[stackSize].node;
+    }
+}
+
+template<typename NodeArray>
+bool
+BoundingVolumeHierarchy::occludedNode(const NodeArray& nodeArray,
+                                      int nodeIndex,
+                                      const LinearBVHNode& node,
+                                      const TraversalRay& ray,
+                                      FloatT tMax) const
+{
+    using Handle = typename NodeArray::Handle;
+    TraversalEntry<Handle> stack[BVH_TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    Handle current = NodeArray::handle(node);
+    while (true) {
+        auto& currentNode = NodeArray::get(current);
+        if (currentNode.primitiveCount) {
+            if (occludedRange(
+                  ray.ray,
+                  tMax,
+                  currentNode.primitiveOffset,
+                  TriangleBlock::blockCount(currentNode.primitiveCount)))
+                return true;
         } else {
-            // divide on z
-            middle = (zMin + zMax) / 2;
-            for (auto& triangle : triangles) {
-                if (triangle.v1.z < middle && triangle.v2.z < middle &&
-                    triangle.v3.z < middle)
-                    lowTriangles.push_back(triangle);
-                else if (triangle.v1.z > middle && triangle.v2.z > middle &&
-                         triangle.v3.z > middle)
-                    highTriangles.push_back(triangle);
-                else {
-                    if (toLeft)
-                        lowTriangles.push_back(triangle);
-                    else
-                        highTriangles.push_back(triangle);
-                    toLeft = !toLeft;
+            // any hit is enough, so the children are not sorted by distance
+            int left = nodeIndex + 1;
+            int right = currentNode.secondChildOffset;
+            Handle leftNode = nodeArray.child(left, currentNode);
+            Handle rightNode = nodeArray.child(right, currentNode);
+            FloatT tLeft =
+              intersectNodeBox(NodeArray::get(leftNode), ray, tMax);
+            FloatT tRight =
+              intersectNodeBox(NodeArray::get(rightNode), ray, tMax);
+
+            if (tRight != -1) {
+                if (tLeft == -1) {
+                    nodeIndex = right;
+                    current = rightNode;
+                    continue;
                 }
+                if (stackSize == BVH_TRAVERSAL_STACK_SIZE) {
+                    if (occludedNode(nodeArray,
+                                     right,
+                                     NodeArray::get(rightNode),
+                                     ray,
+                                     tMax))
+                        return true;
+                } else
+                    stack[stackSize++] = { rightNode, right, tRight };
+            }
+            if (tLeft != -1) {
+                nodeIndex = left;
+                current = leftNode;
+                continue;
             }
-            // for the next iteration
-            zLen = 0;
-        }
-        if (lowTriangles.size() && highTriangles.size()) {
-            left = std::make_unique<BoundingVolumeHierarchy>();
-            right = std::make_unique<BoundingVolumeHierarchy>();
-            left->build(std::move(lowTriangles));
-            right->build(std::move(highTriangles));
-            break;
         }
-    }
-    if (!left) {
-        std::cout << "Switched to brute force with " << triangles.size()
-                  << " triangles\n";
-        BruteForce::build(std::move(triangles));
+
+        if (!stackSize)
+            return false;
+        stackSize--;
+        nodeIndex = stack[stackSize].index;
+        current = stack[stackSize].node;
     }
 }
 
-FloatT
-BoundingVolumeHierarchy::intersectTriangle(const Objects::Ray& ray,
-                                           LinearAlgebra::Vec3& normalOut) const
+template<int Width>
+int
+BoundingVolumeHierarchy::intersectWideNode(
+  const WideBVHNode<Width>* wideNodes,
+  int nodeIndex,
+  const TraversalRay& ray,
+  FloatT& tMax) const
 {
-    if (!left && !right)
-        return BruteForce::intersect(ray, normalOut);
-
-    FloatT tLeft = left ? left->intersectBoundingBox(ray) : -1;
-    FloatT tRight = right ? right->intersectBoundingBox(ray) : -1;
+    WideTraversalEntry stack[BVH_TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    int closest = -1;
+    WideTraversalEntry current = { std::uint32_t(nodeIndex), 0, 0 };
+    while (true) {
+        if (current.primitiveCount) {
+            int hit =
+              closestInRange(ray.ray,
+                             tMax,
+                             current.offset,
+                             TriangleBlock::blockCount(current.primitiveCount));
+            if (hit != -1)
+                closest = hit;
+        } else {
+            auto& node = wideNodes[current.offset];
+            alignas(32) FloatT tChildren[Width];
+            int mask = intersectChildBoxes(node, ray, tMax, tChildren);
+            if (mask) {
+                // sort the children that are hit near to far
+                int order[Width];
+                int count = 0;
+                for (int slot = 0; slot < Width; slot++) {
+                    if (!(mask >> slot & 1))
+                        continue;
+                    int i = count++;
+                    for (; i && tChildren[order[i - 1]] > tChildren[slot]; i--)
+                        order[i] = order[i - 1];
+                    order[i] = slot;
+                }
 
-    // didn't hit one of the boxes
-    if (tLeft == -1 && tRight == -1)
-        return -1;
-    if (tLeft == -1)
-        return right->intersectTriangle(ray, normalOut);
-    if (tRight == -1)
-        return left->intersectTriangle(ray, normalOut);
-
-    // hit both boxes
-    // test the closer box first
-    LinearAlgebra::Vec3 normalLeft, normalRight;
-    FloatT tLeftTriangle, tRightTriangle;
-    if (tLeft < tRight) {
-        // left box is closer
-        tLeftTriangle = left->intersectTriangle(ray, normalLeft);
-        if (tLeftTriangle == -1)
-            return right->intersectTriangle(ray, normalOut);
-        if (tLeftTriangle <= tRight) {
-            normalOut = normalLeft;
-            return tLeftTriangle;
-        }
-        tRightTriangle = right->intersectTriangle(ray, normalRight);
-        if (tRightTriangle == -1 || tLeftTriangle < tRightTriangle) {
-            normalOut = normalLeft;
-            return tLeftTriangle;
-        }
-        normalOut = normalRight;
-        return tRightTriangle;
-    } else {
-        // right box is closer
-        tRightTriangle = right->intersectTriangle(ray, normalRight);
-        if (tRightTriangle == -1)
-            return left->intersectTriangle(ray, normalOut);
-        if (tRightTriangle <= tLeft) {
-            normalOut = normalRight;
-            return tRightTriangle;
+                // visit the closest child now and the others later, pushed
+                // far to near so that the nearer ones are popped first
+                for (int i = count - 1; i > 0; i--) {
+                    int slot = order[i];
+                    WideTraversalEntry entry = { node.childOffset[slot],
+                                                 node.primitiveCount[slot],
+                                                 tChildren[slot] };
+                    if (stackSize < BVH_TRAVERSAL_STACK_SIZE) {
+                        stack[stackSize++] = entry;
+                        continue;
+                    }
+                    // the stack is full, search the child right away
+                    int hit =
+                      entry.primitiveCount
+                        ? closestInRange(
+                            ray.ray,
+                            tMax,
+                            entry.offset,
+                            TriangleBlock::blockCount(entry.primitiveCount))
+                        : intersectWideNode(wideNodes, entry.offset, ray, tMax);
+                    if (hit != -1)
+                        closest = hit;
+                }
+                current = { node.childOffset[order[0]],
+                            node.primitiveCount[order[0]],
+                            tChildren[order[0]] };
+                continue;
+            }
         }
-        tLeftTriangle = left->intersectTriangle(ray, normalLeft);
-        if (tLeftTriangle == -1 || tRightTriangle < tLeftTriangle) {
-            normalOut = normalRight;
-            return tRightTriangle;
+
+        // skip the children that are entered after the closest hit
+        while (stackSize && stack[stackSize - 1].t >= tMax)
+            stackSize--;
+        if (!stackSize)
+            return closest;
+        current = stack[--stackSize];
+    }
+}
+
+template<int Width>
+bool
+BoundingVolumeHierarchy::occludedWideNode(
+  const WideBVHNode<Width>* wideNodes,
+  int nodeIndex,
+  const TraversalRay& ray,
+  FloatT tMax) const
+{
+    WideTraversalEntry stack[BVH_TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    WideTraversalEntry current = { std::uint32_t(nodeIndex), 0, 0 };
+    while (true) {
+        if (current.primitiveCount) {
+            if (occludedRange(
+                  ray.ray,
+                  tMax,
+                  current.offset,
+                  TriangleBlock::blockCount(current.primitiveCount)))
+                return true;
+        } else {
+            // any hit is enough, so the children are not sorted by distance
+            auto& node = wideNodes[current.offset];
+            alignas(32) FloatT tChildren[Width];
+            int mask = intersectChildBoxes(node, ray, tMax, tChildren);
+            int first = -1;
+            for (int slot = 0; slot < Width; slot++) {
+                if (!(mask >> slot & 1))
+                    continue;
+                if (first == -1) {
+                    first = slot;
+                    continue;
+                }
+                WideTraversalEntry entry = { node.childOffset[slot],
+                                             node.primitiveCount[slot],
+                                             tChildren[slot] };
+                if (stackSize < BVH_TRAVERSAL_STACK_SIZE)
+                    stack[stackSize++] = entry;
+                else if (entry.primitiveCount
+                           ? occludedRange(
+                               ray.ray,
+                               tMax,
+                               entry.offset,
+                               TriangleBlock::blockCount(entry.primitiveCount))
+                           : occludedWideNode(
+                               wideNodes, entry.offset, ray, tMax))
+                    return true;
+            }
+            if (first != -1) {
+                current = { node.childOffset[first],
+                            node.primitiveCount[first],
+                            tChildren[first] };
+                continue;
+            }
         }
-        normalOut = normalLeft;
-        return tLeftTriangle;
+
+        if (!stackSize)
+            return false;
+        current = stack[--stackSize];
     }
 }
-}
\ No newline at end of file
+
+template<typename NodeArray>
+void
+BoundingVolumeHierarchy::collectNodeStats(
+  const NodeArray& nodeArray,
+  int nodeIndex,
+  const LinearBVHNode& node,
+  int depth,
+  AccelerationStructureStats& stats) const
+{
+    FloatT area = node.getBounds().surfaceArea();
+    // without triangles, the root is a leaf with no primitives
+    if (node.primitiveCount || !geometry->getTriangleCount()) {
+        stats.addLeaf(depth, area, node.primitiveCount);
+        return;
+    }
+    stats.addInterior(depth, area);
+
+    int left = nodeIndex + 1;
+    int right = node.secondChildOffset;
+    auto leftNode = nodeArray.child(left, node);
+    auto rightNode = nodeArray.child(right, node);
+    collectNodeStats(
+      nodeArray, left, NodeArray::get(leftNode), depth + 1, stats);
+    collectNodeStats(
+      nodeArray, right, NodeArray::get(rightNode), depth + 1, stats);
+}
+}
@@ -11,22 +11,284 @@
 
 #pragma once
 
+#include "AccelerationStructureConstants.hpp"
+#include "AxisAlignedBox.hpp"
 #include "BoundingBox.hpp"
 #include "BruteForce.hpp"
-#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
 
 namespace AccelerationStructures {
+/**
+ * @brief Node of a bounding volume hierarchy, stored in a flat array
+ *
+ * Nodes are stored in depth-first order. First child of an interior node is
+ * the next node in the array, so only the index of the second child is stored.
+ * Leaves store a range of the primitive array instead.
+ *
+ * Bounds are always floats, so that a node fits in 32 bytes (half a cache
+ * line) even if FloatT is double.
+ *
+ */
+struct LinearBVHNode
+{
+    /**
+     * @name Limits
+     *
+     */
+    ///@{
+    /**
+     * @brief Coordinates of the bounding box of this node
+     *
+     */
+    float xMin, xMax, yMin, yMax, zMin, zMax;
+    ///@}
+
+    union
+    {
+        /**
+         * @brief Index of the first triangle block of a leaf
+         *
+         */
+        std::uint32_t primitiveOffset;
+
+        /**
+         * @brief Index of the second child of an interior node
+         *
+         */
+        std::uint32_t secondChildOffset;
+    };
+
+    /**
+     * @brief Number of triangles in a leaf. 0 for interior nodes.
+     *
+     */
+    std::uint16_t primitiveCount;
+
+    /**
+     * @brief Axis that interior node was divided on. 0, 1 or 2 for x, y, z.
+     *
+     */
+    std::uint8_t axis;
+
+    /**
+     * @brief Unused, makes the size a multiple of 8 bytes explicitly
+     *
+     */
+    std::uint8_t padding;
+
+    /**
+     * @brief Bounding box of this node
+     *
+     * @return AxisAlignedBox
+     */
+    AxisAlignedBox getBounds() const;
+
+    /**
+     * @brief Sets the bounding box of this node
+     *
+     * @param box
+     */
+    void setBounds(const AxisAlignedBox& box);
+};
+
+static_assert(sizeof(LinearBVHNode) == 32, "BVH nodes should be 32 bytes");
+
+/**
+ * @brief Node of a bounding volume hierarchy whose bounding box is quantized
+ * relative to the box of its parent
+ *
+ * Each axis of the parent box is divided into 2^bits - 1 equal steps. Minimum
+ * coordinates are stored as the number of steps from the parent's minimum,
+ * maximum coordinates as the number of steps from the parent's maximum.
+ * Decoded boxes are rounded outwards, so they always contain the original
+ * box, and a ray that hits the original box hits the decoded box too.
+ *
+ * Children are quantized relative to the decoded box of their parent, so the
+ * boxes are decoded top-down during traversal, starting with a full precision
+ * root. The bounds of the root node itself are not used.
+ *
+ * @tparam T std::uint8_t or std::uint16_t
+ */
+template<typename T>
+struct QuantizedBVHNode
+{
+    union
+    {
+        /**
+         * @brief Index of the first triangle block of a leaf
+         *
+         */
+        std::uint32_t primitiveOffset;
+
+        /**
+         * @brief Index of the second child of an interior node
+         *
+         */
+        std::uint32_t secondChildOffset;
+    };
+
+    /**
+     * @brief Number of triangles in a leaf. 0 for interior nodes.
+     *
+     */
+    std::uint16_t primitiveCount;
+
+    /**
+     * @name Quantized limits
+     *
+     */
+    ///@{
+    /**
+     * @brief Steps from the parent's limits, for x, y and z
+     *
+     */
+    T min[3], max[3];
+    ///@}
+
+    /**
+     * @brief Quantizes a node relative to the decoded box of its parent
+     *
+     * @param node Node to quantize. Its offset and count are copied.
+     * @param parent Decoded parent
+     */
+    void encode(const LinearBVHNode& node, const LinearBVHNode& parent);
+
+    /**
+     * @brief Full precision node with the decoded bounding box
+     *
+     * @param parent Decoded parent
+     * @return LinearBVHNode Node with a box that contains the original box
+     */
+    LinearBVHNode decode(const LinearBVHNode& parent) const;
+};
+
+static_assert(sizeof(QuantizedBVHNode<std::uint8_t>) == 12,
+              "8-bit BVH nodes should be 12 bytes");
+static_assert(sizeof(QuantizedBVHNode<std::uint16_t>) == 20,
+              "16-bit BVH nodes should be 20 bytes");
+
+/**
+ * @brief Node of a bounding volume hierarchy with up to Width children,
+ * collapsed from a binary tree
+ *
+ * Boxes of the children are stored in structure of arrays form, so that a ray
+ * is tested against all of them with a few SIMD instructions. A node doesn't
+ * store its own box, its parent does. Unused slots have empty boxes, with
+ * minimum coordinates of +infinity and maximum coordinates of -infinity, which
+ * no ray hits.
+ *
+ * Nodes are stored in depth-first order, so children come after their
+ * parents.
+ *
+ * @tparam Width 4 or 8
+ */
+template<int Width>
+struct alignas(32) WideBVHNode
+{
+    /**
+     * @brief Coordinates of the boxes of the children. Rows are xMin, xMax,
+     * yMin, yMax, zMin and zMax.
+     *
+     */
+    float bounds[6][Width];
+
+    /**
+     * @brief Index of the child node for interior children, index of the
+     * first triangle block for leaves
+     *
+     */
+    std::uint32_t childOffset[Width];
+
+    /**
+     * @brief Number of triangles in leaf children. 0 for interior children
+     * and unused slots.
+     *
+     */
+    std::uint16_t primitiveCount[Width];
+
+    /**
+     * @brief Number of used slots, which are the first ones
+     *
+     */
+    std::uint8_t childCount;
+
+    /**
+     * @brief Marks all slots unused
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Bounding box of a child
+     *
+     * @param slot
+     * @return AxisAlignedBox
+     */
+    AxisAlignedBox getBounds(int slot) const;
+
+    /**
+     * @brief Bounding box of this node, the union of its children's boxes
+     *
+     * @return AxisAlignedBox
+     */
+    AxisAlignedBox getBounds() const;
+
+    /**
+     * @brief Sets the bounding box of a child
+     *
+     * @param slot
+     * @param box
+     */
+    void setBounds(int slot, const AxisAlignedBox& box);
+};
+
+static_assert(sizeof(WideBVHNode<4>) == 128,
+              "4-wide BVH nodes should be 128 bytes");
+static_assert(sizeof(WideBVHNode<8>) == 256,
+              "8-wide BVH nodes should be 256 bytes");
+
 /**
  * @brief Checks intersection on a tree of bounding boxes before doing
  * brute-force search
  *
- * Has an axis-aligned bounding box, and two children who are also BVH's.
- * Switches to brute-force test at some point.
+ * The tree is stored as a flat array of LinearBVHNode's. Triangles are stored
+ * in a single array of TriangleBlock's, and each leaf starts a new block, so
+ * that the triangles of a leaf are a contiguous range of blocks. Switches to
+ * brute-force test at the leaves.
+ *
+ * With a width of 4 or 8, the binary tree is collapsed into WideBVHNode's
+ * after it is built, so that a ray visits fewer nodes and tests the boxes of
+ * several children with each instruction.
+ *
+ * When only the vertices of the mesh move, the tree can be refit instead of
+ * being built again. See refitStructure().
  *
  */
 class BoundingVolumeHierarchy : public BoundingBox
 {
 public:
+    /**
+     * @brief Construct a new BoundingVolumeHierarchy object
+     *
+     * @param rebuildThreshold A refit tree is built again from scratch if its
+     * cost grows to more than this ratio of the cost after the last build
+     * @param nodeBits Bits per coordinate of node bounds. 32 stores full
+     * precision LinearBVHNode's, 16 or 8 store QuantizedBVHNode's, which
+     * use less memory but bound the triangles less tightly.
+     * @param width Children per node: 2, 4 or 8. Wide nodes are always full
+     * precision, nodeBits is ignored for them.
+     */
+    BoundingVolumeHierarchy(
+      FloatT rebuildThreshold = BVH_REFIT_REBUILD_THRESHOLD,
+      int nodeBits = BVH_FULL_NODE_BITS,
+      int width = BVH_DEFAULT_WIDTH);
+
     /**
      * @brief Finds the closest intersection in front of the ray
      *
@@ -44,56 +306,590 @@ public:
                      LinearAlgebra::Vec3& normalOut) const override;
 
     /**
-     * @brief Builds the acceleration structure from a vector of triangles
+     * @brief Checks if any triangle is hit in front of the ray before tMax
+     *
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Memory allocated by this structure
+     *
+     * @return std::size_t Size in bytes
+     */
+    std::size_t getMemoryUsage() const override;
+
+protected:
+    /**
+     * @brief Builds the tree for the triangles in geometry
+     *
+     * Divides the triangles using split(), and builds the children
+     * recursively. Nodes are written to the node array in depth-first order
+     * while the tree is being built. Large nodes are built on multiple threads
+     * of ThreadPool::shared().
+     *
+     */
+    void buildStructure() override;
+
+    /**
+     * @brief Fills the triangle blocks of the leaves
+     *
+     * Called after the nodes are built. Each leaf starts a new block, so that
+     * a leaf is a range of blocks. The primitiveOffset of leaves is replaced
+     * with the index of their first block.
+     *
+     * @param orderedIds Primitive IDs of the triangles. A leaf's primitive
+     * offset is the index of its first triangle in this array.
+     */
+    void addLeafBlocks(const std::vector<std::uint32_t>& orderedIds);
+
+    /**
+     * @brief Stores the built nodes in the format selected by nodeBits and
+     * width
+     *
+     * Sets the node views and rootNode. For quantized and wide formats, the
+     * binary full precision nodes are released.
+     *
+     */
+    void compressNodes();
+
+    /**
+     * @brief Collapses the binary tree into a tree of wide nodes
+     *
+     * @tparam Width 4 or 8
+     * @param output Set to the wide nodes in depth-first order
+     */
+    template<int Width>
+    void collapseNodes(std::vector<WideBVHNode<Width>>& output) const;
+
+    /**
+     * @brief Collapses the subtree of an interior node into wide nodes
+     *
+     * Children of the node are opened, largest box first, until there are
+     * Width of them or all of them are leaves. They become the children of the
+     * wide node, and the interior ones are collapsed recursively.
+     *
+     * @tparam Width 4 or 8
+     * @param nodeIndex Index of the interior node in nodes
+     * @param output Wide node array to append the subtree to
+     * @return Index of the wide node in output
+     */
+    template<int Width>
+    int collapseNode(int nodeIndex,
+                     std::vector<WideBVHNode<Width>>& output) const;
+
+    /**
+     * @brief Fits the boxes of a wide tree to the moved triangles, bottom-up
+     *
+     * @tparam Width 4 or 8
+     * @param wideNodes
+     */
+    template<int Width>
+    void refitWideNodes(std::vector<WideBVHNode<Width>>& wideNodes);
+
+    /**
+     * @brief Fits the triangle blocks of a leaf to the moved triangles
+     *
+     * @param blockOffset Index of the first block of the leaf
+     * @param primitiveCount Number of triangles in the leaf
+     * @return AxisAlignedBox Bounding box of the triangles
+     */
+    AxisAlignedBox refitLeaf(std::uint32_t blockOffset, int primitiveCount);
+
+    /**
+     * @brief Restores the full precision nodes of a quantized tree
+     *
+     * Only the structure of the tree is restored, the boxes should be
+     * computed again.
+     *
+     */
+    void decompressNodes();
+
+    /**
+     * @brief Fits the boxes of the existing tree to the moved triangles
+     *
+     * Leaf boxes are computed from their triangles and interior boxes from
+     * their children, bottom-up. The division of triangles between nodes is
+     * kept, so the tree gets worse as the triangles move away from their
+     * original positions.
+     *
+     * @return true Tree is refit
+     * @return false Cost of the refit tree exceeds rebuildThreshold times the
+     * cost after the last build, it should be built again
+     */
+    bool refitStructure() override;
+
+    /**
+     * @brief Adds the nodes of the tree to stats
+     *
+     * Boxes of quantized nodes are decoded, so their areas are those used in
+     * traversal.
+     *
+     * @param stats
+     */
+    void collectStats(AccelerationStructureStats& stats) const override;
+
+    /**
+     * @brief Hash of the builder type and the node format
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t getCacheSettingsHash() const override;
+
+    /**
+     * @brief Nodes, blocks, primitive IDs, the cost after build and the root
+     *
+     * @return std::vector<CacheSection>
+     */
+    std::vector<CacheSection> getCacheSections() const override;
+
+    /**
+     * @brief Uses the nodes, blocks and primitive IDs in a cache file for
+     * traversal
+     *
+     * The arrays are checked to be consistent with each other and the
+     * geometry, so that a damaged file can't make traversal read out of
+     * bounds.
+     *
+     * @param sections
+     * @param file
+     * @return true
+     * @return false
+     */
+    bool loadCacheSections(const std::vector<CacheSection>& sections,
+                           std::shared_ptr<const MappedFile> file) override;
+
+    /**
+     * @brief Expected cost of a ray intersection test with the tree
+     *
+     * Surface area heuristic with unit traversal and intersection costs,
+     * relative to the area of the root. Used to measure how much refitting
+     * degrades the tree.
+     *
+     * @return FloatT
+     */
+    FloatT treeCost() const;
+
+    /**
+     * @brief Information about a triangle that is needed during construction
+     *
+     */
+    struct BuildPrimitive
+    {
+        /**
+         * @brief Bounding box of the triangle
+         *
+         */
+        AxisAlignedBox box;
+
+        /**
+         * @brief Center of the bounding box
+         *
+         */
+        LinearAlgebra::Vec3 center;
+
+        /**
+         * @brief Primitive ID of the triangle
+         *
+         */
+        std::uint32_t index;
+    };
+
+    /**
+     * @brief Builds the subtree with the given range of buildPrimitives
+     *
+     * Appends the root of the subtree to output, then builds its children.
+     * Children of large nodes are built in parallel. The second child is built
+     * into a separate array and appended afterwards.
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param output Node array to append the subtree to. Indices of second
+     * children are relative to the beginning of this array.
+     * @return Index of the root of the subtree in output
+     */
+    int buildNode(int begin, int end, std::vector<LinearBVHNode>& output);
+
+    /**
+     * @brief Bounding box of a range of buildPrimitives
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @return AxisAlignedBox
+     */
+    AxisAlignedBox rangeBounds(int begin, int end) const;
+
+    /**
+     * @brief Moves the primitives in a range that satisfy isLow to the
+     * beginning of the range
+     *
+     * Large ranges are partitioned in parallel, preserving the relative order
+     * of primitives.
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param isLow Returns true for primitives that belong to the first child
+     * @return Index of the first primitive that doesn't satisfy isLow
+     */
+    int partition(int begin,
+                  int end,
+                  const std::function<bool(const BuildPrimitive&)>& isLow);
+
+    /**
+     * @brief Number of chunks to divide the work on a node into
+     *
+     * @param primitiveCount Number of primitives in the node
+     * @return 1 for small nodes, number of build threads for large ones
+     */
+    static int buildChunkCount(int primitiveCount);
+
+    /**
+     * @brief Divides a range of buildPrimitives into two
      *
      * Uses the middle-point heuristic. Tries do divide on the axis with longest
      * length first, if failed, tries other axes.
      *
-     * @param triangles Triangles in this acceleration structure. The vector
-     * will be destroyed by this function. Use std::move to convert vector to
-     * an rvalue.
+     * Reorders the primitives in range [begin, end) so that the ones in
+     * [begin, middle) belong to the first child and the ones in [middle, end)
+     * belong to the second child.
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param bounds Bounding box of the primitives in the range
+     * @param middle Set to the index of the first primitive of second child
+     * @param axis Set to the axis that primitives were divided on
+     * @return true Primitives were divided, both children are nonempty
+     * @return false This node should be a leaf
      */
-    void build(std::vector<Objects::Triangle>&& triangles) override;
+    virtual bool split(int begin,
+                       int end,
+                       const AxisAlignedBox& bounds,
+                       int& middle,
+                       int& axis);
 
-protected:
     /**
-     * @brief Finds the closest intersection in front of the ray without
-     * checking bounding box
+     * @brief Finds the closest triangle in the subtree of given node that is
+     * hit before tMax
      *
-     * Finds the closest intersection with a triangle. If found, returns the t
-     * value at intersection and sets normalOut.
+     * Traverses the tree iteratively with a fixed-size stack. Children are
+     * visited near to far, and nodes whose boxes are entered after the
+     * closest hit found so far are skipped. Only the position of the closest
+     * triangle is tracked, its normal is computed by the caller.
      *
-     * It doesn't check intersection with the bounding box. Assumes this was
-     * done by its parent.
+     * It doesn't check intersection with the bounding box of the node. Assumes
+     * this was done by its parent.
      *
+     * @tparam NodeArray Decodes the children of a node in one of the node
+     * formats
+     * @param nodeArray Nodes of the tree
+     * @param nodeIndex Index of the root of the subtree in the node array
+     * @param node Decoded root of the subtree
      * @param ray Ray to test intersection with
-     * @param normalOut If return value is not -1, set to the surface normal at
-     * intersection point
-     * @return If there was no intersection in front of the ray, -1.
-     * Else, a positive t value such that origin + t * direction is on the
-     * closest triangle
+     * @param tMax Intersections at this t value or farther are ignored. Set to
+     * the t value of the hit if one is found.
+     * @return Index of the closest triangle in idData, -1 if there is no hit
      */
-    FloatT intersectTriangle(const Objects::Ray& ray,
-                             LinearAlgebra::Vec3& normalOut) const;
+    template<typename NodeArray>
+    int intersectNode(const NodeArray& nodeArray,
+                      int nodeIndex,
+                      const LinearBVHNode& node,
+                      const TraversalRay& ray,
+                      FloatT& tMax) const;
 
     /**
-     * @name Children of this BVH node
+     * @brief Checks if any triangle in the subtree of given node is hit before
+     * tMax
      *
+     * Like intersectNode(), it is iterative and doesn't check intersection
+     * with the bounding box of the node.
+     *
+     * @tparam NodeArray Decodes the children of a node in one of the node
+     * formats
+     * @param nodeArray Nodes of the tree
+     * @param nodeIndex Index of the root of the subtree in the node array
+     * @param node Decoded root of the subtree
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle in the subtree at some t in (0, tMax)
+     * @return false
      */
-    ///@{
+    template<typename NodeArray>
+    bool occludedNode(const NodeArray& nodeArray,
+                      int nodeIndex,
+                      const LinearBVHNode& node,
+                      const TraversalRay& ray,
+                      FloatT tMax) const;
+
+    /**
+     * @brief Finds the closest triangle in the subtree of given wide node that
+     * is hit before tMax
+     *
+     * Works like intersectNode(). All children of a node are tested at once,
+     * and the ones that are hit are visited near to far.
+     *
+     * @tparam Width 4 or 8
+     * @param wideNodes Nodes of the tree
+     * @param nodeIndex Index of the root of the subtree in wideNodes
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored. Set to
+     * the t value of the hit if one is found.
+     * @return Index of the closest triangle in idData, -1 if there is no hit
+     */
+    template<int Width>
+    int intersectWideNode(const WideBVHNode<Width>* wideNodes,
+                          int nodeIndex,
+                          const TraversalRay& ray,
+                          FloatT& tMax) const;
+
+    /**
+     * @brief Checks if any triangle in the subtree of given wide node is hit
+     * before tMax
+     *
+     * @tparam Width 4 or 8
+     * @param wideNodes Nodes of the tree
+     * @param nodeIndex Index of the root of the subtree in wideNodes
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle in the subtree at some t in (0, tMax)
+     * @return false
+     */
+    template<int Width>
+    bool occludedWideNode(const WideBVHNode<Width>* wideNodes,
+                          int nodeIndex,
+                          const TraversalRay& ray,
+                          FloatT tMax) const;
 
     /**
-     * @brief Child with lower coordinates along the division axis
+     * @brief Adds the nodes in the subtree of given node to stats
      *
+     * @tparam NodeArray Decodes the children of a node in one of the node
+     * formats
+     * @param nodeArray Nodes of the tree
+     * @param nodeIndex Index of the root of the subtree in the node array
+     * @param node Decoded root of the subtree
+     * @param depth Depth of the node, 0 for the root of the tree
+     * @param stats
      */
-    std::unique_ptr<BoundingVolumeHierarchy> left;
+    template<typename NodeArray>
+    void collectNodeStats(const NodeArray& nodeArray,
+                          int nodeIndex,
+                          const LinearBVHNode& node,
+                          int depth,
+                          AccelerationStructureStats& stats) const;
 
     /**
-     * @brief Child with higher coordinates along the division axis
+     * @brief Nodes of the tree, in depth-first order. Root is at index 0.
      *
      */
-    std::unique_ptr<BoundingVolumeHierarchy> right;
+    std::vector<LinearBVHNode> nodes;
 
-    ///@}
+    /**
+     * @brief Nodes used for traversal
+     *
+     * Points to nodes after a build, or into cacheFile if the tree was loaded
+     * from a cache. Refitting is only possible in the first case.
+     *
+     */
+    const LinearBVHNode* nodeData = nullptr;
+
+    /**
+     * @brief Nodes of the tree if nodeBits is 8
+     *
+     */
+    std::vector<QuantizedBVHNode<std::uint8_t>> nodes8;
+
+    /**
+     * @brief Nodes used for traversal if nodeBits is 8
+     *
+     */
+    const QuantizedBVHNode<std::uint8_t>* nodeData8 = nullptr;
+
+    /**
+     * @brief Nodes of the tree if nodeBits is 16
+     *
+     */
+    std::vector<QuantizedBVHNode<std::uint16_t>> nodes16;
+
+    /**
+     * @brief Nodes used for traversal if nodeBits is 16
+     *
+     */
+    const QuantizedBVHNode<std::uint16_t>* nodeData16 = nullptr;
+
+    /**
+     * @brief Nodes of the tree if width is 4
+     *
+     */
+    std::vector<WideBVHNode<4>> wideNodes4;
+
+    /**
+     * @brief Nodes used for traversal if width is 4
+     *
+     */
+    const WideBVHNode<4>* wideNodeData4 = nullptr;
+
+    /**
+     * @brief Nodes of the tree if width is 8
+     *
+     */
+    std::vector<WideBVHNode<8>> wideNodes8;
+
+    /**
+     * @brief Nodes used for traversal if width is 8
+     *
+     */
+    const WideBVHNode<8>* wideNodeData8 = nullptr;
+
+    /**
+     * @brief Full precision copy of the root, where decoding of quantized
+     * boxes starts
+     *
+     */
+    LinearBVHNode rootNode = {};
+
+    /**
+     * @brief Bits per coordinate of node bounds: 32, 16 or 8
+     *
+     */
+    int nodeBits;
+
+    /**
+     * @brief Children per node: 2, 4 or 8
+     *
+     */
+    int width;
+
+    /**
+     * @brief Ratio of treeCost() to builtCost that triggers a rebuild when
+     * refitting
+     *
+     */
+    FloatT rebuildThreshold;
+
+    /**
+     * @brief treeCost() right after the last build
+     *
+     */
+    FloatT builtCost = 0;
+
+    /**
+     * @brief Triangles with their bounds, used only during build()
+     *
+     */
+    std::vector<BuildPrimitive> buildPrimitives;
+
+    /**
+     * @brief Leaves that split() could not divide during the last build, and
+     * their triangles. Counted from several threads and printed once at the
+     * end of build().
+     *
+     */
+    std::atomic<int> bruteForceLeafCount = 0, bruteForceTriangleCount = 0;
 };
-}
\ No newline at end of file
+
+template<int Width>
+void
+WideBVHNode<Width>::clear()
+{
+    for (int slot = 0; slot < Width; slot++) {
+        setBounds(slot, AxisAlignedBox());
+        childOffset[slot] = 0;
+        primitiveCount[slot] = 0;
+    }
+    childCount = 0;
+}
+
+template<int Width>
+AxisAlignedBox
+WideBVHNode<Width>::getBounds(int slot) const
+{
+    AxisAlignedBox box;
+    box.min = { bounds[0][slot], bounds[2][slot], bounds[4][slot] };
+    box.max = { bounds[1][slot], bounds[3][slot], bounds[5][slot] };
+    return box;
+}
+
+template<int Width>
+AxisAlignedBox
+WideBVHNode<Width>::getBounds() const
+{
+    AxisAlignedBox box;
+    for (int slot = 0; slot < childCount; slot++)
+        box.extend(getBounds(slot));
+    return box;
+}
+
+template<int Width>
+void
+WideBVHNode<Width>::setBounds(int slot, const AxisAlignedBox& box)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        bounds[2 * axis][slot] = box.min[axis];
+        bounds[2 * axis + 1][slot] = box.max[axis];
+    }
+}
+
+template<typename T>
+void
+QuantizedBVHNode<T>::encode(const LinearBVHNode& node,
+                            const LinearBVHNode& parent)
+{
+    constexpr float steps = std::numeric_limits<T>::max();
+    primitiveOffset = node.primitiveOffset;
+    primitiveCount = node.primitiveCount;
+
+    auto box = node.getBounds();
+    auto parentBox = parent.getBounds();
+    for (int axis = 0; axis < 3; axis++) {
+        float low = parentBox.min[axis], high = parentBox.max[axis];
+        float step = (high - low) / steps;
+        if (!(step > 0)) {
+            min[axis] = max[axis] = 0;
+            continue;
+        }
+
+        // rounding down the distances from the parent's sides rounds the box
+        // outwards. decode() computes the coordinates in floats too, so check
+        // with the same formula in case the division rounded the wrong way
+        float minSteps = std::floor((float(box.min[axis]) - low) / step);
+        T q = std::clamp(minSteps, 0.0f, steps);
+        while (q > 0 && low + q * step > float(box.min[axis]))
+            q--;
+        min[axis] = q;
+
+        float maxSteps = std::floor((high - float(box.max[axis])) / step);
+        q = std::clamp(maxSteps, 0.0f, steps);
+        while (q > 0 && high - q * step < float(box.max[axis]))
+            q--;
+        max[axis] = q;
+    }
+}
+
+template<typename T>
+LinearBVHNode
+QuantizedBVHNode<T>::decode(const LinearBVHNode& parent) const
+{
+    constexpr float steps = std::numeric_limits<T>::max();
+    LinearBVHNode node;
+    float xStep = (parent.xMax - parent.xMin) / steps;
+    float yStep = (parent.yMax - parent.yMin) / steps;
+    float zStep = (parent.zMax - parent.zMin) / steps;
+    node.xMin = parent.xMin + min[0] * xStep;
+    node.xMax = parent.xMax - max[0] * xStep;
+    node.yMin = parent.yMin + min[1] * yStep;
+    node.yMax = parent.yMax - max[1] * yStep;
+    node.zMin = parent.zMin + min[2] * zStep;
+    node.zMax = parent.zMax - max[2] * zStep;
+    node.primitiveOffset = primitiveOffset;
+    node.primitiveCount = primitiveCount;
+    node.axis = 0;
+    node.padding = 0;
+    return node;
+}
+}
@@ -1,24 +1,109 @@
 #include "BruteForce.hpp"
+#include <numeric>
 
 namespace AccelerationStructures {
 FloatT
 BruteForce::intersect(const Objects::Ray& ray,
                       LinearAlgebra::Vec3& normalOut) const
 {
-    FloatT minT = std::numeric_limits<FloatT>::infinity();
-    for (auto& triangle : triangles) {
-        auto t = triangle.intersect(ray);
-        if (t != -1 && t < minT) {
-            minT = t;
-            normalOut = triangle.getNormal();
-        }
+    return intersectRange(ray, normalOut, 0, blockDataSize);
+}
+
+bool
+BruteForce::occluded(const Objects::Ray& ray, FloatT tMax) const
+{
+    return occludedRange(ray, tMax, 0, blockDataSize);
+}
+
+std::size_t
+BruteForce::getMemoryUsage() const
+{
+    // a mapped cache file is counted too, its pages are loaded when used
+    return blocks.capacity() * sizeof(TriangleBlock) +
+           primitiveIds.capacity() * sizeof(std::uint32_t) +
+           (cacheFile ? cacheFile->getSize() : 0);
+}
+
+void
+BruteForce::buildStructure()
+{
+    std::vector<std::uint32_t> ids(geometry->getTriangleCount());
+    std::iota(ids.begin(), ids.end(), 0);
+
+    blocks.clear();
+    primitiveIds.clear();
+    addBlocks(ids, 0, ids.size());
+    useOwnedBlocks();
+}
+
+int
+BruteForce::addBlocks(const std::vector<std::uint32_t>& ids,
+                      int first,
+                      int count)
+{
+    int firstBlock = blocks.size();
+    int blockCount = TriangleBlock::blockCount(count);
+    blocks.resize(firstBlock + blockCount);
+    primitiveIds.resize(blocks.size() * TriangleBlock::width);
+    for (int i = 0; i < count; i++) {
+        auto id = ids[first + i];
+        blocks[firstBlock + i / TriangleBlock::width].set(
+          i % TriangleBlock::width,
+          PrecomputedTriangle(geometry->getTriangle(id)));
+        primitiveIds[firstBlock * TriangleBlock::width + i] = id;
     }
-    return minT < std::numeric_limits<FloatT>::infinity() ? minT : -1;
+    return firstBlock;
 }
 
 void
-BruteForce::build(std::vector<Objects::Triangle>&& triangleVector)
+BruteForce::useOwnedBlocks()
 {
-    triangles = std::move(triangleVector);
+    blockData = blocks.data();
+    blockDataSize = blocks.size();
+    idData = primitiveIds.data();
+}
+
+FloatT
+BruteForce::intersectRange(const Objects::Ray& ray,
+                           LinearAlgebra::Vec3& normalOut,
+                           int first,
+                           int count) const
+{
+    FloatT minT = std::numeric_limits<FloatT>::infinity();
+    int closest = closestInRange(ray, minT, first, count);
+    if (closest == -1)
+        return -1;
+
+    // the normal is needed only for the closest triangle
+    normalOut = geometry->getNormal(idData[closest]);
+    return minT;
+}
+
+int
+BruteForce::closestInRange(const Objects::Ray& ray,
+                           FloatT& tMax,
+                           int first,
+                           int count) const
+{
+    int closest = -1;
+    for (int i = first; i < first + count; i++) {
+        int lane = blockData[i].intersect(ray, tMax);
+        if (lane != -1)
+            closest = i * TriangleBlock::width + lane;
+    }
+    return closest;
+}
+
+bool
+BruteForce::occludedRange(const Objects::Ray& ray,
+                          FloatT tMax,
+                          int first,
+                          int count) const
+{
+    for (int i = first; i < first + count; i++) {
+        if (blockData[i].occluded(ray, tMax))
+            return true;
+    }
+    return false;
+}
 }
-}
\ No newline at end of file
@@ -12,12 +12,19 @@
 #pragma once
 
 #include "AccelerationStructure.hpp"
+#include "TriangleBlock.hpp"
+#include <cstdint>
 #include <vector>
 
 namespace AccelerationStructures {
 /**
  * @brief Finds the intersection by testing the triangles one by one
  *
+ * Triangles are packed into TriangleBlock's when the structure is built, and
+ * each ray is tested against a whole block at once. Leaves of the other
+ * acceleration structures are also BruteForce objects or ranges of one, so
+ * they use the same test.
+ *
  */
 class BruteForce : public AccelerationStructure
 {
@@ -39,15 +46,138 @@ public:
                      LinearAlgebra::Vec3& normalOut) const override;
 
     /**
-     * @brief Builds the acceleration structure from a vector of triangles
+     * @brief Checks if any triangle is hit in front of the ray before tMax
+     *
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Memory allocated by this structure
      *
-     * @param triangles Triangles in this acceleration structure. The vector
-     * will be destroyed by this function. Use std::move to convert vector to
-     * an rvalue.
+     * @return std::size_t Size in bytes
      */
-    void build(std::vector<Objects::Triangle>&& triangles) override;
+    std::size_t getMemoryUsage() const override;
 
 protected:
-    std::vector<Objects::Triangle> triangles;
+    /**
+     * @brief Packs all triangles of geometry into blocks
+     *
+     */
+    void buildStructure() override;
+
+    /**
+     * @brief Packs a range of triangles into new blocks
+     *
+     * The blocks are appended to the block array. The first triangle starts a
+     * new block, so ranges added by separate calls never share a block.
+     *
+     * @param ids Primitive IDs of triangles in geometry
+     * @param first Index of the first ID to add
+     * @param count Number of triangles to add
+     * @return Index of the first new block
+     */
+    int addBlocks(const std::vector<std::uint32_t>& ids, int first, int count);
+
+    /**
+     * @brief Points blockData and idData to blocks and primitiveIds
+     *
+     * Called after the blocks are built.
+     *
+     */
+    void useOwnedBlocks();
+
+    /**
+     * @brief Finds the closest intersection with a range of the blocks
+     *
+     * @param ray Ray to test intersection with
+     * @param normalOut If return value is not -1, set to the surface normal at
+     * intersection point
+     * @param first Index of the first block to test
+     * @param count Number of blocks to test
+     * @return If there was no intersection in front of the ray, -1.
+     * Else, a positive t value such that origin + t * direction is on the
+     * closest triangle in the range
+     */
+    FloatT intersectRange(const Objects::Ray& ray,
+                          LinearAlgebra::Vec3& normalOut,
+                          int first,
+                          int count) const;
+
+    /**
+     * @brief Finds the closest triangle in a range of the blocks that is hit
+     * before tMax
+     *
+     * Only finds where the triangle is stored, so that the normal can be
+     * computed once for the closest of several ranges.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored. Set to
+     * the t value of the hit if one is found.
+     * @param first Index of the first block to test
+     * @param count Number of blocks to test
+     * @return Index of the triangle in idData, -1 if there is no hit
+     */
+    int closestInRange(const Objects::Ray& ray,
+                       FloatT& tMax,
+                       int first,
+                       int count) const;
+
+    /**
+     * @brief Checks if any triangle in a range of the blocks is hit before
+     * tMax
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @param first Index of the first block to test
+     * @param count Number of blocks to test
+     * @return true There is a triangle in the range at some t in (0, tMax)
+     * @return false
+     */
+    bool occludedRange(const Objects::Ray& ray,
+                       FloatT tMax,
+                       int first,
+                       int count) const;
+
+    /**
+     * @brief Triangles, TriangleBlock::width per block
+     *
+     */
+    std::vector<TriangleBlock> blocks;
+
+    /**
+     * @brief Primitive IDs of the triangles in the blocks, used to find the
+     * normal at a hit. ID of lane i of block j is at index
+     * j * TriangleBlock::width + i.
+     *
+     */
+    std::vector<std::uint32_t> primitiveIds;
+
+    /**
+     * @brief Blocks used for intersection tests
+     *
+     * Points to blocks after a build, or into cacheFile if the structure was
+     * loaded from a cache.
+     *
+     */
+    const TriangleBlock* blockData = nullptr;
+
+    /**
+     * @brief Number of blocks in blockData
+     *
+     */
+    std::size_t blockDataSize = 0;
+
+    /**
+     * @brief Primitive IDs used for intersection tests, like blockData
+     *
+     */
+    const std::uint32_t* idData = nullptr;
 };
-}
\ No newline at end of file
+}
@@ -6,60 +6,79 @@ KDTree::intersect(const Objects::Ray& ray, LinearAlgebra::Vec3& normalOut) const
 {
     if (!root)
         return BoundingBox::intersect(ray, normalOut);
-    if (!hitsBoundingBox(ray))
+    TraversalRay traversalRay(ray);
+    FloatT minT = intersectBoundingBox(traversalRay);
+    if (minT == -1)
         return -1;
-    return root->intersect(ray, normalOut, getMaxT(ray));
+    KDTreeNode::Mailbox mailbox;
+    return root->intersect(triangles,
+                           traversalRay,
+                           normalOut,
+                           minT,
+                           getMaxT(traversalRay),
+                           mailbox);
+}
+
+bool
+KDTree::occluded(const Objects::Ray& ray, FloatT tMax) const
+{
+    if (!root)
+        return BoundingBox::occluded(ray, tMax);
+    TraversalRay traversalRay(ray);
+    FloatT t = intersectBoundingBox(traversalRay);
+    if (t == -1 || t >= tMax)
+        return false;
+    KDTreeNode::Mailbox mailbox;
+    return root->occluded(
+      triangles, traversalRay, tMax, t, getMaxT(traversalRay), mailbox);
+}
+
+std::size_t
+KDTree::getMemoryUsage() const
+{
+    std::size_t size = BoundingBox::getMemoryUsage() +
+                       triangles.capacity() * sizeof(PrecomputedTriangle);
+    if (root)
+        size += root->getMemoryUsage();
+    return size;
 }
 
 void
-KDTree::build(std::vector<Objects::Triangle>&& triangles)
+KDTree::buildStructure()
 {
-    if (triangles.size() <= KD_BRUTE_FORCE_THRESHOLD) {
-        BoundingBox::build(std::move(triangles));
-        return;
+    createBoundingBox();
+
+    AxisAlignedBox bounds;
+    triangles.clear();
+    triangles.reserve(geometry->getTriangleCount());
+    for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++) {
+        auto triangle = geometry->getTriangle(i);
+        bounds.extend(AxisAlignedBox(triangle));
+        triangles.emplace_back(triangle);
     }
 
-    createBoundingBox(triangles);
     root = std::make_unique<KDTreeNode>();
-
-    // start by dividing on the longest axis
-    FloatT xLen = xMax - xMin;
-    FloatT yLen = yMax - yMin;
-    FloatT zLen = zMax - zMin;
-
-    if (xLen > yLen && xLen > zLen)
-        root->build(std::move(triangles), KDTreeNode::Axis::x);
-    else if (yLen > zLen)
-        root->build(std::move(triangles), KDTreeNode::Axis::y);
-    else
-        root->build(std::move(triangles), KDTreeNode::Axis::z);
+    root->build(*geometry, bounds);
 }
 
 FloatT
-KDTree::getMaxT(const Objects::Ray& ray) const
+KDTree::getMaxT(const TraversalRay& ray) const
 {
-    /**
-     * See BoundingBox::hitsBoundingBox() for an explanation
-     *
-     */
-
-    FloatT tMax = std::numeric_limits<FloatT>::infinity();
-
-    // planes normal to x axis
-    FloatT t1 = (xMin - ray.origin.x) / ray.direction.x;
-    FloatT t2 = (xMax - ray.origin.x) / ray.direction.x;
-    tMax = std::min(tMax, std::max(t1, t2));
-
-    // planes normal to y axis
-    t1 = (yMin - ray.origin.y) / ray.direction.y;
-    t2 = (yMax - ray.origin.y) / ray.direction.y;
-    tMax = std::min(tMax, std::max(t1, t2));
-
-    // planes normal to z axis
-    t1 = (zMin - ray.origin.z) / ray.direction.z;
-    t2 = (zMax - ray.origin.z) / ray.direction.z;
-    tMax = std::min(tMax, std::max(t1, t2));
+    FloatT tEnter, tExit;
+    ray.clipBox(xMin, xMax, yMin, yMax, zMin, zMax, tEnter, tExit);
+    return tExit;
+}
 
-    return tMax;
+void
+KDTree::collectStats(AccelerationStructureStats& stats) const
+{
+    if (!root) {
+        BoundingBox::collectStats(stats);
+        return;
+    }
+    AxisAlignedBox bounds;
+    bounds.extend(LinearAlgebra::Vec3(xMin, yMin, zMin));
+    bounds.extend(LinearAlgebra::Vec3(xMax, yMax, zMax));
+    root->collectStats(bounds, 0, stats);
 }
 }
\ No newline at end of file
@@ -18,11 +18,13 @@
 
 namespace AccelerationStructures {
 /**
- * @brief Checks intersection on a tree of bounding boxes before doing
- * brute-force search
+ * @brief Checks intersection on a k-d tree built with the surface area
+ * heuristic
  *
- * Has an axis-aligned bounding box, and two children who are also BVH's.
- * Switches to brute-force test at some point.
+ * Space inside the bounding box is divided by axis-aligned planes. Planes are
+ * chosen with the surface area heuristic, and a node becomes a leaf when
+ * splitting it is not cheaper than testing its triangles one by one. Leaves
+ * store the primitive IDs of their triangles.
  *
  */
 class KDTree : public BoundingBox
@@ -45,15 +47,32 @@ public:
                      LinearAlgebra::Vec3& normalOut) const override;
 
     /**
-     * @brief Builds the acceleration structure from a vector of triangles
+     * @brief Checks if any triangle is hit in front of the ray before tMax
      *
-     * @param triangles Triangles in this acceleration structure. The vector
-     * will be destroyed by this function. Use std::move to convert vector to
-     * an rvalue.
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Memory allocated by this structure
+     *
+     * @return std::size_t Size in bytes
      */
-    void build(std::vector<Objects::Triangle>&& triangles) override;
+    std::size_t getMemoryUsage() const override;
 
 protected:
+    /**
+     * @brief Builds the tree for the triangles in geometry
+     *
+     */
+    void buildStructure() override;
+
     /**
      * @brief Maximum t value for which ray is inside the bounding box
      *
@@ -62,12 +81,28 @@ protected:
      * @param ray
      * @return FloatT
      */
-    FloatT getMaxT(const Objects::Ray& ray) const;
+    FloatT getMaxT(const TraversalRay& ray) const;
+
+    /**
+     * @brief Adds the nodes of the tree to stats
+     *
+     * @param stats
+     */
+    void collectStats(AccelerationStructureStats& stats) const override;
 
     /**
      * @brief Root of the tree if exists
      *
      */
     std::unique_ptr<KDTreeNode> root;
+
+    /**
+     * @brief Triangles of geometry, indexed by primitive ID
+     *
+     * Leaves refer to triangles by their IDs, so a triangle that is in
+     * several leaves is stored only once.
+     *
+     */
+    std::vector<PrecomputedTriangle> triangles;
 };
 }
\ No newline at end of file
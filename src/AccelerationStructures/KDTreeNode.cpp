@@ -1,358 +1,446 @@
 #include "KDTreeNode.hpp"
 #include "AccelerationStructureConstants.hpp"
+#include "ThreadPool.hpp"
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace AccelerationStructures {
 FloatT
-KDTreeNode::intersect(const Objects::Ray& ray,
+KDTreeNode::intersect(const std::vector<PrecomputedTriangle>& triangles,
+                      const TraversalRay& ray,
                       LinearAlgebra::Vec3& normalOut,
-                      FloatT maxT) const
+                      FloatT minT,
+                      FloatT maxT,
+                      Mailbox& mailbox) const
 {
-    if (!left)
-        return BruteForce::intersect(ray, normalOut);
-
-    switch (divisionAxis) {
-        case Axis::x:
-            if (ray.direction.x > 0) {
-                // coordinates are increasing
-                if (ray.origin.x > divisionPlane)
-                    // origin at the upper side
-                    return right->intersect(ray, normalOut, maxT);
-
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.x) / ray.direction.x;
-
-                if (planeT >= maxT)
-                    return left->intersect(ray, normalOut, maxT);
-
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1)
-                    return right->intersect(ray, normalOut, maxT);
-
-                if (leftT <= planeT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
-
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1 || leftT < rightT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
-
-                normalOut = rightNormal;
-                return rightT;
-            } else if (ray.direction.x < 0) {
-                // coordinates are decreasing
-                if (ray.origin.x <= divisionPlane)
-                    // origin at the upper side
-                    return left->intersect(ray, normalOut, maxT);
-
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.x) / ray.direction.x;
-
-                if (planeT >= maxT)
-                    return right->intersect(ray, normalOut, maxT);
-
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1)
-                    return left->intersect(ray, normalOut, maxT);
-
-                if (rightT <= planeT) {
-                    normalOut = rightNormal;
-                    return rightT;
-                }
-
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1 || rightT < leftT) {
-                    normalOut = rightNormal;
-                    return rightT;
-                }
-
-                normalOut = leftNormal;
-                return leftT;
-            } else {
-                // parallel to division plane
-                if (ray.origin.x <= divisionPlane)
-                    return left->intersect(ray, normalOut, maxT);
-                else
-                    return right->intersect(ray, normalOut, maxT);
+    if (!left) {
+        FloatT closestT = std::numeric_limits<FloatT>::infinity();
+        const PrecomputedTriangle* closest = nullptr;
+        for (auto entry : primitiveIds) {
+            // a hit found in an earlier leaf is already returned from there
+            auto id = entry & ~sharedFlag;
+            if (entry != id && mailbox.testedBefore(id))
+                continue;
+            FloatT t = triangles[id].intersect(ray.ray);
+            if (t != -1 && t < closestT) {
+                closestT = t;
+                closest = &triangles[id];
             }
-            break;
-        case Axis::y:
-            if (ray.direction.y > 0) {
-                // coordinates are increasing
-                if (ray.origin.y > divisionPlane)
-                    // origin at the upper side
-                    return right->intersect(ray, normalOut, maxT);
-
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.y) / ray.direction.y;
-
-                if (planeT >= maxT)
-                    return left->intersect(ray, normalOut, maxT);
-
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1)
-                    return right->intersect(ray, normalOut, maxT);
-
-                if (leftT <= planeT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
-
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1 || leftT < rightT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
-
-                normalOut = rightNormal;
-                return rightT;
-            } else if (ray.direction.y < 0) {
-                // coordinates are decreasing
-                if (ray.origin.y <= divisionPlane)
-                    // origin at the upper side
-                    return left->intersect(ray, normalOut, maxT);
+        }
+        if (!closest)
+            return -1;
+        normalOut = closest->normal;
+        return closestT;
+    }
 
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.y) / ray.direction.y;
+    KDTreeNode *near, *far;
+    FloatT planeT;
+    if (!orderChildren(ray, near, far, planeT))
+        // parallel to division plane
+        return near->intersect(
+          triangles, ray, normalOut, minT, maxT, mailbox);
+
+    if (planeT >= maxT)
+        // leaves the node before reaching the plane
+        return near->intersect(
+          triangles, ray, normalOut, minT, maxT, mailbox);
+    if (planeT <= minT)
+        // enters the node after passing the plane
+        return far->intersect(
+          triangles, ray, normalOut, minT, maxT, mailbox);
+
+    LinearAlgebra::Vec3 nearNormal, farNormal;
+    FloatT nearT =
+      near->intersect(triangles, ray, nearNormal, minT, planeT, mailbox);
+    if (nearT != -1 && nearT <= planeT) {
+        normalOut = nearNormal;
+        return nearT;
+    }
 
-                if (planeT >= maxT)
-                    return right->intersect(ray, normalOut, maxT);
+    // the triangle hit in the near child may extend to the far child, so
+    // there may be a closer one there
+    FloatT farT =
+      far->intersect(triangles, ray, farNormal, planeT, maxT, mailbox);
+    if (farT == -1 || (nearT != -1 && nearT < farT)) {
+        if (nearT != -1)
+            normalOut = nearNormal;
+        return nearT;
+    }
+    normalOut = farNormal;
+    return farT;
+}
 
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1)
-                    return left->intersect(ray, normalOut, maxT);
+bool
+KDTreeNode::occluded(const std::vector<PrecomputedTriangle>& triangles,
+                     const TraversalRay& ray,
+                     FloatT tMax,
+                     FloatT minT,
+                     FloatT maxT,
+                     Mailbox& mailbox) const
+{
+    if (!left) {
+        for (auto entry : primitiveIds) {
+            auto id = entry & ~sharedFlag;
+            if (entry != id && mailbox.testedBefore(id))
+                continue;
+            FloatT t = triangles[id].intersect(ray.ray);
+            if (t != -1 && t < tMax)
+                return true;
+        }
+        return false;
+    }
 
-                if (rightT <= planeT) {
-                    normalOut = rightNormal;
-                    return rightT;
-                }
+    KDTreeNode *near, *far;
+    FloatT planeT;
+    if (!orderChildren(ray, near, far, planeT))
+        return near->occluded(triangles, ray, tMax, minT, maxT, mailbox);
+
+    maxT = std::min(maxT, tMax);
+    if (planeT >= maxT)
+        return near->occluded(triangles, ray, tMax, minT, maxT, mailbox);
+    if (planeT <= minT)
+        return far->occluded(triangles, ray, tMax, minT, maxT, mailbox);
+    return near->occluded(triangles, ray, tMax, minT, planeT, mailbox) ||
+           far->occluded(triangles, ray, tMax, planeT, maxT, mailbox);
+}
 
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1 || rightT < leftT) {
-                    normalOut = rightNormal;
-                    return rightT;
-                }
+bool
+KDTreeNode::orderChildren(const TraversalRay& ray,
+                          KDTreeNode*& nearOut,
+                          KDTreeNode*& farOut,
+                          FloatT& planeTOut) const
+{
+    int axis = static_cast<int>(divisionAxis);
+    FloatT origin = ray.ray.origin[axis];
+    FloatT direction = ray.ray.direction[axis];
+
+    // a point on the plane is in the lower child
+    bool originLow = origin <= divisionPlane;
+    nearOut = originLow ? left.get() : right.get();
+    farOut = originLow ? right.get() : left.get();
+    if (direction == 0 || (direction > 0) != originLow)
+        // never crosses the plane
+        return false;
+
+    planeTOut = (divisionPlane - origin) * ray.inverseDirection[axis];
+    return true;
+}
 
-                normalOut = leftNormal;
-                return leftT;
-            } else {
-                // parallel to division plane
-                if (ray.origin.y <= divisionPlane)
-                    return left->intersect(ray, normalOut, maxT);
-                else
-                    return right->intersect(ray, normalOut, maxT);
-            }
-            break;
-        case Axis::z:
-            if (ray.direction.z > 0) {
-                // coordinates are increasing
-                if (ray.origin.z > divisionPlane)
-                    // origin at the upper side
-                    return right->intersect(ray, normalOut, maxT);
-
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.z) / ray.direction.z;
-
-                if (planeT >= maxT)
-                    return left->intersect(ray, normalOut, maxT);
-
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1)
-                    return right->intersect(ray, normalOut, maxT);
-
-                if (leftT <= planeT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
+void
+KDTreeNode::build(const Objects::MeshGeometry& geometry,
+                  const AxisAlignedBox& bounds)
+{
+    std::uint32_t count = geometry.getTriangleCount();
+    std::vector<BuildPrimitive> primitives;
+    primitives.reserve(count);
+    for (std::uint32_t i = 0; i < count; i++)
+        primitives.push_back({ AxisAlignedBox(geometry.getTriangle(i)), i });
+
+    EventLists events;
+    for (int axis = 0; axis < 3; axis++) {
+        addEvents(primitives, 0, primitives.size(), axis, events[axis]);
+        std::sort(events[axis].begin(), events[axis].end());
+    }
 
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1 || leftT < rightT) {
-                    normalOut = leftNormal;
-                    return leftT;
-                }
+    // a common limit, see Physically Based Rendering, section 4.4
+    int maxDepth =
+      KD_SAH_BASE_DEPTH + KD_SAH_DEPTH_FACTOR * std::log2(count + 1);
+    buildNode(std::move(primitives), std::move(events), bounds, maxDepth);
+}
 
-                normalOut = rightNormal;
-                return rightT;
-            } else if (ray.direction.z < 0) {
-                // coordinates are decreasing
-                if (ray.origin.z <= divisionPlane)
-                    // origin at the upper side
-                    return left->intersect(ray, normalOut, maxT);
+std::size_t
+KDTreeNode::getMemoryUsage() const
+{
+    std::size_t size =
+      sizeof(KDTreeNode) + primitiveIds.capacity() * sizeof(std::uint32_t);
+    if (left)
+        size += left->getMemoryUsage() + right->getMemoryUsage();
+    return size;
+}
 
-                LinearAlgebra::Vec3 leftNormal, rightNormal;
-                FloatT planeT =
-                  (divisionPlane - ray.origin.z) / ray.direction.z;
+void
+KDTreeNode::collectStats(const AxisAlignedBox& bounds,
+                         int depth,
+                         AccelerationStructureStats& stats) const
+{
+    if (!left) {
+        stats.addLeaf(depth, bounds.surfaceArea(), primitiveIds.size());
+        return;
+    }
+    stats.addInterior(depth, bounds.surfaceArea());
+
+    int axis = static_cast<int>(divisionAxis);
+    AxisAlignedBox lowBounds = bounds, highBounds = bounds;
+    lowBounds.max[axis] = divisionPlane;
+    highBounds.min[axis] = divisionPlane;
+    left->collectStats(lowBounds, depth + 1, stats);
+    right->collectStats(highBounds, depth + 1, stats);
+}
 
-                if (planeT >= maxT)
-                    return right->intersect(ray, normalOut, maxT);
+bool
+KDTreeNode::Event::operator<(const Event& other) const
+{
+    if (position != other.position)
+        return position < other.position;
+    return type < other.type;
+}
 
-                FloatT rightT = right->intersect(ray, rightNormal, maxT);
-                if (rightT == -1)
-                    return left->intersect(ray, normalOut, maxT);
+void
+KDTreeNode::addEvents(const std::vector<BuildPrimitive>& primitives,
+                      int first,
+                      int end,
+                      int axis,
+                      std::vector<Event>& output)
+{
+    for (int i = first; i < end; i++) {
+        auto& box = primitives[i].box;
+        if (box.min[axis] == box.max[axis]) {
+            output.push_back({ box.min[axis], i, Event::Type::Planar });
+        } else {
+            output.push_back({ box.min[axis], i, Event::Type::Start });
+            output.push_back({ box.max[axis], i, Event::Type::End });
+        }
+    }
+}
 
-                if (rightT <= planeT) {
-                    normalOut = rightNormal;
-                    return rightT;
+bool
+KDTreeNode::findSplit(int primitiveCount,
+                      const EventLists& events,
+                      const AxisAlignedBox& bounds,
+                      FloatT& costOut,
+                      int& axisOut,
+                      FloatT& positionOut,
+                      bool& planarLeftOut)
+{
+    FloatT nodeArea = bounds.surfaceArea();
+    if (nodeArea <= 0)
+        return false;
+
+    costOut = std::numeric_limits<FloatT>::infinity();
+
+    // expected cost of a split, relative to the area of this node. empty
+    // children are rewarded, so that empty space is cut off early
+    auto splitCost = [&](FloatT lowArea,
+                         FloatT highArea,
+                         int lowCount,
+                         int highCount) {
+        FloatT weightedCount =
+          (lowArea * lowCount + highArea * highCount) / nodeArea;
+        FloatT cost =
+          KD_SAH_TRAVERSAL_COST + KD_SAH_INTERSECTION_COST * weightedCount;
+        if (lowCount == 0 || highCount == 0)
+            cost *= 1 - KD_SAH_EMPTY_BONUS;
+        return cost;
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        auto& axisEvents = events[axis];
+
+        // number of primitives that are entirely or partially on each side of
+        // the current position, and lying on the plane at that position
+        int lowCount = 0, planarCount = 0, highCount = primitiveCount;
+        for (std::size_t i = 0; i < axisEvents.size();) {
+            FloatT position = axisEvents[i].position;
+            // events at the same position are sorted by type, count each type
+            auto countEvents = [&](Event::Type type) {
+                int count = 0;
+                while (i < axisEvents.size() &&
+                       axisEvents[i].position == position &&
+                       axisEvents[i].type == type) {
+                    count++;
+                    i++;
                 }
-
-                FloatT leftT = left->intersect(ray, leftNormal, maxT);
-                if (leftT == -1 || rightT < leftT) {
-                    normalOut = rightNormal;
-                    return rightT;
+                return count;
+            };
+            int endCount = countEvents(Event::Type::End);
+            int planarHere = countEvents(Event::Type::Planar);
+            int startCount = countEvents(Event::Type::Start);
+
+            planarCount = planarHere;
+            highCount -= planarHere + endCount;
+
+            // planes on the boundary of the node don't divide anything
+            if (position > bounds.min[axis] && position < bounds.max[axis]) {
+                AxisAlignedBox low = bounds, high = bounds;
+                low.max[axis] = position;
+                high.min[axis] = position;
+                FloatT lowArea = low.surfaceArea();
+                FloatT highArea = high.surfaceArea();
+
+                // primitives on the plane go to the cheaper side
+                FloatT planarLowCost = splitCost(
+                  lowArea, highArea, lowCount + planarCount, highCount);
+                FloatT planarHighCost = splitCost(
+                  lowArea, highArea, lowCount, highCount + planarCount);
+                FloatT cost = std::min(planarLowCost, planarHighCost);
+                if (cost < costOut) {
+                    costOut = cost;
+                    axisOut = axis;
+                    positionOut = position;
+                    planarLeftOut = planarLowCost <= planarHighCost;
                 }
-
-                normalOut = leftNormal;
-                return leftT;
-            } else {
-                // parallel to division plane
-                if (ray.origin.z <= divisionPlane)
-                    return left->intersect(ray, normalOut, maxT);
-                else
-                    return right->intersect(ray, normalOut, maxT);
             }
-            break;
-        default:
-            // doesn't happen but my compiler is complaining otherwise
-            return -1;
+
+            lowCount += startCount + planarCount;
+            planarCount = 0;
+        }
     }
+    return costOut < std::numeric_limits<FloatT>::infinity();
 }
 
 void
-KDTreeNode::build(std::vector<Objects::Triangle>&& triangles, Axis divisionAxis)
+KDTreeNode::buildNode(std::vector<BuildPrimitive>&& primitives,
+                      EventLists&& events,
+                      const AxisAlignedBox& bounds,
+                      int remainingDepth)
 {
-    if (triangles.size() <= KD_BRUTE_FORCE_THRESHOLD) {
-        BruteForce::build(std::move(triangles));
+    int count = primitives.size();
+    FloatT cost;
+    int axis;
+    FloatT position;
+    bool planarLeft;
+    if (!remainingDepth || !count ||
+        !findSplit(count, events, bounds, cost, axis, position, planarLeft) ||
+        cost >= KD_SAH_INTERSECTION_COST * count) {
+        // cheaper to test all triangles. the ones in other leaves too are
+        // marked, only they need to be checked in the mailbox of a ray
+        primitiveIds.reserve(count);
+        for (auto& primitive : primitives) {
+            primitiveIds.push_back(primitive.triangle |
+                                   (primitive.shared ? sharedFlag : 0));
+        }
         return;
     }
 
-    this->divisionAxis = divisionAxis;
-
-    // { divisionAxis coordinate of center, surface area }
-    std::vector<std::pair<FloatT, FloatT>> data;
-    data.reserve(triangles.size());
-
-    FloatT totalArea = 0;
-
-    // put centers of triangles into data array along with their area
-    switch (divisionAxis) {
-        case Axis::x:
-            for (auto& triangle : triangles) {
-                FloatT area = triangle.area();
-                FloatT center =
-                  (triangle.v1.x + triangle.v2.x + triangle.v3.x) / 3;
-                data.push_back({ center, area });
-                totalArea += area;
-            }
-            break;
-        case Axis::y:
-            for (auto& triangle : triangles) {
-                FloatT area = triangle.area();
-                FloatT center =
-                  (triangle.v1.y + triangle.v2.y + triangle.v3.y) / 3;
-                data.push_back({ center, area });
-                totalArea += area;
-            }
-            break;
-        case Axis::z:
-            for (auto& triangle : triangles) {
-                FloatT area = triangle.area();
-                FloatT center =
-                  (triangle.v1.z + triangle.v2.z + triangle.v3.z) / 3;
-                data.push_back({ center, area });
-                totalArea += area;
-            }
-            break;
-    }
-
-    // sort w.r.t. center coordinate
-    std::sort(data.begin(), data.end());
-
-    // find a coordinate that would make areas close to equal (doesn't consider
-    // dividing triangles)
-    FloatT area = 0;
-    int next = 0;
-    while (area < totalArea / 2) {
-        area += data[next].second;
-        next++;
+    divisionAxis = static_cast<Axis>(axis);
+    divisionPlane = position;
+
+    // classify primitives using the events on the division axis
+    enum class Side : char
+    {
+        Both,
+        Low,
+        High
+    };
+    std::vector<Side> sides(count, Side::Both);
+    for (auto& event : events[axis]) {
+        if (event.type == Event::Type::End && event.position <= position)
+            sides[event.primitive] = Side::Low;
+        else if (event.type == Event::Type::Start && event.position >= position)
+            sides[event.primitive] = Side::High;
+        else if (event.type == Event::Type::Planar) {
+            if (event.position < position ||
+                (event.position == position && planarLeft))
+                sides[event.primitive] = Side::Low;
+            else
+                sides[event.primitive] = Side::High;
+        }
     }
 
-    divisionPlane = (data[next - 1].first + data[next].first) / 2;
-
-    std::vector<Objects::Triangle> leftTriangles, rightTriangles;
-    leftTriangles.reserve(next);
-    rightTriangles.reserve(triangles.size() - next + 1);
-
-    switch (divisionAxis) {
-        case Axis::x:
-            for (auto& triangle : triangles) {
-                if (triangle.v1.x <= divisionPlane ||
-                    triangle.v2.x <= divisionPlane ||
-                    triangle.v3.x <= divisionPlane)
-                    leftTriangles.push_back(triangle);
-                if (triangle.v1.x > divisionPlane ||
-                    triangle.v2.x > divisionPlane ||
-                    triangle.v3.x > divisionPlane)
-                    rightTriangles.push_back(triangle);
-            }
-            break;
-        case Axis::y:
-            for (auto& triangle : triangles) {
-                if (triangle.v1.y <= divisionPlane ||
-                    triangle.v2.y <= divisionPlane ||
-                    triangle.v3.y <= divisionPlane)
-                    leftTriangles.push_back(triangle);
-                if (triangle.v1.y > divisionPlane ||
-                    triangle.v2.y > divisionPlane ||
-                    triangle.v3.y > divisionPlane)
-                    rightTriangles.push_back(triangle);
+    // primitives on both sides are clipped to the child's bounds. their
+    // events are created again, while the others keep their sorted events
+    std::vector<int> newIndices(count);
+    auto collect = [&](Side side, std::vector<BuildPrimitive>& output) {
+        for (int i = 0; i < count; i++) {
+            if (sides[i] == side) {
+                newIndices[i] = output.size();
+                output.push_back(primitives[i]);
             }
-            break;
-        case Axis::z:
-            for (auto& triangle : triangles) {
-                if (triangle.v1.z <= divisionPlane ||
-                    triangle.v2.z <= divisionPlane ||
-                    triangle.v3.z <= divisionPlane)
-                    leftTriangles.push_back(triangle);
-                if (triangle.v1.z > divisionPlane ||
-                    triangle.v2.z > divisionPlane ||
-                    triangle.v3.z > divisionPlane)
-                    rightTriangles.push_back(triangle);
+        }
+        int bothBegin = output.size();
+        for (int i = 0; i < count; i++) {
+            if (sides[i] == Side::Both) {
+                auto primitive = primitives[i];
+                primitive.shared = true;
+                if (side == Side::Low)
+                    primitive.box.max[axis] = position;
+                else
+                    primitive.box.min[axis] = position;
+                output.push_back(primitive);
             }
-            break;
+        }
+        return bothBegin;
+    };
+    std::vector<BuildPrimitive> lowPrimitives, highPrimitives;
+    int lowBothBegin = collect(Side::Low, lowPrimitives);
+    int highBothBegin = collect(Side::High, highPrimitives);
+
+    EventLists lowEvents, highEvents;
+    for (int eventAxis = 0; eventAxis < 3; eventAxis++) {
+        std::vector<Event> lowOnly, highOnly;
+        for (auto& event : events[eventAxis]) {
+            if (sides[event.primitive] == Side::Low)
+                lowOnly.push_back(
+                  { event.position, newIndices[event.primitive], event.type });
+            else if (sides[event.primitive] == Side::High)
+                highOnly.push_back(
+                  { event.position, newIndices[event.primitive], event.type });
+        }
+        events[eventAxis].clear();
+        events[eventAxis].shrink_to_fit();
+
+        std::vector<Event> lowBoth, highBoth;
+        addEvents(lowPrimitives,
+                  lowBothBegin,
+                  lowPrimitives.size(),
+                  eventAxis,
+                  lowBoth);
+        addEvents(highPrimitives,
+                  highBothBegin,
+                  highPrimitives.size(),
+                  eventAxis,
+                  highBoth);
+        std::sort(lowBoth.begin(), lowBoth.end());
+        std::sort(highBoth.begin(), highBoth.end());
+
+        lowEvents[eventAxis].resize(lowOnly.size() + lowBoth.size());
+        std::merge(lowOnly.begin(),
+                   lowOnly.end(),
+                   lowBoth.begin(),
+                   lowBoth.end(),
+                   lowEvents[eventAxis].begin());
+        highEvents[eventAxis].resize(highOnly.size() + highBoth.size());
+        std::merge(highOnly.begin(),
+                   highOnly.end(),
+                   highBoth.begin(),
+                   highBoth.end(),
+                   highEvents[eventAxis].begin());
     }
+    primitives.clear();
+    primitives.shrink_to_fit();
 
-    // make sure number of triangles are decreasing as we go down the tree
-    if (leftTriangles.size() == triangles.size() ||
-        rightTriangles.size() == triangles.size()) {
-        BruteForce::build(std::move(triangles));
-        return;
-    }
+    AxisAlignedBox lowBounds = bounds, highBounds = bounds;
+    lowBounds.max[axis] = position;
+    highBounds.min[axis] = position;
 
     left = std::make_unique<KDTreeNode>();
     right = std::make_unique<KDTreeNode>();
 
-    // build children with next axis
-    switch (divisionAxis) {
-        case Axis::x:
-            left->build(std::move(leftTriangles), Axis::y);
-            right->build(std::move(rightTriangles), Axis::y);
-            break;
-        case Axis::y:
-            left->build(std::move(leftTriangles), Axis::z);
-            right->build(std::move(rightTriangles), Axis::z);
-            break;
-        case Axis::z:
-            left->build(std::move(leftTriangles), Axis::x);
-            right->build(std::move(rightTriangles), Axis::x);
-            break;
+    if (count < KD_PARALLEL_BUILD_THRESHOLD) {
+        left->buildNode(std::move(lowPrimitives),
+                        std::move(lowEvents),
+                        lowBounds,
+                        remainingDepth - 1);
+        right->buildNode(std::move(highPrimitives),
+                         std::move(highEvents),
+                         highBounds,
+                         remainingDepth - 1);
+        return;
     }
+
+    // large subtrees are built in parallel
+    auto& pool = ThreadPool::shared();
+    auto rightBuilt = pool.submit([&] {
+        right->buildNode(std::move(highPrimitives),
+                         std::move(highEvents),
+                         highBounds,
+                         remainingDepth - 1);
+    });
+    left->buildNode(std::move(lowPrimitives),
+                    std::move(lowEvents),
+                    lowBounds,
+                    remainingDepth - 1);
+    pool.wait(rightBuilt);
+}
 }
-}
\ No newline at end of file
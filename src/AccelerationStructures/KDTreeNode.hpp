@@ -11,11 +11,20 @@
 
 #pragma once
 
-#include "BruteForce.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include "AccelerationStructureStats.hpp"
+#include "AxisAlignedBox.hpp"
+#include "MeshGeometry.hpp"
+#include "PrecomputedTriangle.hpp"
+#include "TraversalRay.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace AccelerationStructures {
-class KDTreeNode : protected BruteForce
+class KDTreeNode
 {
 public:
     enum class Axis
@@ -25,38 +34,301 @@ public:
         z
     };
 
+    /**
+     * @brief Primitive IDs recently tested with a ray
+     *
+     * Triangles crossing a division plane are put in the leaves on both sides,
+     * so a ray going through both leaves would test them again. Every ray
+     * has its own mailbox, so threads don't share anything. IDs are kept in a
+     * small hash table where a new ID replaces the one in its slot, so some
+     * repeated tests are not caught.
+     *
+     */
+    class Mailbox
+    {
+    public:
+        /**
+         * @brief Construct an empty Mailbox object
+         *
+         */
+        Mailbox() { ids.fill(emptySlot); }
+
+        /**
+         * @brief Records a test of a triangle
+         *
+         * @param id Primitive ID of the triangle
+         * @return true The triangle is in the mailbox, it was tested with the
+         * ray before
+         * @return false
+         */
+        bool testedBefore(std::uint32_t id)
+        {
+            auto& slot = ids[id % KD_MAILBOX_SIZE];
+            if (slot == id)
+                return true;
+            slot = id;
+            return false;
+        }
+
+    private:
+        /**
+         * @brief Value of slots that no ID was put in
+         *
+         */
+        static constexpr std::uint32_t emptySlot = ~std::uint32_t(0);
+
+        /**
+         * @brief Tested IDs, each in the slot at its value modulo the size
+         *
+         */
+        std::array<std::uint32_t, KD_MAILBOX_SIZE> ids;
+    };
+
     /**
      * @brief Finds the closest intersection in front of the ray
      *
      * Finds the closest intersection with a triangle. If found, returns the t
      * value at intersection and sets normalOut.
      *
+     * @param triangles Triangles of the tree, indexed by primitive ID
      * @param ray Ray to test intersection with
      * @param normalOut If return value is not -1, set to the surface normal at
      * intersection point
+     * @param minT t value at which we enter the box
      * @param maxT t value at which we leave the box
+     * @param mailbox Triangles in several leaves that were already tested with
+     * this ray, which are skipped. Their hits are taken into account where
+     * they were tested.
      * @return If there was no intersection in front of the ray, -1.
      * Else, a positive t value such that origin + t * direction is on the
      * closest triangle
      */
-    FloatT intersect(const Objects::Ray& ray,
+    FloatT intersect(const std::vector<PrecomputedTriangle>& triangles,
+                     const TraversalRay& ray,
                      LinearAlgebra::Vec3& normalOut,
-                     FloatT maxT) const;
+                     FloatT minT,
+                     FloatT maxT,
+                     Mailbox& mailbox) const;
 
     /**
-     * @brief Builds the acceleration structure from a vector of triangles
+     * @brief Checks if any triangle is hit in front of the ray before tMax
      *
-     * Uses the surface area heuristic (tries to make the total surface area of
-     * two children close to equal)
+     * Stops at the first intersection found.
      *
-     * @param triangles Triangles in this acceleration structure. The vector
-     * will be destroyed by this function. Use std::move to convert vector to
-     * an rvalue.
-     * @param divisionAxis axis to divide the triangles on
+     * @param triangles Triangles of the tree, indexed by primitive ID
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @param minT t value at which we enter the box
+     * @param maxT t value at which we leave the box
+     * @param mailbox Triangles in several leaves that were already tested with
+     * this ray, which are skipped
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
      */
-    void build(std::vector<Objects::Triangle>&& triangles, Axis divisionAxis);
+    bool occluded(const std::vector<PrecomputedTriangle>& triangles,
+                  const TraversalRay& ray,
+                  FloatT tMax,
+                  FloatT minT,
+                  FloatT maxT,
+                  Mailbox& mailbox) const;
+
+    /**
+     * @brief Builds the tree for the triangles of a mesh
+     *
+     * Uses the surface area heuristic. Candidate planes are the bounds of the
+     * triangles on all three axes. They are kept sorted in event lists, which
+     * are split between the children without sorting them again, so building
+     * takes O(N log N) time.
+     *
+     * @param geometry Triangles in this tree. Leaves keep their primitive
+     * IDs.
+     * @param bounds Bounding box of all triangles
+     */
+    void build(const Objects::MeshGeometry& geometry,
+               const AxisAlignedBox& bounds);
+
+    /**
+     * @brief Memory allocated by this subtree, including this node
+     *
+     * @return std::size_t Size in bytes
+     */
+    std::size_t getMemoryUsage() const;
+
+    /**
+     * @brief Adds the nodes of this subtree to stats
+     *
+     * @param bounds Box of this node
+     * @param depth Depth of this node, 0 for the root
+     * @param stats
+     */
+    void collectStats(const AxisAlignedBox& bounds,
+                      int depth,
+                      AccelerationStructureStats& stats) const;
 
 protected:
+    /**
+     * @brief A triangle during construction
+     *
+     */
+    struct BuildPrimitive
+    {
+        /**
+         * @brief Bounding box of the triangle, clipped to the node
+         *
+         */
+        AxisAlignedBox box;
+
+        /**
+         * @brief Primitive ID of the triangle
+         *
+         */
+        std::uint32_t triangle;
+
+        /**
+         * @brief Whether the triangle was put in both children of a node
+         * above, so that it is in more than one leaf
+         *
+         */
+        bool shared = false;
+    };
+
+    /**
+     * @brief Start or end of a primitive's bounds on an axis
+     *
+     */
+    struct Event
+    {
+        /**
+         * @brief Types of events. Order is important, at the same position,
+         * ends come before planars and starts.
+         *
+         */
+        enum class Type : char
+        {
+            End,
+            Planar,
+            Start
+        };
+
+        /**
+         * @brief Coordinate of the event on its axis
+         *
+         */
+        FloatT position;
+
+        /**
+         * @brief Index of the primitive in the node's primitive array
+         *
+         */
+        int primitive;
+
+        /**
+         * @brief Planar events are for primitives with no extent on the axis
+         *
+         */
+        Type type;
+
+        /**
+         * @brief Sorts w.r.t. position, then type
+         *
+         */
+        bool operator<(const Event& other) const;
+    };
+
+    /**
+     * @brief Sorted events of a node, one list for each axis
+     *
+     */
+    using EventLists = std::array<std::vector<Event>, 3>;
+
+    /**
+     * @brief Finds the order in which the ray visits the children
+     *
+     * @param ray
+     * @param nearOut Set to the child that contains the origin of the ray
+     * @param farOut Set to the other child
+     * @param planeTOut If return value is true, set to the t value at which
+     * the ray crosses the division plane
+     * @return true The ray crosses the division plane in front of it
+     * @return false The ray stays in nearOut
+     */
+    bool orderChildren(const TraversalRay& ray,
+                       KDTreeNode*& nearOut,
+                       KDTreeNode*& farOut,
+                       FloatT& planeTOut) const;
+
+    /**
+     * @brief Builds the subtree with the given primitives
+     *
+     * @param primitives Primitives in this node. Destroyed by this function.
+     * @param events Sorted events of primitives. Destroyed by this function.
+     * @param bounds Bounds of this node
+     * @param remainingDepth Node becomes a leaf if this is 0
+     */
+    void buildNode(std::vector<BuildPrimitive>&& primitives,
+                   EventLists&& events,
+                   const AxisAlignedBox& bounds,
+                   int remainingDepth);
+
+    /**
+     * @brief Finds the cheapest division plane using the surface area
+     * heuristic
+     *
+     * Sweeps the event list of each axis once.
+     *
+     * @param primitiveCount Number of primitives in the node
+     * @param events Sorted events of the node
+     * @param bounds Bounds of the node
+     * @param costOut Set to the cost of the split, relative to the cost of
+     * intersecting a single triangle
+     * @param axisOut Set to the axis of the plane
+     * @param positionOut Set to the coordinate of the plane
+     * @param planarLeftOut Set to true if primitives lying on the plane should
+     * go to the lower child
+     * @return true A split was found
+     * @return false Node can't be divided
+     */
+    static bool findSplit(int primitiveCount,
+                          const EventLists& events,
+                          const AxisAlignedBox& bounds,
+                          FloatT& costOut,
+                          int& axisOut,
+                          FloatT& positionOut,
+                          bool& planarLeftOut);
+
+    /**
+     * @brief Appends the events of a range of primitives on an axis
+     *
+     * @param primitives
+     * @param first Index of the first primitive
+     * @param end Index after the last primitive
+     * @param axis 0, 1 or 2 for x, y and z
+     * @param output Vector to append the events to. Not sorted.
+     */
+    static void addEvents(const std::vector<BuildPrimitive>& primitives,
+                          int first,
+                          int end,
+                          int axis,
+                          std::vector<Event>& output);
+
+    /**
+     * @brief Primitive IDs of the triangles in a leaf. Empty for interior
+     * nodes.
+     *
+     * A triangle may be in several leaves, but only its ID is repeated. IDs of
+     * such triangles have sharedFlag set, only they are put in the mailbox of
+     * a ray.
+     *
+     */
+    std::vector<std::uint32_t> primitiveIds;
+
+    /**
+     * @brief Highest bit of an entry of primitiveIds, set if the triangle is
+     * in other leaves too
+     *
+     */
+    static constexpr std::uint32_t sharedFlag = std::uint32_t(1) << 31;
+
     /**
      * @brief Division axis
      *
@@ -0,0 +1,53 @@
+#include "MappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace AccelerationStructures {
+std::shared_ptr<const MappedFile>
+MappedFile::open(const std::string& fileName)
+{
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor == -1)
+        return nullptr;
+
+    struct stat status;
+    if (fstat(descriptor, &status) == -1 || status.st_size == 0) {
+        close(descriptor);
+        return nullptr;
+    }
+
+    std::size_t size = status.st_size;
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // the mapping stays valid after the file is closed
+    close(descriptor);
+    if (address == MAP_FAILED)
+        return nullptr;
+
+    return std::shared_ptr<const MappedFile>(
+      new MappedFile(static_cast<const char*>(address), size));
+}
+
+MappedFile::MappedFile(const char* data, std::size_t size)
+  : data(data)
+  , size(size)
+{}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<char*>(data), size);
+}
+
+const char*
+MappedFile::getData() const
+{
+    return data;
+}
+
+std::size_t
+MappedFile::getSize() const
+{
+    return size;
+}
+}
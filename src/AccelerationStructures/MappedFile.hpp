@@ -0,0 +1,77 @@
+/**
+ * @file MappedFile.hpp
+ * @author Cem Gundogdu
+ * @brief Read-only memory mapping of a file
+ * @version 1.0
+ * @date 2021-05-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace AccelerationStructures {
+/**
+ * @brief A file mapped into memory for reading
+ *
+ * The contents are loaded by the operating system when they are first
+ * accessed, so opening a large file is cheap. The mapping is removed when the
+ * object is destroyed, so keep a shared pointer as long as the data is used.
+ *
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Maps the whole file into memory
+     *
+     * @param fileName
+     * @return std::shared_ptr<const MappedFile> null if the file can't be
+     * opened or is empty
+     */
+    static std::shared_ptr<const MappedFile> open(const std::string& fileName);
+
+    /**
+     * @brief Removes the mapping
+     *
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Start of the file's contents. Aligned to a memory page.
+     *
+     * @return const char*
+     */
+    const char* getData() const;
+
+    /**
+     * @brief Size of the file
+     *
+     * @return std::size_t Size in bytes
+     */
+    std::size_t getSize() const;
+
+private:
+    MappedFile(const char* data, std::size_t size);
+
+    /**
+     * @brief Start of the mapping
+     *
+     */
+    const char* data;
+
+    /**
+     * @brief Size of the mapping in bytes
+     *
+     */
+    std::size_t size;
+};
+}
@@ -0,0 +1,455 @@
+#include "MortonBoundingVolumeHierarchy.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace AccelerationStructures {
+namespace {
+/**
+ * @brief Bits sorted by each pass of the radix sort
+ *
+ */
+constexpr int radixBits = 8;
+
+/**
+ * @brief Spreads the lower 21 bits of a value so that there are two zero
+ * bits between each of them
+ *
+ * @param value
+ * @return std::uint64_t
+ */
+std::uint64_t
+spreadBits(std::uint64_t value)
+{
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffff;
+    value = (value | value << 16) & 0x1f0000ff0000ff;
+    value = (value | value << 8) & 0x100f00f00f00f00f;
+    value = (value | value << 4) & 0x10c30c30c30c30c3;
+    value = (value | value << 2) & 0x1249249249249249;
+    return value;
+}
+
+/**
+ * @brief Node of the tree that joins the clusters
+ *
+ */
+struct ClusterNode
+{
+    /**
+     * @brief Bounding box of the triangles under the node
+     *
+     */
+    AxisAlignedBox box;
+
+    /**
+     * @brief Index of the cluster for leaves, -1 for merged nodes
+     *
+     */
+    int cluster;
+
+    /**
+     * @brief Indices of the merged nodes
+     *
+     */
+    int children[2];
+};
+
+/**
+ * @brief Appends the nodes under a cluster node to output in depth-first
+ * order
+ *
+ * @param clusterNodes
+ * @param index Index of the cluster node
+ * @param subtrees Nodes of the subtree of each cluster
+ * @param output
+ * @return Index of the first appended node in output
+ */
+int
+appendClusterNode(const std::vector<ClusterNode>& clusterNodes,
+                  int index,
+                  const std::vector<std::vector<LinearBVHNode>>& subtrees,
+                  std::vector<LinearBVHNode>& output)
+{
+    auto& clusterNode = clusterNodes[index];
+    int nodeIndex = output.size();
+    if (clusterNode.cluster != -1) {
+        for (auto node : subtrees[clusterNode.cluster]) {
+            if (!node.primitiveCount)
+                node.secondChildOffset += nodeIndex;
+            output.push_back(node);
+        }
+        return nodeIndex;
+    }
+
+    output.emplace_back();
+    output[nodeIndex].primitiveCount = 0;
+    output[nodeIndex].axis = 0;
+    appendClusterNode(clusterNodes, clusterNode.children[0], subtrees, output);
+    int secondChild = appendClusterNode(
+      clusterNodes, clusterNode.children[1], subtrees, output);
+    output[nodeIndex].secondChildOffset = secondChild;
+    return nodeIndex;
+}
+}
+
+MortonBoundingVolumeHierarchy::MortonBoundingVolumeHierarchy(
+  int mortonBits,
+  int topClusterCount,
+  FloatT rebuildThreshold,
+  int nodeBits,
+  int width)
+  : BoundingVolumeHierarchy(rebuildThreshold, nodeBits, width)
+  , mortonBits(mortonBits)
+  , topClusterCount(topClusterCount)
+{}
+
+std::uint64_t
+MortonBoundingVolumeHierarchy::getCacheSettingsHash() const
+{
+    CacheKeyHasher hasher;
+    hasher.add("lbvh", 4);
+    hasher.add(mortonBits);
+    hasher.add(topClusterCount);
+    hasher.add(nodeBits);
+    hasher.add(width);
+    return hasher.getValue();
+}
+
+void
+MortonBoundingVolumeHierarchy::buildStructure()
+{
+    int count = geometry->getTriangleCount();
+    if (!count) {
+        // the base build makes a root leaf with no primitives
+        BoundingVolumeHierarchy::buildStructure();
+        return;
+    }
+    createBoundingBox();
+
+    auto& pool = ThreadPool::shared();
+    int chunkCount = buildChunkCount(count);
+    buildPrimitives.resize(count);
+    std::vector<AxisAlignedBox> chunkBounds(chunkCount);
+    pool.parallelFor(
+      0, count, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              AxisAlignedBox box(geometry->getTriangle(i));
+              buildPrimitives[i] = { box, box.center(), std::uint32_t(i) };
+              chunkBounds[chunk].extend(buildPrimitives[i].center);
+          }
+      });
+
+    // the grid covers the centroids, not the triangles, so that its cells
+    // are as small as possible
+    AxisAlignedBox centerBounds;
+    for (auto& box : chunkBounds)
+        centerBounds.extend(box);
+    std::vector<MortonPrimitive> mortonPrimitives(count);
+    pool.parallelFor(
+      0, count, chunkCount, [&](int, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              mortonPrimitives[i] = {
+                  mortonCode(buildPrimitives[i].center, centerBounds),
+                  std::uint32_t(i)
+              };
+          }
+      });
+    sortByMortonCode(mortonPrimitives);
+
+    std::vector<BuildPrimitive> sortedPrimitives(count);
+    sortedCodes.resize(count);
+    pool.parallelFor(
+      0, count, chunkCount, [&](int, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              sortedPrimitives[i] = buildPrimitives[mortonPrimitives[i].index];
+              sortedCodes[i] = mortonPrimitives[i].code;
+          }
+      });
+    buildPrimitives.swap(sortedPrimitives);
+    sortedPrimitives.clear();
+    sortedPrimitives.shrink_to_fit();
+    mortonPrimitives.clear();
+    mortonPrimitives.shrink_to_fit();
+
+    // clusters smaller than a leaf would make leaves with fewer triangles
+    // than the other builders
+    int clusterSize = count;
+    if (topClusterCount > 1)
+        clusterSize = std::max((count + topClusterCount - 1) / topClusterCount,
+                               BVH_BRUTE_FORCE_THRESHOLD);
+    std::vector<MortonCluster> clusters;
+    collectClusters({ 0, count, mortonBits - 1 }, clusterSize, clusters);
+
+    nodes.clear();
+    nodes.reserve(2 * count);
+    if (clusters.size() == 1)
+        buildMortonNode(clusters[0], nodes);
+    else
+        buildClusteredNodes(clusters);
+    fitBounds();
+    nodes.shrink_to_fit();
+
+    std::vector<std::uint32_t> orderedIds;
+    orderedIds.reserve(count);
+    for (auto& primitive : buildPrimitives)
+        orderedIds.push_back(primitive.index);
+
+    buildPrimitives.clear();
+    buildPrimitives.shrink_to_fit();
+    sortedCodes.clear();
+    sortedCodes.shrink_to_fit();
+
+    addLeafBlocks(orderedIds);
+}
+
+std::uint64_t
+MortonBoundingVolumeHierarchy::mortonCode(const LinearAlgebra::Vec3& point,
+                                          const AxisAlignedBox& bounds) const
+{
+    int axisBits = mortonBits / 3;
+    FloatT cells = std::uint64_t(1) << axisBits;
+    std::uint64_t code = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        FloatT extent = bounds.max[axis] - bounds.min[axis];
+        FloatT position =
+          extent > 0 ? (point[axis] - bounds.min[axis]) / extent * cells : 0;
+        auto cell = std::uint64_t(std::clamp<FloatT>(position, 0, cells - 1));
+
+        // x is the highest bit of each group of three
+        code |= spreadBits(cell) << (2 - axis);
+    }
+    return code;
+}
+
+void
+MortonBoundingVolumeHierarchy::sortByMortonCode(
+  std::vector<MortonPrimitive>& primitives) const
+{
+    constexpr int digitCount = 1 << radixBits;
+    constexpr std::uint64_t digitMask = digitCount - 1;
+    int count = primitives.size();
+    int chunkCount = buildChunkCount(count);
+    auto& pool = ThreadPool::shared();
+    std::vector<MortonPrimitive> scratch(count);
+    std::vector<std::array<int, digitCount>> offsets(chunkCount);
+
+    for (int shift = 0; shift < mortonBits; shift += radixBits) {
+        pool.parallelFor(
+          0, count, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+              offsets[chunk].fill(0);
+              for (int i = chunkBegin; i < chunkEnd; i++)
+                  offsets[chunk][primitives[i].code >> shift & digitMask]++;
+          });
+
+        // entries with the same digit are written in the order of their
+        // chunks, which keeps the sort stable
+        int offset = 0;
+        for (int digit = 0; digit < digitCount; digit++) {
+            for (int chunk = 0; chunk < chunkCount; chunk++) {
+                int digitCountInChunk = offsets[chunk][digit];
+                offsets[chunk][digit] = offset;
+                offset += digitCountInChunk;
+            }
+        }
+
+        pool.parallelFor(
+          0, count, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+              for (int i = chunkBegin; i < chunkEnd; i++) {
+                  int digit = primitives[i].code >> shift & digitMask;
+                  scratch[offsets[chunk][digit]++] = primitives[i];
+              }
+          });
+        primitives.swap(scratch);
+    }
+}
+
+int
+MortonBoundingVolumeHierarchy::findMortonSplit(int begin,
+                                               int end,
+                                               int& bit) const
+{
+    std::uint64_t difference = sortedCodes[begin] ^ sortedCodes[end - 1];
+    if (!difference)
+        return (begin + end) / 2;
+
+    // codes are sorted, so the ones with a 0 at the highest different bit
+    // come first
+    while (!(difference >> bit & 1))
+        bit--;
+    auto middle = std::partition_point(
+      sortedCodes.begin() + begin,
+      sortedCodes.begin() + end,
+      [&](std::uint64_t code) { return !(code >> bit & 1); });
+    return middle - sortedCodes.begin();
+}
+
+void
+MortonBoundingVolumeHierarchy::collectClusters(
+  const MortonCluster& cluster,
+  int clusterSize,
+  std::vector<MortonCluster>& output) const
+{
+    if (cluster.end - cluster.begin <= clusterSize) {
+        output.push_back(cluster);
+        return;
+    }
+    int bit = cluster.bit;
+    int middle = findMortonSplit(cluster.begin, cluster.end, bit);
+    collectClusters({ cluster.begin, middle, bit - 1 }, clusterSize, output);
+    collectClusters({ middle, cluster.end, bit - 1 }, clusterSize, output);
+}
+
+int
+MortonBoundingVolumeHierarchy::buildMortonNode(
+  const MortonCluster& cluster,
+  std::vector<LinearBVHNode>& output) const
+{
+    int begin = cluster.begin, end = cluster.end;
+    int nodeIndex = output.size();
+    output.emplace_back();
+    if (end - begin <= BVH_BRUTE_FORCE_THRESHOLD) {
+        // replaced with the index of the first block at the end of build()
+        output[nodeIndex].primitiveOffset = begin;
+        output[nodeIndex].primitiveCount = end - begin;
+        output[nodeIndex].axis = 0;
+        return nodeIndex;
+    }
+
+    // triangles with the same code are divided in the middle
+    int bit = cluster.bit;
+    int middle = findMortonSplit(begin, end, bit);
+    MortonCluster first = { begin, middle, bit - 1 };
+    MortonCluster second = { middle, end, bit - 1 };
+
+    int secondChild;
+    if (end - begin >= BVH_PARALLEL_BUILD_THRESHOLD) {
+        auto& pool = ThreadPool::shared();
+        std::vector<LinearBVHNode> secondNodes;
+        auto future =
+          pool.submit([&] { buildMortonNode(second, secondNodes); });
+        buildMortonNode(first, output);
+        pool.wait(future);
+
+        secondChild = output.size();
+        for (auto node : secondNodes) {
+            if (!node.primitiveCount)
+                node.secondChildOffset += secondChild;
+            output.push_back(node);
+        }
+    } else {
+        buildMortonNode(first, output);
+        secondChild = buildMortonNode(second, output);
+    }
+
+    output[nodeIndex].secondChildOffset = secondChild;
+    output[nodeIndex].primitiveCount = 0;
+
+    // x, y and z bits repeat from the highest one down
+    output[nodeIndex].axis = bit < 0 ? 0 : 2 - bit % 3;
+    return nodeIndex;
+}
+
+void
+MortonBoundingVolumeHierarchy::buildClusteredNodes(
+  const std::vector<MortonCluster>& clusters)
+{
+    int clusterCount = clusters.size();
+    std::vector<std::vector<LinearBVHNode>> subtrees(clusterCount);
+    std::vector<ClusterNode> clusterNodes(clusterCount);
+    auto& pool = ThreadPool::shared();
+    int chunkCount = 1;
+    if (buildChunkCount(clusters.back().end) > 1)
+        chunkCount = std::min(clusterCount, pool.getThreadCount());
+    pool.parallelFor(
+      0, clusterCount, chunkCount, [&](int, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              auto& cluster = clusters[i];
+              buildMortonNode(cluster, subtrees[i]);
+              AxisAlignedBox box;
+              for (int j = cluster.begin; j < cluster.end; j++)
+                  box.extend(buildPrimitives[j].box);
+              clusterNodes[i] = { box, i, { -1, -1 } };
+          }
+      });
+
+    // merge the pair whose union has the smallest area until one node is
+    // left. each node remembers its best partner, which is searched again
+    // only if the partner was merged with another node
+    std::vector<int> active(clusterCount), partners(clusterCount);
+    std::vector<FloatT> partnerAreas(clusterCount);
+    auto findPartner = [&](int node) {
+        FloatT bestArea = std::numeric_limits<FloatT>::infinity();
+        int best = -1;
+        for (int other : active) {
+            if (other == node)
+                continue;
+            auto box = clusterNodes[node].box;
+            box.extend(clusterNodes[other].box);
+            FloatT area = box.surfaceArea();
+            if (area < bestArea || best == -1) {
+                bestArea = area;
+                best = other;
+            }
+        }
+        partners[node] = best;
+        partnerAreas[node] = bestArea;
+    };
+    for (int i = 0; i < clusterCount; i++)
+        active[i] = i;
+    for (int node : active)
+        findPartner(node);
+
+    while (active.size() > 1) {
+        int first = active[0];
+        for (int node : active) {
+            if (partnerAreas[node] < partnerAreas[first])
+                first = node;
+        }
+        int second = partners[first];
+
+        auto box = clusterNodes[first].box;
+        box.extend(clusterNodes[second].box);
+        int merged = clusterNodes.size();
+        clusterNodes.push_back({ box, -1, { first, second } });
+        partners.push_back(-1);
+        partnerAreas.push_back(0);
+        active.erase(std::remove_if(active.begin(),
+                                    active.end(),
+                                    [&](int node) {
+                                        return node == first ||
+                                               node == second;
+                                    }),
+                     active.end());
+        active.push_back(merged);
+
+        for (int node : active) {
+            if (node == merged || partners[node] == first ||
+                partners[node] == second)
+                findPartner(node);
+        }
+    }
+
+    appendClusterNode(clusterNodes, active[0], subtrees, nodes);
+}
+
+void
+MortonBoundingVolumeHierarchy::fitBounds()
+{
+    // children come after their parents in the array, so going backwards
+    // visits both children of a node before the node itself
+    for (int i = nodes.size() - 1; i >= 0; i--) {
+        auto& node = nodes[i];
+        AxisAlignedBox box;
+        if (node.primitiveCount) {
+            for (int j = 0; j < node.primitiveCount; j++)
+                box.extend(buildPrimitives[node.primitiveOffset + j].box);
+        } else {
+            box = nodes[i + 1].getBounds();
+            box.extend(nodes[node.secondChildOffset].getBounds());
+        }
+        node.setBounds(box);
+    }
+}
+}
@@ -0,0 +1,216 @@
+/**
+ * @file MortonBoundingVolumeHierarchy.hpp
+ * @author Cem Gundogdu
+ * @brief
+ * @version 1.0
+ * @date 2021-05-18
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AccelerationStructureConstants.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace AccelerationStructures {
+/**
+ * @brief Linear bounding volume hierarchy (LBVH), built by sorting the
+ * triangles along a Morton curve
+ *
+ * Centroids of the triangles are quantized to a grid and ordered by their
+ * Morton codes, which interleave the bits of the grid coordinates, with a
+ * parallel radix sort. Triangles that are close in space are then close in
+ * the sorted array, and each node is divided where the highest bit that
+ * differs among its codes changes. The build costs little more than the sort,
+ * but the tree is worse than with the surface area heuristic.
+ *
+ * To recover some of the quality, the sorted triangles can be divided into
+ * about topClusterCount subtrees, which are joined by agglomerative
+ * clustering: the two subtrees whose union has the smallest surface area are
+ * merged repeatedly, like in HLBVH.
+ *
+ * Traversal is the same as BoundingVolumeHierarchy.
+ *
+ */
+class MortonBoundingVolumeHierarchy : public BoundingVolumeHierarchy
+{
+public:
+    /**
+     * @brief Construct a new MortonBoundingVolumeHierarchy object
+     *
+     * @param mortonBits Bits of the Morton codes, 30 or 63. 10 or 21 bits per
+     * axis.
+     * @param topClusterCount Number of subtrees joined by agglomerative
+     * clustering at the top of the tree. 0 or 1 uses the Morton order for the
+     * whole tree.
+     * @param rebuildThreshold See BoundingVolumeHierarchy
+     * @param nodeBits See BoundingVolumeHierarchy
+     * @param width See BoundingVolumeHierarchy
+     */
+    MortonBoundingVolumeHierarchy(
+      int mortonBits = LBVH_MORTON_BITS,
+      int topClusterCount = LBVH_TOP_CLUSTER_COUNT,
+      FloatT rebuildThreshold = BVH_REFIT_REBUILD_THRESHOLD,
+      int nodeBits = BVH_FULL_NODE_BITS,
+      int width = BVH_DEFAULT_WIDTH);
+
+protected:
+    /**
+     * @brief Hash of the builder type, the code length and the cluster count
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t getCacheSettingsHash() const override;
+
+    /**
+     * @brief Builds the tree for the triangles in geometry
+     *
+     * Sorts buildPrimitives by Morton code, builds the subtrees of the
+     * clusters in parallel, joins them and computes the boxes of all nodes
+     * bottom-up.
+     *
+     */
+    void buildStructure() override;
+
+    /**
+     * @brief Index of a triangle with its Morton code
+     *
+     */
+    struct MortonPrimitive
+    {
+        /**
+         * @brief Interleaved grid coordinates of the centroid
+         *
+         */
+        std::uint64_t code;
+
+        /**
+         * @brief Index of the triangle in buildPrimitives
+         *
+         */
+        std::uint32_t index;
+    };
+
+    /**
+     * @brief Range of the sorted triangles that becomes a subtree
+     *
+     */
+    struct MortonCluster
+    {
+        /**
+         * @brief Index of the first primitive in buildPrimitives
+         *
+         */
+        int begin;
+
+        /**
+         * @brief Index after the last primitive in buildPrimitives
+         *
+         */
+        int end;
+
+        /**
+         * @brief Highest bit that may differ between the codes of the range
+         *
+         */
+        int bit;
+    };
+
+    /**
+     * @brief Morton code of a point
+     *
+     * @param point
+     * @param bounds Box that is divided into the grid
+     * @return std::uint64_t
+     */
+    std::uint64_t mortonCode(const LinearAlgebra::Vec3& point,
+                             const AxisAlignedBox& bounds) const;
+
+    /**
+     * @brief Sorts by Morton code with a stable least significant digit radix
+     * sort
+     *
+     * Each pass counts the digits of chunks of the array in parallel, then
+     * every chunk knows where to write its entries.
+     *
+     * @param primitives
+     */
+    void sortByMortonCode(std::vector<MortonPrimitive>& primitives) const;
+
+    /**
+     * @brief Finds where a range of sorted codes is divided into two
+     *
+     * @param begin Index of the first code in sortedCodes
+     * @param end Index after the last code in sortedCodes
+     * @param bit Highest bit that may differ in the range. Set to the highest
+     * bit that differs, which is 0 in the first part and 1 in the second part.
+     * @return Index of the first code of the second part. The middle of the
+     * range if all codes are the same.
+     */
+    int findMortonSplit(int begin, int end, int& bit) const;
+
+    /**
+     * @brief Divides a range of the sorted triangles until each part has at
+     * most clusterSize triangles
+     *
+     * @param cluster Range to divide
+     * @param clusterSize
+     * @param output Parts are appended here in order
+     */
+    void collectClusters(const MortonCluster& cluster,
+                         int clusterSize,
+                         std::vector<MortonCluster>& output) const;
+
+    /**
+     * @brief Builds the subtree of a range of the sorted triangles
+     *
+     * Appends the root of the subtree to output, then builds its children.
+     * Boxes are not set, see fitBounds(). Children of large nodes are built in
+     * parallel.
+     *
+     * @param cluster Range of the subtree
+     * @param output Node array to append the subtree to. Indices of second
+     * children are relative to the beginning of this array.
+     * @return Index of the root of the subtree in output
+     */
+    int buildMortonNode(const MortonCluster& cluster,
+                        std::vector<LinearBVHNode>& output) const;
+
+    /**
+     * @brief Builds the subtrees of the clusters and joins them by merging
+     * the two with the smallest union repeatedly
+     *
+     * @param clusters Ranges of the subtrees, at least two
+     */
+    void buildClusteredNodes(const std::vector<MortonCluster>& clusters);
+
+    /**
+     * @brief Sets the boxes of the nodes, from the triangles of the leaves
+     * up
+     *
+     */
+    void fitBounds();
+
+    /**
+     * @brief Bits of the Morton codes, 30 or 63
+     *
+     */
+    int mortonBits;
+
+    /**
+     * @brief Number of subtrees joined by agglomerative clustering
+     *
+     */
+    int topClusterCount;
+
+    /**
+     * @brief Morton codes of buildPrimitives, used only during build()
+     *
+     */
+    std::vector<std::uint64_t> sortedCodes;
+};
+}
@@ -0,0 +1,46 @@
+#include "PrecomputedTriangle.hpp"
+#include "Surface.hpp"
+
+namespace AccelerationStructures {
+PrecomputedTriangle::PrecomputedTriangle(const Objects::Triangle& triangle)
+  : vertex(triangle.v1)
+  , edge1(triangle.v2 - triangle.v1)
+  , edge2(triangle.v3 - triangle.v1)
+  , normal(triangle.getNormal())
+{}
+
+FloatT
+PrecomputedTriangle::intersect(const Objects::Ray& ray) const
+{
+    /**
+     * Solves origin + t * direction = vertex + beta * edge1 + gamma * edge2
+     * using Cramer's rule, where each determinant is written as a scalar
+     * triple product. Products that appear in more than one determinant are
+     * computed once.
+     *
+     */
+    auto p = ray.direction.cross(edge2);
+    auto det = edge1.dot(p);
+    // ray is parallel to the triangle, or the triangle is degenerate
+    if (det == 0)
+        return -1;
+    auto inverseDet = 1 / det;
+
+    auto toOrigin = ray.origin - vertex;
+    auto beta = toOrigin.dot(p) * inverseDet;
+    if (beta <= -Objects::Surface::intersectionTestEpsilon ||
+        beta >= 1 + Objects::Surface::intersectionTestEpsilon)
+        return -1;
+
+    auto q = toOrigin.cross(edge1);
+    auto gamma = ray.direction.dot(q) * inverseDet;
+    if (gamma <= -Objects::Surface::intersectionTestEpsilon ||
+        beta + gamma >= 1 + Objects::Surface::intersectionTestEpsilon)
+        return -1;
+
+    auto t = edge2.dot(q) * inverseDet;
+    if (t <= 0)
+        return -1;
+    return t;
+}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file PrecomputedTriangle.hpp
+ * @author Cem Gundogdu
+ * @brief Triangle representation used in the leaves of acceleration structures
+ * @version 1.0
+ * @date 2021-05-06
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "Ray.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+namespace AccelerationStructures {
+/**
+ * @brief Triangle with the values needed for intersection tests computed in
+ * advance
+ *
+ * Stores a vertex and the two edges starting from it, so that
+ * Möller–Trumbore intersection test can be used. The test needs two cross
+ * products and four dot products, instead of the four 3x3 determinants of
+ * Objects::Triangle::intersect(). Created once when an acceleration structure
+ * is built.
+ *
+ */
+class PrecomputedTriangle
+{
+public:
+    /**
+     * @brief Construct a new PrecomputedTriangle object
+     *
+     * @param triangle
+     */
+    PrecomputedTriangle(const Objects::Triangle& triangle);
+
+    /**
+     * @brief Finds the intersection of given ray with this triangle
+     *
+     * Same as Objects::Triangle::intersect(), up to rounding errors.
+     * Baricentric coordinates are allowed to be in the range
+     * (-epsilon, 1 + epsilon), where epsilon is intersectionTestEpsilon in
+     * Surface class.
+     *
+     * @param ray
+     * @return t for the intersection with ray, -1 if there is no intersection
+     * in front of the ray
+     */
+    FloatT intersect(const Objects::Ray& ray) const;
+
+    /**
+     * @brief First vertex of the triangle
+     *
+     */
+    LinearAlgebra::Vec3 vertex;
+
+    /**
+     * @name Edges
+     *
+     */
+    ///@{
+    /**
+     * @brief Second and third vertices minus the first vertex
+     *
+     */
+    LinearAlgebra::Vec3 edge1, edge2;
+    ///@}
+
+    /**
+     * @brief Unit normal vector, facing the front side
+     *
+     */
+    LinearAlgebra::Vec3 normal;
+};
+}
@@ -0,0 +1,194 @@
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include "AxisAlignedBox.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleBlock.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace AccelerationStructures {
+SAHBoundingVolumeHierarchy::SAHBoundingVolumeHierarchy(FloatT traversalCost,
+                                                       FloatT intersectionCost,
+                                                       FloatT rebuildThreshold,
+                                                       int nodeBits,
+                                                       int width)
+  : BoundingVolumeHierarchy(rebuildThreshold, nodeBits, width)
+  , traversalCost(traversalCost)
+  , intersectionCost(intersectionCost)
+{}
+
+std::uint64_t
+SAHBoundingVolumeHierarchy::getCacheSettingsHash() const
+{
+    CacheKeyHasher hasher;
+    hasher.add("bvh-sah", 7);
+    hasher.add(traversalCost);
+    hasher.add(intersectionCost);
+    hasher.add(nodeBits);
+    hasher.add(width);
+    return hasher.getValue();
+}
+
+int
+SAHBoundingVolumeHierarchy::alignedCount(int triangleCount)
+{
+    // leaves are tested a whole TriangleBlock at a time, so a leaf costs as
+    // much as the number of triangles rounded up to a multiple of block width
+    return TriangleBlock::blockCount(triangleCount) * TriangleBlock::width;
+}
+
+bool
+SAHBoundingVolumeHierarchy::split(int begin,
+                                  int end,
+                                  const AxisAlignedBox& bounds,
+                                  int& middle,
+                                  int& axis)
+{
+    int count = end - begin;
+    if (count <= 1)
+        return false;
+
+    auto best = findObjectSplit(begin, end, bounds);
+    if (best.axis == -1) {
+        // centers of all triangles are at the same point. we can only divide
+        // them arbitrarily
+        if (count <= BVH_SAH_MAX_LEAF_SIZE)
+            return false;
+        middle = begin + count / 2;
+        axis = bounds.longestAxis();
+        return true;
+    }
+
+    FloatT leafCost =
+      intersectionCost * alignedCount(count) * bounds.surfaceArea();
+    if (best.cost >= leafCost && count <= BVH_SAH_MAX_LEAF_SIZE)
+        return false;
+
+    middle = partitionObjectSplit(begin, end, best);
+    axis = best.axis;
+    return true;
+}
+
+SAHBoundingVolumeHierarchy::ObjectSplit
+SAHBoundingVolumeHierarchy::findObjectSplit(int begin,
+                                            int end,
+                                            const AxisAlignedBox& bounds)
+{
+    int count = end - begin;
+    auto& pool = ThreadPool::shared();
+    int chunkCount = buildChunkCount(count);
+
+    ObjectSplit best;
+    std::vector<AxisAlignedBox> chunkCenterBoxes(chunkCount);
+    pool.parallelFor(
+      begin, end, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          for (int i = chunkBegin; i < chunkEnd; i++)
+              chunkCenterBoxes[chunk].extend(buildPrimitives[i].center);
+      });
+    for (auto& box : chunkCenterBoxes)
+        best.centerBox.extend(box);
+    auto& centerBox = best.centerBox;
+
+    // all costs below are multiplied by the surface area of this node, so that
+    // we don't divide by zero for flat nodes
+    FloatT nodeArea = bounds.surfaceArea();
+
+    // fill the bins of all axes in one pass. large nodes are binned in
+    // parallel, each chunk having its own bins
+    struct Bins
+    {
+        AxisAlignedBox boxes[3][BVH_SAH_BIN_COUNT];
+        int counts[3][BVH_SAH_BIN_COUNT] = {};
+    };
+    std::vector<Bins> chunkBins(chunkCount);
+    pool.parallelFor(
+      begin, end, chunkCount, [&](int chunk, int chunkBegin, int chunkEnd) {
+          auto& bins = chunkBins[chunk];
+          for (int i = chunkBegin; i < chunkEnd; i++) {
+              for (int dimension = 0; dimension < 3; dimension++) {
+                  if (centerBox.max[dimension] <= centerBox.min[dimension])
+                      continue;
+                  int bin = best.binIndex(buildPrimitives[i].center, dimension);
+                  bins.boxes[dimension][bin].extend(buildPrimitives[i].box);
+                  bins.counts[dimension][bin]++;
+              }
+          }
+      });
+    for (int chunk = 1; chunk < chunkCount; chunk++) {
+        for (int dimension = 0; dimension < 3; dimension++) {
+            for (int bin = 0; bin < BVH_SAH_BIN_COUNT; bin++) {
+                chunkBins[0].boxes[dimension][bin].extend(
+                  chunkBins[chunk].boxes[dimension][bin]);
+                chunkBins[0].counts[dimension][bin] +=
+                  chunkBins[chunk].counts[dimension][bin];
+            }
+        }
+    }
+
+    for (int candidate = 0; candidate < 3; candidate++) {
+        if (centerBox.max[candidate] <= centerBox.min[candidate])
+            // all centers are on the same plane
+            continue;
+
+        auto& binBoxes = chunkBins[0].boxes[candidate];
+        auto& binCounts = chunkBins[0].counts[candidate];
+
+        // sweep from the high end to find the box of the right side for each
+        // boundary. boundary i is between bins i - 1 and i
+        AxisAlignedBox highBoxes[BVH_SAH_BIN_COUNT];
+        int highCounts[BVH_SAH_BIN_COUNT];
+        AxisAlignedBox highBox;
+        int highCount = 0;
+        for (int bin = BVH_SAH_BIN_COUNT - 1; bin > 0; bin--) {
+            highBox.extend(binBoxes[bin]);
+            highCount += binCounts[bin];
+            highBoxes[bin] = highBox;
+            highCounts[bin] = highCount;
+        }
+
+        // then sweep from the low end, evaluating each boundary
+        AxisAlignedBox lowBox;
+        int lowCount = 0;
+        for (int bin = 1; bin < BVH_SAH_BIN_COUNT; bin++) {
+            lowBox.extend(binBoxes[bin - 1]);
+            lowCount += binCounts[bin - 1];
+            if (!lowCount || !highCounts[bin])
+                continue;
+
+            FloatT cost =
+              traversalCost * nodeArea +
+              intersectionCost *
+                (lowBox.surfaceArea() * alignedCount(lowCount) +
+                 highBoxes[bin].surfaceArea() * alignedCount(highCounts[bin]));
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = candidate;
+                best.bin = bin;
+                best.lowBox = lowBox;
+                best.highBox = highBoxes[bin];
+            }
+        }
+    }
+    return best;
+}
+
+int
+SAHBoundingVolumeHierarchy::partitionObjectSplit(int begin,
+                                                 int end,
+                                                 const ObjectSplit& split)
+{
+    return partition(begin, end, [&](const BuildPrimitive& primitive) {
+        return split.binIndex(primitive.center, split.axis) < split.bin;
+    });
+}
+
+int
+SAHBoundingVolumeHierarchy::ObjectSplit::binIndex(
+  const LinearAlgebra::Vec3& center,
+  int dimension) const
+{
+    FloatT low = centerBox.min[dimension];
+    FloatT high = centerBox.max[dimension];
+    int index = BVH_SAH_BIN_COUNT * (center[dimension] - low) / (high - low);
+    return std::clamp(index, 0, BVH_SAH_BIN_COUNT - 1);
+}
+}
@@ -0,0 +1,183 @@
+/**
+ * @file SAHBoundingVolumeHierarchy.hpp
+ * @author Cem Gundogdu
+ * @brief
+ * @version 1.0
+ * @date 2021-05-02
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AccelerationStructureConstants.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include <limits>
+
+namespace AccelerationStructures {
+/**
+ * @brief Bounding volume hierarchy built with the surface area heuristic
+ *
+ * Traversal is the same as BoundingVolumeHierarchy. Only the way triangles are
+ * divided between children is different. Triangle centroids are put into
+ * BVH_SAH_BIN_COUNT bins along each axis, and the boundary between bins with
+ * the lowest expected intersection cost is chosen. If no split is cheaper than
+ * testing all triangles one by one, the node becomes a leaf. Triangle counts
+ * are rounded up to a multiple of TriangleBlock::width in the costs, since
+ * leaves are tested a block at a time.
+ *
+ */
+class SAHBoundingVolumeHierarchy : public BoundingVolumeHierarchy
+{
+public:
+    /**
+     * @brief Construct a new SAHBoundingVolumeHierarchy object
+     *
+     * Only the ratio of the costs affects the resulting tree.
+     *
+     * @param traversalCost Cost of testing a ray against the boxes of a node's
+     * children
+     * @param intersectionCost Cost of testing a ray against a single triangle.
+     * Cost of a leaf is this value times the number of triangles in it.
+     * @param rebuildThreshold See BoundingVolumeHierarchy
+     * @param nodeBits See BoundingVolumeHierarchy
+     * @param width See BoundingVolumeHierarchy
+     */
+    SAHBoundingVolumeHierarchy(
+      FloatT traversalCost = BVH_SAH_TRAVERSAL_COST,
+      FloatT intersectionCost = BVH_SAH_INTERSECTION_COST,
+      FloatT rebuildThreshold = BVH_REFIT_REBUILD_THRESHOLD,
+      int nodeBits = BVH_FULL_NODE_BITS,
+      int width = BVH_DEFAULT_WIDTH);
+
+protected:
+    /**
+     * @brief Hash of the builder type and the costs
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t getCacheSettingsHash() const override;
+
+    /**
+     * @brief Divides a range of buildPrimitives into two
+     *
+     * Evaluates the surface area heuristic at the bin boundaries of all three
+     * axes and picks the cheapest one. Nodes with more than
+     * BVH_SAH_MAX_LEAF_SIZE triangles are always divided, at the median if no
+     * bin boundary separates them.
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param bounds Bounding box of the primitives in the range
+     * @param middle Set to the index of the first primitive of second child
+     * @param axis Set to the axis that primitives were divided on
+     * @return true Primitives were divided, both children are nonempty
+     * @return false This node should be a leaf
+     */
+    bool split(int begin,
+               int end,
+               const AxisAlignedBox& bounds,
+               int& middle,
+               int& axis) override;
+
+    /**
+     * @brief Best division of a node's triangles by the bins of their centers
+     *
+     */
+    struct ObjectSplit
+    {
+        /**
+         * @brief Expected cost of the division times the area of the node.
+         * Infinity if no division was found.
+         *
+         */
+        FloatT cost = std::numeric_limits<FloatT>::infinity();
+
+        /**
+         * @brief Axis of the division, -1 if no division was found
+         *
+         */
+        int axis = -1;
+
+        /**
+         * @brief First bin of the second child
+         *
+         */
+        int bin = 0;
+
+        /**
+         * @brief Bounds of the triangle centers, which the bins divide
+         *
+         */
+        AxisAlignedBox centerBox;
+
+        /**
+         * @name Children
+         *
+         */
+        ///@{
+        /**
+         * @brief Bounding boxes of the children
+         *
+         */
+        AxisAlignedBox lowBox, highBox;
+        ///@}
+
+        /**
+         * @brief Bin of a triangle center on the given axis
+         *
+         * @param center
+         * @param dimension 0, 1 or 2 for x, y, z
+         * @return int In [0, BVH_SAH_BIN_COUNT)
+         */
+        int binIndex(const LinearAlgebra::Vec3& center, int dimension) const;
+    };
+
+    /**
+     * @brief Evaluates the surface area heuristic at the bin boundaries of
+     * all three axes
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param bounds Bounding box of the primitives in the range
+     * @return ObjectSplit The cheapest division
+     */
+    ObjectSplit findObjectSplit(int begin,
+                                int end,
+                                const AxisAlignedBox& bounds);
+
+    /**
+     * @brief Reorders a range of buildPrimitives as found by findObjectSplit()
+     *
+     * @param begin Index of the first primitive in buildPrimitives
+     * @param end Index after the last primitive in buildPrimitives
+     * @param split A division with axis != -1
+     * @return Index of the first primitive of the second child
+     */
+    int partitionObjectSplit(int begin, int end, const ObjectSplit& split);
+
+    /**
+     * @brief Number of triangles rounded up to a multiple of block width
+     *
+     * Leaves are tested a TriangleBlock at a time, so this is what a leaf
+     * costs in the heuristic.
+     *
+     * @param triangleCount
+     * @return int
+     */
+    static int alignedCount(int triangleCount);
+
+    /**
+     * @brief Cost of visiting an interior node
+     *
+     */
+    FloatT traversalCost;
+
+    /**
+     * @brief Cost of a ray-triangle intersection test
+     *
+     */
+    FloatT intersectionCost;
+};
+}
@@ -0,0 +1,148 @@
+/**
+ * @file SIMDLanes.hpp
+ * @author Cem Gundogdu
+ * @brief Wrappers around SIMD instructions for the intersection kernels
+ * @version 1.0
+ * @date 2021-05-17
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+
+#if !defined(USE_DOUBLE) && defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_LANES_SSE
+#endif
+
+#if !defined(USE_DOUBLE) && defined(USE_AVX2) && defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_LANES_AVX
+#endif
+
+namespace AccelerationStructures {
+/**
+ * @brief Operations on a single lane, used if SIMD instructions are not
+ * available
+ *
+ */
+struct ScalarLanes
+{
+    using Values = FloatT;
+    using Mask = bool;
+    static constexpr int width = 1;
+
+    static Values load(const FloatT* address) { return *address; }
+    static Values broadcast(FloatT value) { return value; }
+    static Values add(Values a, Values b) { return a + b; }
+    static Values subtract(Values a, Values b) { return a - b; }
+    static Values multiply(Values a, Values b) { return a * b; }
+    static Values divide(Values a, Values b) { return a / b; }
+    static Values min(Values a, Values b) { return a < b ? a : b; }
+    static Values max(Values a, Values b) { return a > b ? a : b; }
+    static Mask less(Values a, Values b) { return a < b; }
+    static Mask lessOrEqual(Values a, Values b) { return a <= b; }
+    static Mask both(Mask a, Mask b) { return a && b; }
+    static Values select(Mask mask, Values a, Values b) { return mask ? a : b; }
+    static bool any(Mask mask) { return mask; }
+    static int bits(Mask mask) { return mask; }
+    static void store(FloatT* address, Values values) { *address = values; }
+};
+
+#ifdef SIMD_LANES_SSE
+/**
+ * @brief Operations on 4 lanes with SSE instructions
+ *
+ * min() and max() return b if either value is NaN, like the scalar versions.
+ *
+ */
+struct SSELanes
+{
+    using Values = __m128;
+    using Mask = __m128;
+    static constexpr int width = 4;
+
+    static Values load(const float* address) { return _mm_load_ps(address); }
+    static Values broadcast(float value) { return _mm_set1_ps(value); }
+    static Values add(Values a, Values b) { return _mm_add_ps(a, b); }
+    static Values subtract(Values a, Values b) { return _mm_sub_ps(a, b); }
+    static Values multiply(Values a, Values b) { return _mm_mul_ps(a, b); }
+    static Values divide(Values a, Values b) { return _mm_div_ps(a, b); }
+    static Values min(Values a, Values b) { return _mm_min_ps(a, b); }
+    static Values max(Values a, Values b) { return _mm_max_ps(a, b); }
+    static Mask less(Values a, Values b) { return _mm_cmplt_ps(a, b); }
+    static Mask lessOrEqual(Values a, Values b) { return _mm_cmple_ps(a, b); }
+    static Mask both(Mask a, Mask b) { return _mm_and_ps(a, b); }
+    static Values select(Mask mask, Values a, Values b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+    static bool any(Mask mask) { return _mm_movemask_ps(mask); }
+    static int bits(Mask mask) { return _mm_movemask_ps(mask); }
+    static void store(float* address, Values values)
+    {
+        _mm_store_ps(address, values);
+    }
+};
+#endif
+
+#ifdef SIMD_LANES_AVX
+/**
+ * @brief Operations on 8 lanes with AVX instructions
+ *
+ * min() and max() return b if either value is NaN, like the scalar versions.
+ *
+ */
+struct AVXLanes
+{
+    using Values = __m256;
+    using Mask = __m256;
+    static constexpr int width = 8;
+
+    static Values load(const float* address) { return _mm256_load_ps(address); }
+    static Values broadcast(float value) { return _mm256_set1_ps(value); }
+    static Values add(Values a, Values b) { return _mm256_add_ps(a, b); }
+    static Values subtract(Values a, Values b) { return _mm256_sub_ps(a, b); }
+    static Values multiply(Values a, Values b) { return _mm256_mul_ps(a, b); }
+    static Values divide(Values a, Values b) { return _mm256_div_ps(a, b); }
+    static Values min(Values a, Values b) { return _mm256_min_ps(a, b); }
+    static Values max(Values a, Values b) { return _mm256_max_ps(a, b); }
+    static Mask less(Values a, Values b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+    static Mask lessOrEqual(Values a, Values b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+    }
+    static Mask both(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Values select(Mask mask, Values a, Values b)
+    {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+    static bool any(Mask mask) { return _mm256_movemask_ps(mask); }
+    static int bits(Mask mask) { return _mm256_movemask_ps(mask); }
+    static void store(float* address, Values values)
+    {
+        _mm256_store_ps(address, values);
+    }
+};
+#endif
+
+/**
+ * @brief Widest lanes available
+ *
+ * AVX is used only if it was asked for with USE_AVX2.
+ *
+ */
+#if defined(SIMD_LANES_AVX)
+using Lanes = AVXLanes;
+#elif defined(SIMD_LANES_SSE)
+using Lanes = SSELanes;
+#else
+using Lanes = ScalarLanes;
+#endif
+}
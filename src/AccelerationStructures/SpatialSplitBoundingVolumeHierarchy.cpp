@@ -0,0 +1,367 @@
+#include "SpatialSplitBoundingVolumeHierarchy.hpp"
+#include "AxisAlignedBox.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace AccelerationStructures {
+namespace {
+/**
+ * @brief Largest box that is inside both boxes
+ *
+ * @return AxisAlignedBox Empty if the boxes don't overlap
+ */
+AxisAlignedBox
+overlap(const AxisAlignedBox& first, const AxisAlignedBox& second)
+{
+    AxisAlignedBox box;
+    for (int axis = 0; axis < 3; axis++) {
+        box.min[axis] = std::max(first.min[axis], second.min[axis]);
+        box.max[axis] = std::min(first.max[axis], second.max[axis]);
+        if (box.min[axis] > box.max[axis])
+            return AxisAlignedBox();
+    }
+    return box;
+}
+
+/**
+ * @brief Union of two boxes
+ *
+ */
+AxisAlignedBox
+merge(AxisAlignedBox first, const AxisAlignedBox& second)
+{
+    first.extend(second);
+    return first;
+}
+}
+
+SpatialSplitBoundingVolumeHierarchy::SpatialSplitBoundingVolumeHierarchy(
+  FloatT duplicationBudget,
+  FloatT traversalCost,
+  FloatT intersectionCost,
+  FloatT rebuildThreshold,
+  int nodeBits,
+  int width)
+  : SAHBoundingVolumeHierarchy(traversalCost,
+                               intersectionCost,
+                               rebuildThreshold,
+                               nodeBits,
+                               width)
+  , duplicationBudget(duplicationBudget)
+{}
+
+std::uint64_t
+SpatialSplitBoundingVolumeHierarchy::getCacheSettingsHash() const
+{
+    CacheKeyHasher hasher;
+    hasher.add("sbvh", 4);
+    hasher.add(traversalCost);
+    hasher.add(intersectionCost);
+    hasher.add(duplicationBudget);
+    hasher.add(nodeBits);
+    hasher.add(width);
+    return hasher.getValue();
+}
+
+void
+SpatialSplitBoundingVolumeHierarchy::buildStructure()
+{
+    createBoundingBox();
+
+    int count = geometry->getTriangleCount();
+    std::vector<BuildPrimitive> references(count);
+    AxisAlignedBox bounds;
+    for (int i = 0; i < count; i++) {
+        AxisAlignedBox box(geometry->getTriangle(i));
+        references[i] = { box, box.center(), std::uint32_t(i) };
+        bounds.extend(box);
+    }
+    rootArea = bounds.surfaceArea();
+    remainingDuplicates = duplicationBudget * count;
+
+    nodes.clear();
+    std::vector<std::uint32_t> orderedIds;
+    orderedIds.reserve(count);
+    buildSpatialNode(std::move(references), 0, orderedIds);
+    nodes.shrink_to_fit();
+
+    buildPrimitives.clear();
+    buildPrimitives.shrink_to_fit();
+
+    addLeafBlocks(orderedIds);
+}
+
+int
+SpatialSplitBoundingVolumeHierarchy::buildSpatialNode(
+  std::vector<BuildPrimitive>&& references,
+  int depth,
+  std::vector<std::uint32_t>& orderedIds)
+{
+    int count = references.size();
+    AxisAlignedBox bounds;
+    for (auto& reference : references)
+        bounds.extend(reference.box);
+
+    int nodeIndex = nodes.size();
+    nodes.emplace_back();
+    nodes[nodeIndex].setBounds(bounds);
+
+    // the object split works on a range of buildPrimitives
+    buildPrimitives = std::move(references);
+
+    FloatT nodeArea = bounds.surfaceArea();
+    FloatT leafCost = intersectionCost * alignedCount(count) * nodeArea;
+    ObjectSplit objectSplit;
+    SpatialSplit spatialSplit;
+    if (count > 1) {
+        objectSplit = findObjectSplit(0, count, bounds);
+
+        // spatial splits are only worth trying if the children of the object
+        // split overlap considerably
+        FloatT overlapArea =
+          objectSplit.axis == -1
+            ? nodeArea
+            : overlap(objectSplit.lowBox, objectSplit.highBox).surfaceArea();
+        if (remainingDuplicates > 0 && depth < SBVH_MAX_SPATIAL_DEPTH &&
+            overlapArea > SBVH_OVERLAP_THRESHOLD * rootArea) {
+            spatialSplit = findSpatialSplit(bounds);
+            int duplicates =
+              spatialSplit.lowCount + spatialSplit.highCount - count;
+            if (duplicates > remainingDuplicates)
+                spatialSplit.cost = std::numeric_limits<FloatT>::infinity();
+        }
+    }
+
+    std::vector<BuildPrimitive> low, high;
+    int axis = 0;
+    FloatT bestCost = std::min(objectSplit.cost, spatialSplit.cost);
+    if (spatialSplit.cost < objectSplit.cost &&
+        (bestCost < leafCost || count > BVH_SAH_MAX_LEAF_SIZE)) {
+        splitReferences(spatialSplit, low, high);
+        axis = spatialSplit.axis;
+        if (low.size() == std::size_t(count) ||
+            high.size() == std::size_t(count)) {
+            // unsplitting moved everything to one side, nothing was gained
+            low.clear();
+            high.clear();
+        } else
+            remainingDuplicates -= low.size() + high.size() - count;
+    }
+    if (low.empty() && objectSplit.axis != -1 &&
+        (objectSplit.cost < leafCost || count > BVH_SAH_MAX_LEAF_SIZE)) {
+        int middle = partitionObjectSplit(0, count, objectSplit);
+        low.assign(buildPrimitives.begin(), buildPrimitives.begin() + middle);
+        high.assign(buildPrimitives.begin() + middle, buildPrimitives.end());
+        axis = objectSplit.axis;
+    }
+    if (low.empty() && count > BVH_SAH_MAX_LEAF_SIZE) {
+        // centers of all triangles are at the same point. we can only divide
+        // them arbitrarily
+        int middle = count / 2;
+        low.assign(buildPrimitives.begin(), buildPrimitives.begin() + middle);
+        high.assign(buildPrimitives.begin() + middle, buildPrimitives.end());
+        axis = bounds.longestAxis();
+    }
+
+    if (low.empty()) {
+        // replaced with the index of the first block in addLeafBlocks()
+        nodes[nodeIndex].primitiveOffset = orderedIds.size();
+        nodes[nodeIndex].primitiveCount = count;
+        nodes[nodeIndex].axis = 0;
+        for (auto& reference : buildPrimitives)
+            orderedIds.push_back(reference.index);
+        return nodeIndex;
+    }
+
+    buildPrimitives.clear();
+    buildSpatialNode(std::move(low), depth + 1, orderedIds);
+    int secondChild = buildSpatialNode(std::move(high), depth + 1, orderedIds);
+
+    nodes[nodeIndex].secondChildOffset = secondChild;
+    nodes[nodeIndex].primitiveCount = 0;
+    nodes[nodeIndex].axis = axis;
+    return nodeIndex;
+}
+
+SpatialSplitBoundingVolumeHierarchy::SpatialSplit
+SpatialSplitBoundingVolumeHierarchy::findSpatialSplit(
+  const AxisAlignedBox& bounds) const
+{
+    SpatialSplit best;
+    FloatT nodeArea = bounds.surfaceArea();
+
+    for (int candidate = 0; candidate < 3; candidate++) {
+        FloatT low = bounds.min[candidate];
+        FloatT binWidth =
+          (bounds.max[candidate] - low) / SBVH_SPATIAL_BIN_COUNT;
+        if (binWidth <= 0)
+            continue;
+
+        auto binIndex = [&](FloatT position) {
+            int bin = (position - low) / binWidth;
+            return std::clamp(bin, 0, SBVH_SPATIAL_BIN_COUNT - 1);
+        };
+        auto binBoundary = [&](int bin) {
+            return bin == SBVH_SPATIAL_BIN_COUNT ? bounds.max[candidate]
+                                                 : low + bin * binWidth;
+        };
+
+        // a reference enters the bin of its lowest point and exits the bin of
+        // its highest point. each bin gets the clipped part of the triangle
+        AxisAlignedBox binBoxes[SBVH_SPATIAL_BIN_COUNT];
+        int entries[SBVH_SPATIAL_BIN_COUNT] = {};
+        int exits[SBVH_SPATIAL_BIN_COUNT] = {};
+        for (auto& reference : buildPrimitives) {
+            int first = binIndex(reference.box.min[candidate]);
+            int last = binIndex(reference.box.max[candidate]);
+            if (first == last)
+                binBoxes[first].extend(reference.box);
+            else {
+                for (int bin = first; bin <= last; bin++) {
+                    binBoxes[bin].extend(clipReference(reference,
+                                                       candidate,
+                                                       binBoundary(bin),
+                                                       binBoundary(bin + 1)));
+                }
+            }
+            entries[first]++;
+            exits[last]++;
+        }
+
+        // sweep from the high end to find the box of the right side for each
+        // boundary. boundary i is between bins i - 1 and i
+        AxisAlignedBox highBoxes[SBVH_SPATIAL_BIN_COUNT];
+        int highCounts[SBVH_SPATIAL_BIN_COUNT];
+        AxisAlignedBox highBox;
+        int highCount = 0;
+        for (int bin = SBVH_SPATIAL_BIN_COUNT - 1; bin > 0; bin--) {
+            highBox.extend(binBoxes[bin]);
+            highCount += exits[bin];
+            highBoxes[bin] = highBox;
+            highCounts[bin] = highCount;
+        }
+
+        AxisAlignedBox lowBox;
+        int lowCount = 0;
+        for (int bin = 1; bin < SBVH_SPATIAL_BIN_COUNT; bin++) {
+            lowBox.extend(binBoxes[bin - 1]);
+            lowCount += entries[bin - 1];
+            if (!lowCount || !highCounts[bin])
+                continue;
+
+            FloatT cost =
+              traversalCost * nodeArea +
+              intersectionCost *
+                (lowBox.surfaceArea() * alignedCount(lowCount) +
+                 highBoxes[bin].surfaceArea() * alignedCount(highCounts[bin]));
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = candidate;
+                best.position = binBoundary(bin);
+                best.lowBox = lowBox;
+                best.highBox = highBoxes[bin];
+                best.lowCount = lowCount;
+                best.highCount = highCounts[bin];
+            }
+        }
+    }
+    return best;
+}
+
+void
+SpatialSplitBoundingVolumeHierarchy::splitReferences(
+  const SpatialSplit& split,
+  std::vector<BuildPrimitive>& low,
+  std::vector<BuildPrimitive>& high) const
+{
+    int axis = split.axis;
+    FloatT position = split.position;
+
+    // references entirely on one side are placed first, so that the boxes
+    // used for unsplitting decisions below are as tight as possible
+    AxisAlignedBox lowBox, highBox;
+    std::vector<const BuildPrimitive*> crossing;
+    for (auto& reference : buildPrimitives) {
+        if (reference.box.max[axis] <= position) {
+            low.push_back(reference);
+            lowBox.extend(reference.box);
+        } else if (reference.box.min[axis] >= position) {
+            high.push_back(reference);
+            highBox.extend(reference.box);
+        } else
+            crossing.push_back(&reference);
+    }
+
+    FloatT lowCount = low.size() + crossing.size();
+    FloatT highCount = high.size() + crossing.size();
+    for (auto reference : crossing) {
+        auto lowPart = overlap(
+          clipReference(*reference, axis, reference->box.min[axis], position),
+          reference->box);
+        auto highPart = overlap(
+          clipReference(*reference, axis, position, reference->box.max[axis]),
+          reference->box);
+
+        // putting the whole triangle in one child avoids a duplicate. it is
+        // cheaper if that child's box doesn't grow much
+        FloatT splitCost = merge(lowBox, lowPart).surfaceArea() * lowCount +
+                           merge(highBox, highPart).surfaceArea() * highCount;
+        FloatT lowOnlyCost =
+          merge(lowBox, reference->box).surfaceArea() * lowCount +
+          highBox.surfaceArea() * (highCount - 1);
+        FloatT highOnlyCost =
+          lowBox.surfaceArea() * (lowCount - 1) +
+          merge(highBox, reference->box).surfaceArea() * highCount;
+
+        bool toLow = !lowPart.empty();
+        bool toHigh = !highPart.empty();
+        if (!toLow || !toHigh || lowOnlyCost < splitCost ||
+            highOnlyCost < splitCost) {
+            // keep the whole reference on one side
+            if (toLow && (!toHigh || lowOnlyCost <= highOnlyCost)) {
+                low.push_back(*reference);
+                lowBox.extend(reference->box);
+                highCount--;
+            } else {
+                high.push_back(*reference);
+                highBox.extend(reference->box);
+                lowCount--;
+            }
+            continue;
+        }
+
+        low.push_back({ lowPart, lowPart.center(), reference->index });
+        lowBox.extend(lowPart);
+        high.push_back({ highPart, highPart.center(), reference->index });
+        highBox.extend(highPart);
+    }
+}
+
+AxisAlignedBox
+SpatialSplitBoundingVolumeHierarchy::clipReference(
+  const BuildPrimitive& reference,
+  int axis,
+  FloatT low,
+  FloatT high) const
+{
+    // the clipped polygon consists of the vertices between the planes and the
+    // points where edges cross the planes
+    AxisAlignedBox box;
+    for (int i = 0; i < 3; i++) {
+        auto& start = geometry->getVertex(reference.index, i);
+        auto& end = geometry->getVertex(reference.index, (i + 1) % 3);
+        if (start[axis] >= low && start[axis] <= high)
+            box.extend(start);
+        for (FloatT plane : { low, high }) {
+            if ((start[axis] < plane && end[axis] > plane) ||
+                (start[axis] > plane && end[axis] < plane)) {
+                FloatT t = (plane - start[axis]) / (end[axis] - start[axis]);
+                auto point = start + (end - start) * t;
+                point[axis] = plane;
+                box.extend(point);
+            }
+        }
+    }
+    return overlap(box, reference.box);
+}
+}
@@ -0,0 +1,192 @@
+/**
+ * @file SpatialSplitBoundingVolumeHierarchy.hpp
+ * @author Cem Gundogdu
+ * @brief
+ * @version 1.0
+ * @date 2021-05-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AccelerationStructureConstants.hpp"
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace AccelerationStructures {
+/**
+ * @brief Bounding volume hierarchy with spatial splits (SBVH)
+ *
+ * Besides dividing the triangles between children like
+ * SAHBoundingVolumeHierarchy, a node may be divided with a plane. Triangles
+ * crossing the plane are referenced by both children, each with the bounding
+ * box of the part of the triangle on its side. This makes the children
+ * overlap much less for long, thin triangles, at the cost of testing some
+ * triangles more than once.
+ *
+ * Traversal is the same as BoundingVolumeHierarchy. The build is done on a
+ * single thread.
+ *
+ */
+class SpatialSplitBoundingVolumeHierarchy : public SAHBoundingVolumeHierarchy
+{
+public:
+    /**
+     * @brief Construct a new SpatialSplitBoundingVolumeHierarchy object
+     *
+     * @param duplicationBudget Maximum number of extra triangle references
+     * created by spatial splits, as a ratio of the triangle count
+     * @param traversalCost See SAHBoundingVolumeHierarchy
+     * @param intersectionCost See SAHBoundingVolumeHierarchy
+     * @param rebuildThreshold See BoundingVolumeHierarchy
+     * @param nodeBits See BoundingVolumeHierarchy
+     * @param width See BoundingVolumeHierarchy
+     */
+    SpatialSplitBoundingVolumeHierarchy(
+      FloatT duplicationBudget = SBVH_DUPLICATION_BUDGET,
+      FloatT traversalCost = BVH_SAH_TRAVERSAL_COST,
+      FloatT intersectionCost = BVH_SAH_INTERSECTION_COST,
+      FloatT rebuildThreshold = BVH_REFIT_REBUILD_THRESHOLD,
+      int nodeBits = BVH_FULL_NODE_BITS,
+      int width = BVH_DEFAULT_WIDTH);
+
+protected:
+    /**
+     * @brief Hash of the builder type, the costs and the duplication budget
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t getCacheSettingsHash() const override;
+
+    /**
+     * @brief Builds the tree for the triangles in geometry
+     *
+     * Each node picks the cheapest of an object split, a spatial split and
+     * becoming a leaf. A leaf may contain references to the same triangles as
+     * other leaves.
+     *
+     */
+    void buildStructure() override;
+
+    /**
+     * @brief Best division of a node with an axis-aligned plane
+     *
+     */
+    struct SpatialSplit
+    {
+        /**
+         * @brief Expected cost of the division times the area of the node.
+         * Infinity if no division was found.
+         *
+         */
+        FloatT cost = std::numeric_limits<FloatT>::infinity();
+
+        /**
+         * @brief Axis of the plane, -1 if no division was found
+         *
+         */
+        int axis = -1;
+
+        /**
+         * @brief Coordinate of the plane on the axis
+         *
+         */
+        FloatT position = 0;
+
+        /**
+         * @name Children
+         *
+         */
+        ///@{
+        /**
+         * @brief Bounding boxes of the children
+         *
+         */
+        AxisAlignedBox lowBox, highBox;
+
+        /**
+         * @brief Number of references in the children
+         *
+         */
+        int lowCount = 0, highCount = 0;
+        ///@}
+    };
+
+    /**
+     * @brief Builds the subtree with the given triangle references
+     *
+     * Appends the root of the subtree to nodes, then builds its children.
+     *
+     * @param references Triangles in this node, with their bounding boxes
+     * clipped to the node. Consumed by this function.
+     * @param depth Depth of the node, root is 0
+     * @param orderedIds Primitive IDs of the triangles in the leaves are
+     * appended to this array
+     * @return Index of the root of the subtree in nodes
+     */
+    int buildSpatialNode(std::vector<BuildPrimitive>&& references,
+                         int depth,
+                         std::vector<std::uint32_t>& orderedIds);
+
+    /**
+     * @brief Evaluates the surface area heuristic at the boundaries of
+     * SBVH_SPATIAL_BIN_COUNT equal bins along each axis
+     *
+     * Triangles in buildPrimitives are clipped to each bin they overlap.
+     *
+     * @param bounds Bounding box of buildPrimitives
+     * @return SpatialSplit The cheapest division
+     */
+    SpatialSplit findSpatialSplit(const AxisAlignedBox& bounds) const;
+
+    /**
+     * @brief Divides buildPrimitives with the plane of a spatial split
+     *
+     * References crossing the plane are clipped and put in both children,
+     * unless putting them in only one child is cheaper.
+     *
+     * @param split A division with axis != -1
+     * @param low References of the first child are appended here
+     * @param high References of the second child are appended here
+     */
+    void splitReferences(const SpatialSplit& split,
+                         std::vector<BuildPrimitive>& low,
+                         std::vector<BuildPrimitive>& high) const;
+
+    /**
+     * @brief Bounding box of the part of a reference between two planes
+     *
+     * @param reference
+     * @param axis Axis of the planes
+     * @param low Coordinate of the lower plane
+     * @param high Coordinate of the higher plane
+     * @return AxisAlignedBox Empty if the triangle is not between the planes
+     */
+    AxisAlignedBox clipReference(const BuildPrimitive& reference,
+                                 int axis,
+                                 FloatT low,
+                                 FloatT high) const;
+
+    /**
+     * @brief Maximum ratio of extra references to the triangle count
+     *
+     */
+    FloatT duplicationBudget;
+
+    /**
+     * @brief Number of extra references that can still be created during
+     * build
+     *
+     */
+    int remainingDuplicates = 0;
+
+    /**
+     * @brief Surface area of the root, used to compare overlaps during build
+     *
+     */
+    FloatT rootArea = 0;
+};
+}
@@ -0,0 +1,305 @@
+#include "SurfaceBoundingVolumeHierarchy.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include "Mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <typeinfo>
+
+namespace AccelerationStructures {
+void
+SurfaceBoundingVolumeHierarchy::build(
+  const std::vector<std::shared_ptr<Objects::Surface>>& surfaces)
+{
+    this->surfaces = surfaces;
+    nodes.clear();
+    primitives.clear();
+    triangles.clear();
+
+    std::vector<AxisAlignedBox> boxes;
+    auto addPrimitive = [&](const Primitive& primitive,
+                            const LinearAlgebra::Vec3& min,
+                            const LinearAlgebra::Vec3& max) {
+        // triangles are made larger by intersectionTestEpsilon in barycentric
+        // coordinates. growing the box by three times that much of its
+        // diagonal is enough to contain any such point
+        FloatT padding = 3 *
+                         std::abs(Objects::Surface::intersectionTestEpsilon) *
+                         (max - min).norm();
+        LinearAlgebra::Vec3 paddingVector(padding, padding, padding);
+
+        AxisAlignedBox box;
+        box.extend(min - paddingVector);
+        box.extend(max + paddingVector);
+        boxes.push_back(box);
+        primitives.push_back(primitive);
+    };
+
+    for (std::size_t i = 0; i < surfaces.size(); i++) {
+        auto surface = surfaces[i].get();
+        auto mesh = dynamic_cast<const Objects::Mesh*>(surface);
+        if (mesh && (!mesh->hasAccelerationStructure() ||
+                     mesh->getGeometry().getTriangleCount() <=
+                       SURFACE_BVH_MAX_INLINE_TRIANGLES)) {
+            auto& geometry = mesh->getGeometry();
+            for (std::uint32_t j = 0; j < geometry.getTriangleCount(); j++) {
+                auto triangle = geometry.getTriangle(j);
+                LinearAlgebra::Vec3 min = triangle.v1, max = triangle.v1;
+                for (auto& vertex : { triangle.v2, triangle.v3 }) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        min[axis] = std::min(min[axis], vertex[axis]);
+                        max[axis] = std::max(max[axis], vertex[axis]);
+                    }
+                }
+                addPrimitive({ Primitive::Type::Triangle,
+                               static_cast<int>(i),
+                               static_cast<int>(triangles.size()) },
+                             min,
+                             max);
+                triangles.emplace_back(triangle);
+            }
+            continue;
+        }
+
+        LinearAlgebra::Vec3 min, max;
+        surface->getBounds(min, max);
+        // subclasses of Sphere may override its functions
+        auto type = typeid(*surface) == typeid(Objects::Sphere)
+                      ? Primitive::Type::Sphere
+                      : Primitive::Type::Surface;
+        addPrimitive({ type, static_cast<int>(i), 0 }, min, max);
+    }
+
+    if (primitives.empty())
+        return;
+
+    // sort once on each axis w.r.t. box centers. ties are broken by index, so
+    // the order of any subset is the same as if it was sorted by itself
+    std::vector<LinearAlgebra::Vec3> centers;
+    centers.reserve(boxes.size());
+    for (auto& box : boxes)
+        centers.push_back(box.center());
+    for (int axis = 0; axis < 3; axis++) {
+        auto& order = orders[axis];
+        order.resize(primitives.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            FloatT centerA = centers[a][axis];
+            FloatT centerB = centers[b][axis];
+            return centerA < centerB || (centerA == centerB && a < b);
+        });
+    }
+    inFirstChild.assign(primitives.size(), false);
+
+    nodes.reserve(2 * primitives.size() - 1);
+    buildNode(0, primitives.size(), boxes);
+
+    for (auto& order : orders) {
+        order.clear();
+        order.shrink_to_fit();
+    }
+    inFirstChild.clear();
+    inFirstChild.shrink_to_fit();
+}
+
+FloatT
+SurfaceBoundingVolumeHierarchy::intersect(const Objects::Ray& ray,
+                                          LinearAlgebra::Vec3& normalOut,
+                                          Objects::Surface*& surfaceOut,
+                                          FloatT maxT) const
+{
+    if (nodes.empty())
+        return -1;
+    TraversalRay traversalRay(ray);
+    if (nodes[0].box.intersect(traversalRay) == -1)
+        return -1;
+
+    FloatT closestT = maxT;
+    int closestPrimitive = -1;
+    intersectNode(0, traversalRay, closestT, closestPrimitive, normalOut);
+    if (closestPrimitive == -1)
+        return -1;
+
+    surfaceOut = surfaces[primitives[closestPrimitive].surface].get();
+    return closestT;
+}
+
+bool
+SurfaceBoundingVolumeHierarchy::occluded(const Objects::Ray& ray,
+                                         FloatT tMax) const
+{
+    if (nodes.empty())
+        return false;
+    TraversalRay traversalRay(ray);
+    FloatT t = nodes[0].box.intersect(traversalRay);
+    return t != -1 && t < tMax && occludedNode(0, traversalRay, tMax);
+}
+
+FloatT
+SurfaceBoundingVolumeHierarchy::intersectPrimitive(
+  const Primitive& primitive,
+  const Objects::Ray& ray,
+  LinearAlgebra::Vec3& normalOut) const
+{
+    auto& surface = *surfaces[primitive.surface];
+    switch (primitive.type) {
+        case Primitive::Type::Sphere:
+            // qualified call, the type is already known
+            return static_cast<const Objects::Sphere&>(surface)
+              .Objects::Sphere::intersect(ray, normalOut);
+        case Primitive::Type::Triangle: {
+            auto& triangle = triangles[primitive.triangle];
+            FloatT t = triangle.intersect(ray);
+            if (t != -1)
+                normalOut = triangle.normal;
+            return t;
+        }
+        case Primitive::Type::Surface:
+            break;
+    }
+    return surface.intersect(ray, normalOut);
+}
+
+bool
+SurfaceBoundingVolumeHierarchy::occludedPrimitive(const Primitive& primitive,
+                                                  const Objects::Ray& ray,
+                                                  FloatT tMax) const
+{
+    auto& surface = *surfaces[primitive.surface];
+    switch (primitive.type) {
+        case Primitive::Type::Sphere:
+            return static_cast<const Objects::Sphere&>(surface)
+              .Objects::Sphere::occluded(ray, tMax);
+        case Primitive::Type::Triangle: {
+            FloatT t = triangles[primitive.triangle].intersect(ray);
+            return t != -1 && t < tMax;
+        }
+        case Primitive::Type::Surface:
+            break;
+    }
+    return surface.occluded(ray, tMax);
+}
+
+int
+SurfaceBoundingVolumeHierarchy::buildNode(
+  int begin,
+  int end,
+  const std::vector<AxisAlignedBox>& boxes)
+{
+    int nodeIndex = nodes.size();
+    nodes.push_back({});
+
+    AxisAlignedBox bounds;
+    for (int i = begin; i < end; i++)
+        bounds.extend(boxes[orders[0][i]]);
+
+    int count = end - begin;
+    if (count == 1) {
+        nodes[nodeIndex] = { bounds, 0, orders[0][begin], 0 };
+        return nodeIndex;
+    }
+
+    // evaluate the surface area heuristic for every possible split position
+    // along every axis. only the relative costs matter, so the node's area and
+    // the traversal cost are left out
+    FloatT bestCost = std::numeric_limits<FloatT>::infinity();
+    int bestAxis = 0;
+    int bestSplit = 1;
+    std::vector<FloatT> highAreas(count);
+    for (int axis = 0; axis < 3; axis++) {
+        auto& order = orders[axis];
+        AxisAlignedBox highBox;
+        for (int i = count - 1; i > 0; i--) {
+            highBox.extend(boxes[order[begin + i]]);
+            highAreas[i] = highBox.surfaceArea();
+        }
+
+        AxisAlignedBox lowBox;
+        for (int split = 1; split < count; split++) {
+            lowBox.extend(boxes[order[begin + split - 1]]);
+            FloatT cost = lowBox.surfaceArea() * split +
+                          highAreas[split] * (count - split);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    // the range is already divided on the best axis. divide it on the other
+    // axes too, keeping the sorted order on both sides
+    int middle = begin + bestSplit;
+    auto& bestOrder = orders[bestAxis];
+    for (int i = begin; i < end; i++)
+        inFirstChild[bestOrder[i]] = i < middle;
+    for (int axis = 0; axis < 3; axis++) {
+        if (axis != bestAxis) {
+            std::stable_partition(orders[axis].begin() + begin,
+                                  orders[axis].begin() + end,
+                                  [&](int i) { return inFirstChild[i]; });
+        }
+    }
+
+    buildNode(begin, middle, boxes);
+    int secondChild = buildNode(middle, end, boxes);
+    nodes[nodeIndex] = { bounds, secondChild, -1, bestAxis };
+    return nodeIndex;
+}
+
+void
+SurfaceBoundingVolumeHierarchy::intersectNode(
+  int nodeIndex,
+  const TraversalRay& ray,
+  FloatT& closestT,
+  int& closestPrimitive,
+  LinearAlgebra::Vec3& normalOut) const
+{
+    auto& node = nodes[nodeIndex];
+    if (node.primitive != -1) {
+        LinearAlgebra::Vec3 normal;
+        FloatT t =
+          intersectPrimitive(primitives[node.primitive], ray.ray, normal);
+        if (t == -1)
+            return;
+        // prefer the primitive that comes first on ties, like a linear search
+        if (t < closestT ||
+            (t == closestT && closestPrimitive != -1 &&
+             node.primitive < closestPrimitive)) {
+            closestT = t;
+            closestPrimitive = node.primitive;
+            normalOut = normal;
+        }
+        return;
+    }
+
+    // visit the child that is closer to the origin first
+    int first = nodeIndex + 1;
+    int second = node.secondChild;
+    if (ray.negative[node.axis])
+        std::swap(first, second);
+
+    for (int child : { first, second }) {
+        FloatT t = nodes[child].box.intersect(ray);
+        if (t != -1 && t <= closestT)
+            intersectNode(child, ray, closestT, closestPrimitive, normalOut);
+    }
+}
+
+bool
+SurfaceBoundingVolumeHierarchy::occludedNode(int nodeIndex,
+                                             const TraversalRay& ray,
+                                             FloatT tMax) const
+{
+    auto& node = nodes[nodeIndex];
+    if (node.primitive != -1)
+        return occludedPrimitive(primitives[node.primitive], ray.ray, tMax);
+
+    for (int child : { nodeIndex + 1, node.secondChild }) {
+        FloatT t = nodes[child].box.intersect(ray);
+        if (t != -1 && t < tMax && occludedNode(child, ray, tMax))
+            return true;
+    }
+    return false;
+}
+}
@@ -0,0 +1,284 @@
+/**
+ * @file SurfaceBoundingVolumeHierarchy.hpp
+ * @author Cem Gundogdu
+ * @brief Top-level acceleration structure over the surfaces of a scene
+ * @version 1.0
+ * @date 2021-05-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AxisAlignedBox.hpp"
+#include "Config.hpp"
+#include "PrecomputedTriangle.hpp"
+#include "Ray.hpp"
+#include "Sphere.hpp"
+#include "Surface.hpp"
+#include "Vector.hpp"
+#include <array>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace AccelerationStructures {
+/**
+ * @brief Bounding volume hierarchy over the spheres, triangles and meshes of a
+ * scene
+ *
+ * Used on top of the acceleration structures of meshes, so that a ray doesn't
+ * have to be tested against every surface in the scene. Leaves refer to
+ * primitives of different types, tagged with Primitive::Type:
+ * - spheres, which are tested without a virtual call,
+ * - single triangles of meshes with at most SURFACE_BVH_MAX_INLINE_TRIANGLES
+ * triangles or without an acceleration structure, which are stored in the
+ * hierarchy itself,
+ * - other meshes, which use their own acceleration structure once their leaf
+ * is reached.
+ *
+ * This way scenes made of spheres and loose triangles are traversed through a
+ * single structure.
+ *
+ * Since scenes have few primitives compared to the number of triangles in a
+ * mesh, the tree is built with a full sweep of the surface area heuristic
+ * instead of binning, and every leaf has a single primitive. Primitives are
+ * sorted on each axis once, and the sorted orders are kept while dividing
+ * them, so building takes O(n log n) time.
+ *
+ */
+class SurfaceBoundingVolumeHierarchy
+{
+public:
+    /**
+     * @brief Builds the hierarchy over the given surfaces
+     *
+     * Bounding boxes are grown by Objects::Surface::intersectionTestEpsilon,
+     * so it must be set before calling this function.
+     *
+     * @param surfaces Surfaces of a scene, may be empty
+     */
+    void build(const std::vector<std::shared_ptr<Objects::Surface>>& surfaces);
+
+    /**
+     * @brief Finds the closest surface in front of the ray
+     *
+     * If there are multiple surfaces at the same distance, the one that comes
+     * first in the vector given to build() is chosen.
+     *
+     * @param ray Ray to test intersection with
+     * @param normalOut If return value is not -1, set to the surface normal at
+     * intersection point
+     * @param surfaceOut If return value is not -1, set to the surface that was
+     * hit
+     * @param maxT Intersections at this t value or farther are ignored
+     * @return If there was no intersection in front of the ray, -1.
+     * Else, a positive t value such that origin + t * direction is on the
+     * closest surface
+     */
+    FloatT intersect(
+      const Objects::Ray& ray,
+      LinearAlgebra::Vec3& normalOut,
+      Objects::Surface*& surfaceOut,
+      FloatT maxT = std::numeric_limits<FloatT>::infinity()) const;
+
+    /**
+     * @brief Checks if any surface is hit in front of the ray before tMax
+     *
+     * Stops at the first intersection found. Leaves are tested with
+     * Objects::Surface::occluded().
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a surface at some t in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const;
+
+protected:
+    /**
+     * @brief What a leaf of the hierarchy refers to
+     *
+     */
+    struct Primitive
+    {
+        /**
+         * @brief How the primitive is intersected
+         *
+         */
+        enum class Type
+        {
+            Sphere,
+            Triangle,
+            Surface
+        };
+
+        Type type;
+
+        /**
+         * @brief Index of the surface the primitive belongs to in surfaces
+         *
+         */
+        int surface;
+
+        /**
+         * @brief Index of the triangle in triangles for Type::Triangle.
+         * Unused for other types.
+         *
+         */
+        int triangle;
+    };
+
+    /**
+     * @brief Node of the hierarchy
+     *
+     * Nodes are stored in depth-first order, so the first child of an interior
+     * node is the next node.
+     *
+     */
+    struct Node
+    {
+        /**
+         * @brief Bounding box of all surfaces in this subtree
+         *
+         */
+        AxisAlignedBox box;
+
+        /**
+         * @brief Index of the second child. Unused for leaves.
+         *
+         */
+        int secondChild;
+
+        /**
+         * @brief Index of the leaf's primitive in primitives. -1 for interior
+         * nodes.
+         *
+         */
+        int primitive;
+
+        /**
+         * @brief Axis that interior node was divided on. 0, 1 or 2 for x, y, z.
+         *
+         */
+        int axis;
+    };
+
+    /**
+     * @brief Intersects a ray with a primitive
+     *
+     * @param primitive
+     * @param ray
+     * @param normalOut If return value is not -1, set to the normal at the
+     * intersection point
+     * @return FloatT t value of the intersection, -1 if there is none
+     */
+    FloatT intersectPrimitive(const Primitive& primitive,
+                              const Objects::Ray& ray,
+                              LinearAlgebra::Vec3& normalOut) const;
+
+    /**
+     * @brief Checks if a primitive is hit before tMax
+     *
+     * @param primitive
+     * @param ray
+     * @param tMax
+     * @return true
+     * @return false
+     */
+    bool occludedPrimitive(const Primitive& primitive,
+                           const Objects::Ray& ray,
+                           FloatT tMax) const;
+
+    /**
+     * @brief Builds the subtree with the primitives in [begin, end) of orders
+     *
+     * Reorders that range in each of orders so that primitives of the first
+     * child come first.
+     *
+     * @param begin
+     * @param end
+     * @param boxes Bounding boxes of primitives, indexed like primitives
+     * @return int Index of the root of the subtree in nodes
+     */
+    int buildNode(int begin, int end, const std::vector<AxisAlignedBox>& boxes);
+
+    /**
+     * @brief Finds the closest intersection in the subtree of given node
+     *
+     * Assumes the ray hits the box of the node. Children are visited from
+     * front to back, and children farther than closestT are skipped.
+     *
+     * @param nodeIndex Index of the root of the subtree
+     * @param ray
+     * @param closestT Closest t value found so far, updated if a closer
+     * primitive is found
+     * @param closestPrimitive Index of the closest primitive found so far in
+     * primitives, -1 if none
+     * @param normalOut Normal at the closest intersection found so far
+     */
+    void intersectNode(int nodeIndex,
+                       const TraversalRay& ray,
+                       FloatT& closestT,
+                       int& closestPrimitive,
+                       LinearAlgebra::Vec3& normalOut) const;
+
+    /**
+     * @brief Checks if any primitive in the subtree of given node is hit
+     * before tMax
+     *
+     * Assumes the ray hits the box of the node.
+     *
+     * @param nodeIndex Index of the root of the subtree
+     * @param ray
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a primitive in the subtree at some t in (0, tMax)
+     * @return false
+     */
+    bool occludedNode(int nodeIndex,
+                      const TraversalRay& ray,
+                      FloatT tMax) const;
+
+    /**
+     * @brief Surfaces in the order given to build()
+     *
+     */
+    std::vector<std::shared_ptr<Objects::Surface>> surfaces;
+
+    /**
+     * @brief Primitives of the surfaces, in the order of surfaces. Ties are
+     * broken by this order.
+     *
+     */
+    std::vector<Primitive> primitives;
+
+    /**
+     * @brief Triangles of small meshes
+     *
+     */
+    std::vector<PrecomputedTriangle> triangles;
+
+    /**
+     * @brief Indices of primitives sorted on each axis, used only during
+     * build()
+     *
+     * The range of a node has the same primitives in all three.
+     *
+     */
+    std::array<std::vector<int>, 3> orders;
+
+    /**
+     * @brief Whether each primitive goes to the first child of the node being
+     * divided, used only during build()
+     *
+     */
+    std::vector<bool> inFirstChild;
+
+    /**
+     * @brief Nodes of the tree, in depth-first order. Root is at index 0.
+     *
+     */
+    std::vector<Node> nodes;
+};
+}
@@ -0,0 +1,151 @@
+#include "ThreadPool.hpp"
+#include <chrono>
+
+namespace AccelerationStructures {
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 0; i < threadCount - 1; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAdded.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+std::future<void>
+ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packagedTask(std::move(task));
+    auto future = packagedTask.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(packagedTask));
+        if (waitingCount)
+            taskFinished.notify_all();
+    }
+    taskAdded.notify_one();
+    return future;
+}
+
+void
+ThreadPool::wait(std::future<void>& future)
+{
+    auto ready = [&] {
+        return future.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+    };
+    while (!ready()) {
+        if (runPendingTask())
+            continue;
+        // the task is running on another thread. sleep until a task finishes
+        // or a new one can be run here
+        std::unique_lock<std::mutex> lock(mutex);
+        waitingCount++;
+        taskFinished.wait(lock, [&] { return !tasks.empty() || ready(); });
+        waitingCount--;
+    }
+    // rethrows exceptions thrown by the task
+    future.get();
+}
+
+void
+ThreadPool::parallelFor(int begin,
+                        int end,
+                        int chunkCount,
+                        const std::function<void(int, int, int)>& body)
+{
+    if (chunkCount <= 1) {
+        body(0, begin, end);
+        return;
+    }
+
+    std::vector<std::future<void>> futures;
+    long long length = end - begin;
+    for (int chunk = 1; chunk < chunkCount; chunk++) {
+        int chunkBegin = begin + length * chunk / chunkCount;
+        int chunkEnd = begin + length * (chunk + 1) / chunkCount;
+        futures.push_back(submit(
+          [&body, chunk, chunkBegin, chunkEnd] {
+              body(chunk, chunkBegin, chunkEnd);
+          }));
+    }
+
+    // run the first chunk on this thread
+    body(0, begin, begin + length / chunkCount);
+    for (auto& future : futures)
+        wait(future);
+}
+
+int
+ThreadPool::getThreadCount() const
+{
+    return workers.size() + 1;
+}
+
+ThreadPool&
+ThreadPool::shared()
+{
+#ifdef MULTITHREADED
+    static ThreadPool pool(defaultThreadCount);
+#else
+    static ThreadPool pool(1);
+#endif
+    return pool;
+}
+
+bool
+ThreadPool::runPendingTask()
+{
+    std::packaged_task<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty())
+            return false;
+        // newest task first, it is most likely to be a small subtree of the
+        // waiting task
+        task = std::move(tasks.back());
+        tasks.pop_back();
+    }
+    run(task);
+    return true;
+}
+
+void
+ThreadPool::run(std::packaged_task<void()>& task)
+{
+    task();
+    // the future of the task is ready before the lock is taken, so a thread
+    // checking it in wait() either sees it or is already waiting
+    std::lock_guard<std::mutex> lock(mutex);
+    if (waitingCount)
+        taskFinished.notify_all();
+}
+
+void
+ThreadPool::work()
+{
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAdded.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping)
+                return;
+            // oldest task first, so that idle workers pick up large subtrees
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        run(task);
+    }
+}
+}
@@ -0,0 +1,178 @@
+/**
+ * @file ThreadPool.hpp
+ * @author Cem Gundogdu
+ * @brief Worker threads for building acceleration structures
+ * @version 1.0
+ * @date 2021-05-03
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AccelerationStructures {
+/**
+ * @brief Runs tasks on a fixed number of worker threads
+ *
+ * Tasks may submit other tasks and wait for them. A thread waiting for a task
+ * runs other queued tasks in the meantime, so nested waits don't deadlock and
+ * the waiting thread is not idle.
+ *
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Construct a new ThreadPool object
+     *
+     * The thread that calls wait() also runs tasks, so threadCount - 1 worker
+     * threads are created. With a single thread, tasks run only in wait().
+     *
+     * @param threadCount Number of threads that run tasks, including the
+     * caller. 0 means the number of hardware threads.
+     */
+    ThreadPool(int threadCount);
+
+    /**
+     * @brief Waits for the workers to finish their current task and stops them
+     *
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Adds a task to the queue
+     *
+     * @param task
+     * @return std::future<void> Becomes ready when the task is finished. Pass
+     * it to wait() instead of waiting on it directly.
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    /**
+     * @brief Runs queued tasks until the given task is finished
+     *
+     * @param future A future returned by submit()
+     */
+    void wait(std::future<void>& future);
+
+    /**
+     * @brief Calls body for chunks of a range in parallel
+     *
+     * Divides [begin, end) into chunkCount contiguous chunks of nearly equal
+     * size and calls body(chunkIndex, chunkBegin, chunkEnd) for each of them.
+     * Returns when all chunks are done. If chunkCount is 1, body is called
+     * directly.
+     *
+     * @param begin
+     * @param end
+     * @param chunkCount Number of chunks, at least 1
+     * @param body
+     */
+    void parallelFor(int begin,
+                     int end,
+                     int chunkCount,
+                     const std::function<void(int, int, int)>& body);
+
+    /**
+     * @brief Number of threads that run tasks, including the waiting thread
+     *
+     * @return int
+     */
+    int getThreadCount() const;
+
+    /**
+     * @brief Pool used for constructing acceleration structures
+     *
+     * Created on first use with defaultThreadCount threads. If the program is
+     * not built with MULTITHREADED, it has a single thread.
+     *
+     * @return ThreadPool&
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @brief Number of threads in the shared pool. 0 means all hardware
+     * threads.
+     *
+     * Must be set before the first call to shared().
+     *
+     */
+    inline static int defaultThreadCount = 0;
+
+protected:
+    /**
+     * @brief Runs a queued task, if there is one
+     *
+     * @return true A task was run
+     * @return false The queue was empty
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief Runs a task and wakes up the threads in wait()
+     *
+     * @param task
+     */
+    void run(std::packaged_task<void()>& task);
+
+    /**
+     * @brief Loop of each worker thread
+     *
+     */
+    void work();
+
+    /**
+     * @brief Tasks that are not started yet
+     *
+     */
+    std::deque<std::packaged_task<void()>> tasks;
+
+    /**
+     * @brief Guards tasks, stopping and waitingCount
+     *
+     */
+    std::mutex mutex;
+
+    /**
+     * @brief Notified when a task is added or the pool is stopping
+     *
+     */
+    std::condition_variable taskAdded;
+
+    /**
+     * @brief Notified when a task finishes, or is added so that threads in
+     * wait() can run it
+     *
+     */
+    std::condition_variable taskFinished;
+
+    /**
+     * @brief Number of threads in wait(). Tasks notify taskFinished only if
+     * there are any.
+     *
+     */
+    int waitingCount = 0;
+
+    /**
+     * @brief Set when the pool is being destroyed
+     *
+     */
+    bool stopping = false;
+
+    /**
+     * @brief Worker threads. Size is threadCount - 1.
+     *
+     */
+    std::vector<std::thread> workers;
+};
+}
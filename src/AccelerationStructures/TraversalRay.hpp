@@ -0,0 +1,174 @@
+/**
+ * @file TraversalRay.hpp
+ * @author Cem Gundogdu
+ * @brief Ray with precomputed data for testing it against many boxes
+ * @version 1.0
+ * @date 2021-05-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "Ray.hpp"
+#include "Vector.hpp"
+#include <cmath>
+#include <limits>
+
+namespace AccelerationStructures {
+/**
+ * @brief A ray prepared for slab tests against axis-aligned boxes
+ *
+ * Acceleration structures create one of these for each query and use it at
+ * every box they visit. Slab tests multiply by the inverse direction instead
+ * of dividing by the direction, and choose the near and far plane of each
+ * slab by the sign of the direction instead of comparing the two t values.
+ *
+ * This is kept apart from Objects::Ray because the members of a ray are
+ * public and changed in place by its users, which would leave precomputed
+ * values out of date.
+ *
+ * A zero direction component has an infinite inverse with the same sign, so a
+ * slab either contains the whole line or none of it. If the origin is exactly
+ * on a plane of such a slab, the t value is NaN, and it is ignored, i.e. the
+ * origin counts as inside the slab.
+ *
+ */
+struct TraversalRay
+{
+    /**
+     * @brief Construct a new TraversalRay object
+     *
+     * @param ray Must outlive this object
+     */
+    explicit TraversalRay(const Objects::Ray& ray);
+
+    /**
+     * @brief Finds the interval of t values for which the ray is inside a box
+     *
+     * The interval is slightly enlarged, so that rounding errors can't make
+     * the ray miss a triangle that is on a face of the box.
+     *
+     * @param tEnterOut Set to the t value at which the ray enters the box. May
+     * be negative.
+     * @param tExitOut Set to the t value at which the ray leaves the box. Less
+     * than tEnterOut if the line doesn't hit the box.
+     */
+    void clipBox(FloatT xMin,
+                 FloatT xMax,
+                 FloatT yMin,
+                 FloatT yMax,
+                 FloatT zMin,
+                 FloatT zMax,
+                 FloatT& tEnterOut,
+                 FloatT& tExitOut) const;
+
+    /**
+     * @brief Checks for intersection with a box
+     *
+     * @param tLimit Boxes entered at this t value or farther are treated as
+     * missed
+     * @return If the ray doesn't hit the box before tLimit or the box is
+     * behind the ray, -1. If ray's origin is inside the box, 0. Otherwise t at
+     * the entry point to the box.
+     */
+    FloatT intersectBox(
+      FloatT xMin,
+      FloatT xMax,
+      FloatT yMin,
+      FloatT yMax,
+      FloatT zMin,
+      FloatT zMax,
+      FloatT tLimit = std::numeric_limits<FloatT>::infinity()) const;
+
+    /**
+     * @brief The ray itself
+     *
+     */
+    const Objects::Ray& ray;
+
+    /**
+     * @brief 1 / direction on each axis
+     *
+     */
+    LinearAlgebra::Vec3 inverseDirection;
+
+    /**
+     * @brief Sign bits of the direction, so that -0 counts as negative
+     *
+     */
+    bool negative[3];
+};
+
+inline TraversalRay::TraversalRay(const Objects::Ray& ray)
+  : ray(ray)
+  , inverseDirection(1 / ray.direction.x,
+                     1 / ray.direction.y,
+                     1 / ray.direction.z)
+  , negative{ std::signbit(ray.direction.x),
+              std::signbit(ray.direction.y),
+              std::signbit(ray.direction.z) }
+{}
+
+inline void
+TraversalRay::clipBox(FloatT xMin,
+                      FloatT xMax,
+                      FloatT yMin,
+                      FloatT yMax,
+                      FloatT zMin,
+                      FloatT zMax,
+                      FloatT& tEnterOut,
+                      FloatT& tExitOut) const
+{
+    /**
+     * On each axis, the ray is between the two planes of the box for t in
+     * (tNear, tFar). The ray is inside the box in the intersection of these
+     * intervals.
+     *
+     * a > b ? a : b is b if a is NaN, so NaN t values are skipped.
+     *
+     */
+
+    FloatT tEnter = -std::numeric_limits<FloatT>::infinity();
+    FloatT tExit = std::numeric_limits<FloatT>::infinity();
+
+    FloatT tNear = ((negative[0] ? xMax : xMin) - ray.origin.x) *
+                   inverseDirection.x;
+    FloatT tFar = ((negative[0] ? xMin : xMax) - ray.origin.x) *
+                  inverseDirection.x;
+    tEnter = tNear > tEnter ? tNear : tEnter;
+    tExit = tFar < tExit ? tFar : tExit;
+
+    tNear = ((negative[1] ? yMax : yMin) - ray.origin.y) * inverseDirection.y;
+    tFar = ((negative[1] ? yMin : yMax) - ray.origin.y) * inverseDirection.y;
+    tEnter = tNear > tEnter ? tNear : tEnter;
+    tExit = tFar < tExit ? tFar : tExit;
+
+    tNear = ((negative[2] ? zMax : zMin) - ray.origin.z) * inverseDirection.z;
+    tFar = ((negative[2] ? zMin : zMax) - ray.origin.z) * inverseDirection.z;
+    tEnter = tNear > tEnter ? tNear : tEnter;
+    tExit = tFar < tExit ? tFar : tExit;
+
+    // multiplying by the rounded inverse may shrink the interval a little
+    tEnterOut = tEnter;
+    tExitOut = tExit * (1 + 4 * std::numeric_limits<FloatT>::epsilon());
+}
+
+inline FloatT
+TraversalRay::intersectBox(FloatT xMin,
+                           FloatT xMax,
+                           FloatT yMin,
+                           FloatT yMax,
+                           FloatT zMin,
+                           FloatT zMax,
+                           FloatT tLimit) const
+{
+    FloatT tEnter, tExit;
+    clipBox(xMin, xMax, yMin, yMax, zMin, zMax, tEnter, tExit);
+    if (tEnter > tExit || tExit < 0 || tEnter >= tLimit)
+        return -1;
+    return tEnter < 0 ? 0 : tEnter;
+}
+}
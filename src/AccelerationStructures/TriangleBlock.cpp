@@ -0,0 +1,133 @@
+#include "TriangleBlock.hpp"
+#include "SIMDLanes.hpp"
+#include "Surface.hpp"
+#include <limits>
+
+namespace AccelerationStructures {
+namespace {
+static_assert(TriangleBlock::width % Lanes::width == 0,
+              "Block width should be a multiple of the SIMD width");
+
+/**
+ * @brief Möller–Trumbore test for Lanes::width triangles of a block
+ *
+ * Same operations as PrecomputedTriangle::intersect(), in the same order, so
+ * that the results are the same. Comparisons are written so that they fail
+ * for NaN values, which appear for unused lanes.
+ *
+ * @param block
+ * @param lane First lane to test
+ * @param ray
+ * @param tMax Intersections at this t value or farther are ignored
+ * @param tOut Set to the t values of the lanes, or infinity for lanes that are
+ * not hit
+ * @return true At least one of the lanes is hit
+ * @return false
+ */
+template<typename L>
+bool
+intersectLaneGroup(const TriangleBlock& block,
+                   int lane,
+                   const Objects::Ray& ray,
+                   FloatT tMax,
+                   FloatT* tOut)
+{
+    using Values = typename L::Values;
+    Values v[3], e1[3], e2[3], d[3], to[3];
+    for (int axis = 0; axis < 3; axis++) {
+        v[axis] = L::load(&block.vertex[axis][lane]);
+        e1[axis] = L::load(&block.edge1[axis][lane]);
+        e2[axis] = L::load(&block.edge2[axis][lane]);
+        d[axis] = L::broadcast(ray.direction[axis]);
+        to[axis] = L::subtract(L::broadcast(ray.origin[axis]), v[axis]);
+    }
+
+    auto cross = [](const Values* a, const Values* b, Values* out) {
+        out[0] = L::subtract(L::multiply(a[1], b[2]), L::multiply(a[2], b[1]));
+        out[1] = L::subtract(L::multiply(a[2], b[0]), L::multiply(a[0], b[2]));
+        out[2] = L::subtract(L::multiply(a[0], b[1]), L::multiply(a[1], b[0]));
+    };
+    auto dot = [](const Values* a, const Values* b) {
+        return L::add(L::add(L::multiply(a[0], b[0]), L::multiply(a[1], b[1])),
+                      L::multiply(a[2], b[2]));
+    };
+
+    Values p[3], q[3];
+    cross(d, e2, p);
+    auto inverseDet = L::divide(L::broadcast(1), dot(e1, p));
+    auto beta = L::multiply(dot(to, p), inverseDet);
+    cross(to, e1, q);
+    auto gamma = L::multiply(dot(d, q), inverseDet);
+    auto t = L::multiply(dot(e2, q), inverseDet);
+
+    auto low = L::broadcast(-Objects::Surface::intersectionTestEpsilon);
+    auto high = L::broadcast(1 + Objects::Surface::intersectionTestEpsilon);
+    auto hit = L::both(L::less(low, beta), L::less(beta, high));
+    hit = L::both(hit, L::less(low, gamma));
+    hit = L::both(hit, L::less(L::add(beta, gamma), high));
+    hit = L::both(hit, L::less(L::broadcast(0), t));
+    hit = L::both(hit, L::less(t, L::broadcast(tMax)));
+
+    auto infinity = L::broadcast(std::numeric_limits<FloatT>::infinity());
+    L::store(tOut, L::select(hit, t, infinity));
+    return L::any(hit);
+}
+}
+
+TriangleBlock::TriangleBlock()
+  : vertex{}
+  , edge1{}
+  , edge2{}
+{}
+
+void
+TriangleBlock::set(int lane, const PrecomputedTriangle& triangle)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        vertex[axis][lane] = triangle.vertex[axis];
+        edge1[axis][lane] = triangle.edge1[axis];
+        edge2[axis][lane] = triangle.edge2[axis];
+    }
+}
+
+int
+TriangleBlock::intersect(const Objects::Ray& ray, FloatT& t) const
+{
+    alignas(32) FloatT laneT[width];
+    if (!intersectLanes(ray, t, laneT))
+        return -1;
+
+    int closest = -1;
+    for (int lane = 0; lane < width; lane++) {
+        if (laneT[lane] < t) {
+            t = laneT[lane];
+            closest = lane;
+        }
+    }
+    return closest;
+}
+
+bool
+TriangleBlock::occluded(const Objects::Ray& ray, FloatT tMax) const
+{
+    alignas(32) FloatT laneT[width];
+    return intersectLanes(ray, tMax, laneT);
+}
+
+int
+TriangleBlock::blockCount(int triangleCount)
+{
+    return (triangleCount + width - 1) / width;
+}
+
+bool
+TriangleBlock::intersectLanes(const Objects::Ray& ray,
+                              FloatT tMax,
+                              FloatT (&tOut)[width]) const
+{
+    bool hit = false;
+    for (int lane = 0; lane < width; lane += Lanes::width)
+        hit |= intersectLaneGroup<Lanes>(*this, lane, ray, tMax, tOut + lane);
+    return hit;
+}
+}
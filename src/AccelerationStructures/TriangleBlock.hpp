@@ -0,0 +1,114 @@
+/**
+ * @file TriangleBlock.hpp
+ * @author Cem Gundogdu
+ * @brief Triangles stored in structure-of-arrays layout for SIMD tests
+ * @version 1.0
+ * @date 2021-05-07
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "AccelerationStructureConstants.hpp"
+#include "Config.hpp"
+#include "PrecomputedTriangle.hpp"
+#include "Ray.hpp"
+
+namespace AccelerationStructures {
+/**
+ * @brief A fixed number of triangles that are tested against a ray together
+ *
+ * Each coordinate of the vertices and edges of PrecomputedTriangle's is stored
+ * in its own array, so that a SIMD register can be loaded with the same
+ * coordinate of all triangles. Uses SSE for blocks of 4 and AVX2 for blocks of
+ * 8. Falls back to a scalar loop if FloatT is double or the instructions are
+ * not available.
+ *
+ * Unused lanes have zero edges, so they are never hit.
+ *
+ */
+struct alignas(32) TriangleBlock
+{
+    /**
+     * @brief Number of triangles in a block
+     *
+     */
+    static constexpr int width = TRIANGLE_BLOCK_WIDTH;
+
+    /**
+     * @brief Construct an empty block
+     *
+     */
+    TriangleBlock();
+
+    /**
+     * @brief Puts a triangle in one of the lanes
+     *
+     * @param lane In range [0, width)
+     * @param triangle
+     */
+    void set(int lane, const PrecomputedTriangle& triangle);
+
+    /**
+     * @brief Finds the closest triangle in the block that is hit before t
+     *
+     * Intersections are found the same way as PrecomputedTriangle::intersect().
+     * If several triangles are hit at the same t, the lowest lane is chosen.
+     *
+     * @param ray Ray to test intersection with
+     * @param t Intersections at this t value or farther are ignored. Set to
+     * the t value of the hit if one is found.
+     * @return Lane of the closest triangle hit, -1 if there is none
+     */
+    int intersect(const Objects::Ray& ray, FloatT& t) const;
+
+    /**
+     * @brief Checks if any triangle in the block is hit before tMax
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true There is a triangle at some t in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Objects::Ray& ray, FloatT tMax) const;
+
+    /**
+     * @brief Number of blocks needed for some number of triangles
+     *
+     * @param triangleCount
+     * @return int
+     */
+    static int blockCount(int triangleCount);
+
+    /**
+     * @name Coordinates
+     *
+     * First index is the axis, second index is the lane
+     *
+     */
+    ///@{
+    /**
+     * @brief Vertex and edges of PrecomputedTriangle
+     *
+     */
+    FloatT vertex[3][width], edge1[3][width], edge2[3][width];
+    ///@}
+
+protected:
+    /**
+     * @brief Finds the t value of each lane
+     *
+     * @param ray Ray to test intersection with
+     * @param tMax Intersections at this t value or farther are ignored
+     * @param tOut Set to the t value of each lane, or infinity if the lane is
+     * not hit before tMax
+     * @return true At least one lane is hit
+     * @return false
+     */
+    bool intersectLanes(const Objects::Ray& ray,
+                        FloatT tMax,
+                        FloatT (&tOut)[width]) const;
+};
+}
@@ -0,0 +1,178 @@
+#include "BoundingBox.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "BruteForce.hpp"
+#include "KDTree.hpp"
+#include "MortonBoundingVolumeHierarchy.hpp"
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include "SpatialSplitBoundingVolumeHierarchy.hpp"
+#include "Surface.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+using namespace AccelerationStructures;
+
+constexpr int triangleCount = 20000;
+constexpr int rayCount = 4096;
+
+/**
+ * @brief Small triangles scattered in a cube and rays crossing it
+ *
+ * The same triangles and rays are used for every structure, so that their
+ * results can be compared with each other and between versions.
+ *
+ */
+struct SceneTests
+{
+    SceneTests()
+    {
+        Objects::Surface::intersectionTestEpsilon = 0;
+        std::mt19937 generator(2021);
+        std::uniform_real_distribution<FloatT> position(-10, 10);
+        std::uniform_real_distribution<FloatT> offset(-1, 1);
+        auto randomVector = [&](std::uniform_real_distribution<FloatT>& d) {
+            return LinearAlgebra::Vec3{ d(generator),
+                                        d(generator),
+                                        d(generator) };
+        };
+
+        std::vector<Objects::Triangle> triangles;
+        for (int i = 0; i < triangleCount; i++) {
+            auto center = randomVector(position);
+            triangles.push_back({ center + randomVector(offset),
+                                  center + randomVector(offset),
+                                  center + randomVector(offset) });
+        }
+        geometry = std::make_shared<const Objects::MeshGeometry>(triangles);
+
+        for (int i = 0; i < rayCount; i++) {
+            auto origin = randomVector(position) * 1.5;
+            auto target = randomVector(position) / 2;
+            rays.emplace_back(origin, target - origin);
+        }
+    }
+
+    std::shared_ptr<const Objects::MeshGeometry> geometry;
+    std::vector<Objects::Ray> rays;
+};
+
+const SceneTests&
+tests()
+{
+    static SceneTests instance;
+    return instance;
+}
+
+/**
+ * @brief A structure built for the test triangles
+ *
+ * Benchmark functions are run several times, the structure is built only for
+ * the first run.
+ *
+ */
+template<typename Structure>
+const Structure&
+builtStructure()
+{
+    static auto instance = [] {
+        auto structure = std::make_unique<Structure>();
+        structure->build(tests().geometry);
+        return structure;
+    }();
+    return *instance;
+}
+
+/**
+ * @brief SAH BVH collapsed into nodes with Width children
+ *
+ */
+template<int Width>
+struct WideBVH : SAHBoundingVolumeHierarchy
+{
+    WideBVH()
+      : SAHBoundingVolumeHierarchy(BVH_SAH_TRAVERSAL_COST,
+                                   BVH_SAH_INTERSECTION_COST,
+                                   BVH_REFIT_REBUILD_THRESHOLD,
+                                   BVH_FULL_NODE_BITS,
+                                   Width)
+    {}
+};
+
+template<typename Structure>
+void
+BM_Build(benchmark::State& state)
+{
+    auto& data = tests();
+    for (auto _ : state) {
+        Structure structure;
+        structure.build(data.geometry);
+        benchmark::DoNotOptimize(structure.getMemoryUsage());
+    }
+    state.SetItemsProcessed(state.iterations() * triangleCount);
+}
+BENCHMARK_TEMPLATE(BM_Build, BoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Build, SAHBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Build, SpatialSplitBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Build, MortonBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Build, KDTree)->Unit(benchmark::kMillisecond);
+
+template<typename Structure>
+void
+BM_Intersect(benchmark::State& state)
+{
+    auto& data = tests();
+    auto& structure = builtStructure<Structure>();
+    LinearAlgebra::Vec3 normal;
+    for (auto _ : state) {
+        for (auto& ray : data.rays)
+            benchmark::DoNotOptimize(structure.intersect(ray, normal));
+    }
+    state.SetItemsProcessed(state.iterations() * rayCount);
+}
+BENCHMARK_TEMPLATE(BM_Intersect, BruteForce)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, BoundingBox)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, BoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, SAHBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, WideBVH<4>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, WideBVH<8>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, SpatialSplitBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, MortonBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Intersect, KDTree)->Unit(benchmark::kMillisecond);
+
+template<typename Structure>
+void
+BM_Occluded(benchmark::State& state)
+{
+    // shadow rays end in the middle of the cube, so some of them are blocked
+    auto& data = tests();
+    auto& structure = builtStructure<Structure>();
+    for (auto _ : state) {
+        for (auto& ray : data.rays)
+            benchmark::DoNotOptimize(structure.occluded(ray, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * rayCount);
+}
+BENCHMARK_TEMPLATE(BM_Occluded, BruteForce)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, BoundingBox)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, BoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, SAHBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, WideBVH<4>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, WideBVH<8>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, SpatialSplitBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, MortonBoundingVolumeHierarchy)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Occluded, KDTree)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,92 @@
+#include "Matrix.hpp"
+#include "Vector.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int vectorCount = 4096;
+
+/**
+ * @brief Random vectors in the unit cube
+ *
+ */
+const std::vector<LinearAlgebra::Vec3>&
+vectors()
+{
+    static std::vector<LinearAlgebra::Vec3> instance = [] {
+        std::mt19937 generator(2021);
+        std::uniform_real_distribution<FloatT> position(-1, 1);
+        std::vector<LinearAlgebra::Vec3> result;
+        for (int i = 0; i < vectorCount + 2; i++)
+            result.push_back({ position(generator),
+                               position(generator),
+                               position(generator) });
+        return result;
+    }();
+    return instance;
+}
+
+void
+BM_Vec3Arithmetic(benchmark::State& state)
+{
+    auto& v = vectors();
+    for (auto _ : state) {
+        for (int i = 0; i < vectorCount; i++)
+            benchmark::DoNotOptimize(v[i] + v[i + 1] * 0.5 - v[i + 2]);
+    }
+    state.SetItemsProcessed(state.iterations() * vectorCount);
+}
+BENCHMARK(BM_Vec3Arithmetic);
+
+void
+BM_Vec3Dot(benchmark::State& state)
+{
+    auto& v = vectors();
+    for (auto _ : state) {
+        for (int i = 0; i < vectorCount; i++)
+            benchmark::DoNotOptimize(v[i].dot(v[i + 1]));
+    }
+    state.SetItemsProcessed(state.iterations() * vectorCount);
+}
+BENCHMARK(BM_Vec3Dot);
+
+void
+BM_Vec3Cross(benchmark::State& state)
+{
+    auto& v = vectors();
+    for (auto _ : state) {
+        for (int i = 0; i < vectorCount; i++)
+            benchmark::DoNotOptimize(v[i].cross(v[i + 1]));
+    }
+    state.SetItemsProcessed(state.iterations() * vectorCount);
+}
+BENCHMARK(BM_Vec3Cross);
+
+void
+BM_Vec3Normalize(benchmark::State& state)
+{
+    auto& v = vectors();
+    for (auto _ : state) {
+        for (int i = 0; i < vectorCount; i++)
+            benchmark::DoNotOptimize(v[i].normalize());
+    }
+    state.SetItemsProcessed(state.iterations() * vectorCount);
+}
+BENCHMARK(BM_Vec3Normalize);
+
+void
+BM_Mat3Determinant(benchmark::State& state)
+{
+    auto& v = vectors();
+    std::vector<LinearAlgebra::Mat3> matrices;
+    for (int i = 0; i < vectorCount; i++)
+        matrices.emplace_back(v[i], v[i + 1], v[i + 2]);
+    for (auto _ : state) {
+        for (auto& matrix : matrices)
+            benchmark::DoNotOptimize(matrix.determinant());
+    }
+    state.SetItemsProcessed(state.iterations() * vectorCount);
+}
+BENCHMARK(BM_Mat3Determinant);
+}
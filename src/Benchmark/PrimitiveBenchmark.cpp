@@ -0,0 +1,89 @@
+#include "AxisAlignedBox.hpp"
+#include "Material.hpp"
+#include "Sphere.hpp"
+#include "TraversalRay.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+using AccelerationStructures::AxisAlignedBox;
+
+constexpr int testCount = 4096;
+
+/**
+ * @brief Random spheres and boxes, and rays aimed near them, so that about half
+ * of the tests are hits
+ *
+ */
+struct PrimitiveTests
+{
+    PrimitiveTests()
+    {
+        std::mt19937 generator(2021);
+        std::uniform_real_distribution<FloatT> position(-1, 1);
+        auto randomVector = [&] {
+            return LinearAlgebra::Vec3{ position(generator),
+                                        position(generator),
+                                        position(generator) };
+        };
+
+        for (int i = 0; i < testCount; i++) {
+            auto center = randomVector();
+            spheres.emplace_back(
+              center, 0.5 + position(generator) / 4, Objects::Material());
+            AxisAlignedBox box;
+            box.extend(center + randomVector() / 2);
+            box.extend(center + randomVector() / 2);
+            boxes.push_back(box);
+
+            auto origin = randomVector() * 5;
+            auto target = center + randomVector() * 0.6;
+            rays.emplace_back(origin, target - origin);
+        }
+    }
+
+    std::vector<Objects::Sphere> spheres;
+    std::vector<AxisAlignedBox> boxes;
+    std::vector<Objects::Ray> rays;
+};
+
+const PrimitiveTests&
+tests()
+{
+    static PrimitiveTests instance;
+    return instance;
+}
+
+void
+BM_SphereIntersect(benchmark::State& state)
+{
+    auto& data = tests();
+    LinearAlgebra::Vec3 normal;
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(
+              data.spheres[i].intersect(data.rays[i], normal));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_SphereIntersect);
+
+void
+BM_BoxIntersect(benchmark::State& state)
+{
+    // slab test shared by all acceleration structures. a traversal ray is
+    // created once per ray and used for many boxes, so it is not timed
+    auto& data = tests();
+    std::vector<AccelerationStructures::TraversalRay> rays;
+    rays.reserve(testCount);
+    for (auto& ray : data.rays)
+        rays.emplace_back(ray);
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(data.boxes[i].intersect(rays[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_BoxIntersect);
+}
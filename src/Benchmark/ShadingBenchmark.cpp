@@ -0,0 +1,86 @@
+#include "PathTracer.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int testCount = 4096;
+
+/**
+ * @brief Exposes the Fresnel helpers of PathTracer
+ *
+ */
+class FresnelTracer : public PathTracer::PathTracer
+{
+public:
+    using PathTracer::conductorReflectionRatio;
+    using PathTracer::dielectricReflectionRatio;
+};
+
+/**
+ * @brief Random ray directions and normals facing the rays
+ *
+ */
+struct ShadingTests
+{
+    ShadingTests()
+    {
+        std::mt19937 generator(2021);
+        std::uniform_real_distribution<FloatT> position(-1, 1);
+        auto randomVector = [&] {
+            return LinearAlgebra::Vec3{ position(generator),
+                                        position(generator),
+                                        position(generator) };
+        };
+
+        while (directions.size() < testCount) {
+            auto direction = randomVector().normalize();
+            auto normal = randomVector().normalize();
+            if (direction.dot(normal) > 0)
+                normal = normal * -1;
+            if (direction.dot(normal) == 0)
+                continue;
+            directions.push_back(direction);
+            normals.push_back(normal);
+        }
+    }
+
+    std::vector<LinearAlgebra::Vec3> directions;
+    std::vector<LinearAlgebra::Vec3> normals;
+};
+
+const ShadingTests&
+tests()
+{
+    static ShadingTests instance;
+    return instance;
+}
+
+void
+BM_ConductorReflectionRatio(benchmark::State& state)
+{
+    auto& data = tests();
+    FresnelTracer tracer;
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(tracer.conductorReflectionRatio(
+              data.directions[i], data.normals[i], 0.5, 2.5));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_ConductorReflectionRatio);
+
+void
+BM_DielectricReflectionRatio(benchmark::State& state)
+{
+    auto& data = tests();
+    FresnelTracer tracer;
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(tracer.dielectricReflectionRatio(
+              data.directions[i], data.normals[i], 1, 1.5));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_DielectricReflectionRatio);
+}
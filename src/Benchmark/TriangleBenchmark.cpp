@@ -0,0 +1,75 @@
+#include "PrecomputedTriangle.hpp"
+#include "Surface.hpp"
+#include "Triangle.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int testCount = 4096;
+
+/**
+ * @brief Random triangles and rays aimed near them, so that about half of the
+ * tests are hits
+ *
+ */
+struct TriangleTests
+{
+    TriangleTests()
+    {
+        Objects::Surface::intersectionTestEpsilon = 0;
+        std::mt19937 generator(2021);
+        std::uniform_real_distribution<FloatT> position(-1, 1);
+        auto randomVector = [&] {
+            return LinearAlgebra::Vec3{ position(generator),
+                                        position(generator),
+                                        position(generator) };
+        };
+
+        for (int i = 0; i < testCount; i++) {
+            LinearAlgebra::Vec3 v1 = randomVector(), v2 = randomVector(),
+                                v3 = randomVector();
+            triangles.emplace_back(v1, v2, v3);
+            auto origin = randomVector() * 5;
+            auto target = (v1 + v2 + v3) / 3 + randomVector() * 0.5;
+            rays.emplace_back(origin, target - origin);
+        }
+    }
+
+    std::vector<Objects::Triangle> triangles;
+    std::vector<Objects::Ray> rays;
+};
+
+const TriangleTests&
+tests()
+{
+    static TriangleTests instance;
+    return instance;
+}
+
+void
+BM_DeterminantIntersect(benchmark::State& state)
+{
+    auto& data = tests();
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(data.triangles[i].intersect(data.rays[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_DeterminantIntersect);
+
+void
+BM_PrecomputedIntersect(benchmark::State& state)
+{
+    auto& data = tests();
+    std::vector<AccelerationStructures::PrecomputedTriangle> triangles(
+      data.triangles.begin(), data.triangles.end());
+    for (auto _ : state) {
+        for (int i = 0; i < testCount; i++)
+            benchmark::DoNotOptimize(triangles[i].intersect(data.rays[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * testCount);
+}
+BENCHMARK(BM_PrecomputedIntersect);
+}
@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include "AccelerationStructureConstants.hpp"
+#include "Config.hpp"
 #include <string>
 
 namespace Options {
@@ -23,7 +25,11 @@ enum class AccelerationStructureEnum
     BruteForce,
     BoundingBox,
     BoundingVolumeHierarchy,
-    KDTree
+    BoundingVolumeHierarchySAH,
+    SpatialSplitBVH,
+    LinearBVH,
+    KDTree,
+    Auto
 };
 
 /**
@@ -33,6 +39,110 @@ enum class AccelerationStructureEnum
 inline AccelerationStructureEnum accelerationStructure =
   AccelerationStructureEnum::BoundingVolumeHierarchy;
 
+/**
+ * @brief Cost of traversing an interior node, used by the SAH BVH builder
+ *
+ */
+inline FloatT sahTraversalCost = AccelerationStructures::BVH_SAH_TRAVERSAL_COST;
+
+/**
+ * @brief Cost of a ray-triangle intersection test, used by the SAH BVH builder
+ *
+ */
+inline FloatT sahIntersectionCost =
+  AccelerationStructures::BVH_SAH_INTERSECTION_COST;
+
+/**
+ * @brief Maximum ratio of duplicate triangle references to the triangle count,
+ * used by the spatial split BVH builder
+ *
+ */
+inline FloatT sbvhDuplicationBudget =
+  AccelerationStructures::SBVH_DUPLICATION_BUDGET;
+
+/**
+ * @brief Number of rays traced with both a BVH and a k-d tree to choose
+ * between them in Auto mode. 0 chooses from the triangles of the mesh only.
+ *
+ */
+inline int autoTrialRayCount = 0;
+
+/**
+ * @brief Number of subtrees joined by agglomerative clustering at the top of
+ * linear BVH's. 0 disables clustering.
+ *
+ */
+inline int lbvhClusterCount = AccelerationStructures::LBVH_TOP_CLUSTER_COUNT;
+
+/**
+ * @brief Bits per coordinate of BVH node bounds
+ *
+ * 32 stores full precision floats. 16 or 8 quantize the box of each node
+ * relative to its parent, which uses less memory.
+ *
+ */
+inline int bvhNodeBits = AccelerationStructures::BVH_FULL_NODE_BITS;
+
+/**
+ * @brief Children per BVH node
+ *
+ * 2 traverses the binary tree, 4 or 8 collapse it into wide nodes whose
+ * children are tested together with SIMD instructions.
+ *
+ */
+inline int bvhWidth = AccelerationStructures::BVH_DEFAULT_WIDTH;
+
+/**
+ * @brief Threshold for rebuilding refit BVH's in image sequences
+ *
+ * BVH's of meshes whose vertices moved since the previous frame are refit,
+ * and built again if their cost grows by more than this ratio. 0 disables
+ * refitting.
+ *
+ */
+inline FloatT refitThreshold =
+  AccelerationStructures::BVH_REFIT_REBUILD_THRESHOLD;
+
+/**
+ * @brief Formats to print statistics in
+ *
+ */
+enum class StatsFormat
+{
+    None,
+    Text,
+    Json
+};
+
+/**
+ * @brief Format to print statistics of the acceleration structures of meshes
+ * in after each scene is created. None doesn't print them.
+ *
+ */
+inline StatsFormat accelerationStructureStats = StatsFormat::None;
+
+/**
+ * @brief File to write the timings and ray counts of the run in as JSON. Empty
+ * disables the report.
+ *
+ */
+inline std::string reportFileName;
+
+/**
+ * @brief Directory to save built acceleration structures in and load them
+ * from. Empty disables the cache.
+ *
+ */
+inline std::string cacheDirectory;
+
+/**
+ * @brief Number of threads for building acceleration structures and rendering
+ *
+ * 0 means the number of hardware threads.
+ *
+ */
+inline int threadCount = 0;
+
 /**
  * @brief Scene file's path
  *
@@ -69,6 +69,15 @@ public:
      */
     Mat3Template<ColumnT> transpose() const;
 
+    /**
+     * @brief Inverse of this matrix
+     *
+     * The matrix must not be singular.
+     *
+     * @return Mat3Template<ColumnT> Inverse of this matrix
+     */
+    Mat3Template<ColumnT> inverse() const;
+
     /**
      * @brief Matrix-Vector multiplication
      *
@@ -134,6 +143,19 @@ Mat3Template<ColumnT>::transpose() const
                                    col3.z });
 }
 
+template<typename ColumnT>
+Mat3Template<ColumnT>
+Mat3Template<ColumnT>::inverse() const
+{
+    // rows of the inverse are the cross products of pairs of columns, divided
+    // by the determinant
+    auto det = col1.dot(col2.cross(col3));
+    return Mat3Template<ColumnT>(col2.cross(col3) / det,
+                                 col3.cross(col1) / det,
+                                 col1.cross(col2) / det)
+      .transpose();
+}
+
 template<typename ColumnT>
 ColumnT
 Mat3Template<ColumnT>::operator*(const ColumnT& vec) const
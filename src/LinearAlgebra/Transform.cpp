@@ -0,0 +1,73 @@
+#include "Transform.hpp"
+#include <cmath>
+
+namespace LinearAlgebra {
+Transform::Transform()
+  : translation(0, 0, 0)
+{}
+
+Transform::Transform(const Mat3& linear, const Vec3& translation)
+  : linear(linear)
+  , translation(translation)
+{}
+
+Transform
+Transform::translate(const Vec3& offset)
+{
+    return Transform(Mat3(), offset);
+}
+
+Transform
+Transform::scale(const Vec3& factors)
+{
+    return Transform(
+      Mat3({ factors.x, 0, 0 }, { 0, factors.y, 0 }, { 0, 0, factors.z }),
+      { 0, 0, 0 });
+}
+
+Transform
+Transform::rotate(FloatT degrees, const Vec3& axis)
+{
+    // Rodrigues' rotation formula, R = cos * I + sin * [u]x + (1 - cos) * uu^T
+    auto u = axis.normalize();
+    FloatT radians = degrees * M_PI / 180;
+    FloatT c = std::cos(radians);
+    FloatT s = std::sin(radians);
+    FloatT t = 1 - c;
+    return Transform(Mat3({ c + t * u.x * u.x,
+                            t * u.x * u.y + s * u.z,
+                            t * u.x * u.z - s * u.y,
+                            t * u.x * u.y - s * u.z,
+                            c + t * u.y * u.y,
+                            t * u.y * u.z + s * u.x,
+                            t * u.x * u.z + s * u.y,
+                            t * u.y * u.z - s * u.x,
+                            c + t * u.z * u.z }),
+                     { 0, 0, 0 });
+}
+
+Transform
+Transform::operator*(const Transform& other) const
+{
+    return Transform(linear * other.linear, transformPoint(other.translation));
+}
+
+Transform
+Transform::inverse() const
+{
+    auto inverseLinear = linear.inverse();
+    return Transform(inverseLinear, inverseLinear * translation * -1);
+}
+
+Vec3
+Transform::transformPoint(const Vec3& point) const
+{
+    return linear * point + translation;
+}
+
+Vec3
+Transform::transformVector(const Vec3& vector) const
+{
+    return linear * vector;
+}
+}
@@ -0,0 +1,111 @@
+/**
+ * @file Transform.hpp
+ * @author Cem Gundogdu
+ * @brief Affine transformation
+ * @version 1.0
+ * @date 2021-05-15
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "Matrix.hpp"
+#include "Vector.hpp"
+
+namespace LinearAlgebra {
+/**
+ * @brief 3x4 affine transformation, a linear part followed by a translation
+ *
+ */
+class Transform
+{
+public:
+    /**
+     * @brief Construct an identity transformation
+     *
+     */
+    Transform();
+
+    /**
+     * @brief Construct a transformation that maps p to linear * p + translation
+     *
+     * @param linear
+     * @param translation
+     */
+    Transform(const Mat3& linear, const Vec3& translation);
+
+    /**
+     * @brief Transformation that moves points by the given offset
+     *
+     * @param offset
+     * @return Transform
+     */
+    static Transform translate(const Vec3& offset);
+
+    /**
+     * @brief Transformation that scales each axis by the corresponding
+     * component of factors
+     *
+     * @param factors
+     * @return Transform
+     */
+    static Transform scale(const Vec3& factors);
+
+    /**
+     * @brief Counterclockwise rotation around an axis through the origin
+     *
+     * @param degrees Angle of rotation
+     * @param axis Direction of the axis, doesn't need to be normalized
+     * @return Transform
+     */
+    static Transform rotate(FloatT degrees, const Vec3& axis);
+
+    /**
+     * @brief Composition of transformations
+     *
+     * @param other
+     * @return Transform Applies other first, then this
+     */
+    Transform operator*(const Transform& other) const;
+
+    /**
+     * @brief Inverse transformation
+     *
+     * The linear part must not be singular.
+     *
+     * @return Transform
+     */
+    Transform inverse() const;
+
+    /**
+     * @brief Transforms a point, applying the translation
+     *
+     * @param point
+     * @return Vec3
+     */
+    Vec3 transformPoint(const Vec3& point) const;
+
+    /**
+     * @brief Transforms a direction, ignoring the translation
+     *
+     * @param vector
+     * @return Vec3
+     */
+    Vec3 transformVector(const Vec3& vector) const;
+
+    /**
+     * @brief Linear part of the transformation
+     *
+     */
+    Mat3 linear;
+
+    /**
+     * @brief Offset added after the linear part
+     *
+     */
+    Vec3 translation;
+};
+}
@@ -180,6 +180,25 @@ public:
      */
     bool operator!=(const Vec3Template<T, ScalarT>& other) const;
 
+    /**
+     * @brief Access a component by its axis index
+     *
+     * Useful for code that chooses an axis at runtime, such as acceleration
+     * structures.
+     *
+     * @param axis 0 for x, 1 for y, 2 for z
+     * @return T& Reference to the component
+     */
+    T& operator[](int axis);
+
+    /**
+     * @brief Access a component by its axis index
+     *
+     * @param axis 0 for x, 1 for y, 2 for z
+     * @return const T& Reference to the component
+     */
+    const T& operator[](int axis) const;
+
     /**
      * @name Components
      *
@@ -377,4 +396,18 @@ Vec3Template<T, ScalarT>::operator!=(
 {
     return !(*this == other);
 }
+
+template<typename T, typename ScalarT>
+T&
+Vec3Template<T, ScalarT>::operator[](int axis)
+{
+    return axis == 0 ? x : (axis == 1 ? y : z);
+}
+
+template<typename T, typename ScalarT>
+const T&
+Vec3Template<T, ScalarT>::operator[](int axis) const
+{
+    return axis == 0 ? x : (axis == 1 ? y : z);
+}
 } // namespace LinearAlgebra
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Mesh.hpp"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -8,21 +9,124 @@ Mesh::Mesh(const std::vector<LinearAlgebra::Vec3>& vertices,
            const Material& material,
            std::unique_ptr<AccelerationStructures::AccelerationStructure>
              accelerationStructure)
+  : Mesh(std::make_shared<const std::vector<LinearAlgebra::Vec3>>(vertices),
+         std::vector<std::uint32_t>(indices.begin(), indices.end()),
+         material,
+         std::move(accelerationStructure))
+{}
+
+Mesh::Mesh(std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices,
+           std::vector<std::uint32_t> indices,
+           const Material& material,
+           std::unique_ptr<AccelerationStructures::AccelerationStructure>
+             accelerationStructure)
+  : Mesh(std::make_shared<const MeshGeometry>(std::move(vertices),
+                                              std::move(indices)),
+         material,
+         std::move(accelerationStructure))
+{}
+
+Mesh::Mesh(std::shared_ptr<const MeshGeometry> meshGeometry,
+           const Material& material,
+           std::unique_ptr<AccelerationStructures::AccelerationStructure>
+             accelerationStructure)
   : Surface(material)
+  , geometry(std::move(meshGeometry))
   , acc(std::move(accelerationStructure))
+  , boundsMin(std::numeric_limits<FloatT>::infinity(),
+              std::numeric_limits<FloatT>::infinity(),
+              std::numeric_limits<FloatT>::infinity())
+  , boundsMax(-std::numeric_limits<FloatT>::infinity(),
+              -std::numeric_limits<FloatT>::infinity(),
+              -std::numeric_limits<FloatT>::infinity())
 {
-    std::vector<Triangle> triangles;
-    triangles.reserve(indices.size() / 3);
-    for (int i = 0; i < indices.size(); i += 3)
-        triangles.push_back({ vertices[indices[i]],
-                              vertices[indices[i + 1]],
-                              vertices[indices[i + 2]] });
-    acc->build(std::move(triangles));
+    for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++) {
+        for (int corner = 0; corner < 3; corner++) {
+            auto& vertex = geometry->getVertex(i, corner);
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = std::min(boundsMin[axis], vertex[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], vertex[axis]);
+            }
+        }
+    }
+
+    updateType = acc ? acc->update(geometry)
+                     : AccelerationStructures::AccelerationStructure::
+                         UpdateType::Built;
 }
 
 FloatT
 Mesh::intersect(const Ray& ray, LinearAlgebra::Vec3& normalOut) const
 {
-    return acc->intersect(ray, normalOut);
+    if (acc)
+        return acc->intersect(ray, normalOut);
+
+    FloatT closestT = -1;
+    for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++) {
+        auto triangle = geometry->getTriangle(i);
+        FloatT t = triangle.intersect(ray);
+        if (t != -1 && (closestT == -1 || t < closestT)) {
+            closestT = t;
+            normalOut = triangle.getNormal();
+        }
+    }
+    return closestT;
+}
+
+bool
+Mesh::occluded(const Ray& ray, FloatT tMax) const
+{
+    if (acc)
+        return acc->occluded(ray, tMax);
+
+    for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++) {
+        FloatT t = geometry->getTriangle(i).intersect(ray);
+        if (t != -1 && t < tMax)
+            return true;
+    }
+    return false;
+}
+
+void
+Mesh::getBounds(LinearAlgebra::Vec3& minOut, LinearAlgebra::Vec3& maxOut) const
+{
+    minOut = boundsMin;
+    maxOut = boundsMax;
+}
+
+const MeshGeometry&
+Mesh::getGeometry() const
+{
+    return *geometry;
+}
+
+bool
+Mesh::hasAccelerationStructure() const
+{
+    return acc != nullptr;
+}
+
+const AccelerationStructures::AccelerationStructure&
+Mesh::getAccelerationStructure() const
+{
+    return *acc;
+}
+
+AccelerationStructures::AccelerationStructure::UpdateType
+Mesh::getUpdateType() const
+{
+    return updateType;
+}
+
+std::unique_ptr<AccelerationStructures::AccelerationStructure>
+Mesh::releaseAccelerationStructure()
+{
+    return std::move(acc);
+}
+
+std::size_t
+Mesh::getMemoryUsage() const
+{
+    return geometry->getIndexMemoryUsage() + (acc ? acc->getMemoryUsage() : 0);
 }
 }
\ No newline at end of file
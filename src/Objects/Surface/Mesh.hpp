@@ -13,9 +13,12 @@
 
 #include "AccelerationStructure.hpp"
 #include "Config.hpp"
+#include "MeshGeometry.hpp"
 #include "Ray.hpp"
 #include "Surface.hpp"
 #include "Triangle.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -47,6 +50,42 @@ public:
          std::unique_ptr<AccelerationStructures::AccelerationStructure>
            accelerationStructure);
 
+    /**
+     * @brief Construct a new Mesh object that shares a vertex pool
+     *
+     * The vertices are not copied, the mesh keeps a reference to the pool.
+     *
+     * @param vertices Vertex pool, may be shared by other meshes
+     * @param indices An index vector. Groups of three indices corresponds to a
+     * triangle
+     * @param material
+     * @param accelerationStructure An acceleration structure that will be
+     * built using the triangles in this mesh. If it was built before for a
+     * mesh with the same triangles, e.g. this mesh in the previous frame of an
+     * animation, it is refit instead if possible. If it has a cache, it may
+     * be loaded from there. May be null for small meshes whose triangles are
+     * put in the scene's hierarchy one by one, then the mesh tests every
+     * triangle when it is intersected on its own.
+     */
+    Mesh(std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices,
+         std::vector<std::uint32_t> indices,
+         const Material& material,
+         std::unique_ptr<AccelerationStructures::AccelerationStructure>
+           accelerationStructure);
+
+    /**
+     * @brief Construct a new Mesh object with the given triangles
+     *
+     * @param meshGeometry Triangles of the mesh
+     * @param material
+     * @param accelerationStructure Like in the constructor taking a vertex
+     * pool. If it was already built for meshGeometry, it is used as it is.
+     */
+    Mesh(std::shared_ptr<const MeshGeometry> meshGeometry,
+         const Material& material,
+         std::unique_ptr<AccelerationStructures::AccelerationStructure>
+           accelerationStructure);
+
     /**
      * @brief Finds the intersection of given ray with this mesh.
      *
@@ -66,11 +105,110 @@ public:
     FloatT intersect(const Ray& ray,
                      LinearAlgebra::Vec3& normalOut) const override;
 
+    /**
+     * @brief Checks if the ray hits this mesh before tMax
+     *
+     * @param ray
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true intersect() would return a t value in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Finds the smallest axis-aligned box containing this mesh
+     *
+     * @param minOut Set to the corner with the lowest coordinates
+     * @param maxOut Set to the corner with the highest coordinates
+     */
+    void getBounds(LinearAlgebra::Vec3& minOut,
+                   LinearAlgebra::Vec3& maxOut) const override;
+
+    /**
+     * @brief Triangles of this mesh
+     *
+     * @return const MeshGeometry&
+     */
+    const MeshGeometry& getGeometry() const;
+
+    /**
+     * @brief Checks if the mesh was given an acceleration structure
+     *
+     * @return true
+     * @return false The mesh tests every triangle
+     */
+    bool hasAccelerationStructure() const;
+
+    /**
+     * @brief Acceleration structure of this mesh
+     *
+     * Must not be called if hasAccelerationStructure() is false.
+     *
+     * @return const AccelerationStructures::AccelerationStructure&
+     */
+    const AccelerationStructures::AccelerationStructure&
+    getAccelerationStructure() const;
+
+    /**
+     * @brief How the acceleration structure was prepared in the constructor
+     *
+     * @return AccelerationStructures::AccelerationStructure::UpdateType Built,
+     * refit or loaded from a cache
+     */
+    AccelerationStructures::AccelerationStructure::UpdateType getUpdateType()
+      const;
+
+    /**
+     * @brief Takes the acceleration structure, so that it can be refit for
+     * the next frame
+     *
+     * The mesh can't be used for intersection tests afterwards.
+     *
+     * @return std::unique_ptr<AccelerationStructures::AccelerationStructure>
+     */
+    std::unique_ptr<AccelerationStructures::AccelerationStructure>
+    releaseAccelerationStructure();
+
+    /**
+     * @brief Memory used by the index buffer and the acceleration structure
+     *
+     * The vertex pool is not included, since it may be shared.
+     *
+     * @return std::size_t Size in bytes
+     */
+    std::size_t getMemoryUsage() const;
+
 protected:
     /**
-     * @brief Acceleration structure that provides intersection tests
+     * @brief Triangles, shared with the acceleration structure
+     *
+     */
+    std::shared_ptr<const MeshGeometry> geometry;
+
+    /**
+     * @brief Acceleration structure that provides intersection tests, may be
+     * null
      *
      */
     std::unique_ptr<AccelerationStructures::AccelerationStructure> acc;
+
+    /**
+     * @brief How acc was prepared in the constructor. Built if there is no
+     * acc.
+     *
+     */
+    AccelerationStructures::AccelerationStructure::UpdateType updateType;
+
+    /**
+     * @name Bounds
+     *
+     */
+    ///@{
+    /**
+     * @brief Corners of the bounding box of all triangles
+     *
+     */
+    LinearAlgebra::Vec3 boundsMin, boundsMax;
+    ///@}
 };
 }
\ No newline at end of file
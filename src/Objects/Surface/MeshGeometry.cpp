@@ -0,0 +1,71 @@
+#include "MeshGeometry.hpp"
+
+namespace Objects {
+MeshGeometry::MeshGeometry(
+  std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices,
+  std::vector<std::uint32_t> indices)
+  : vertices(std::move(vertices))
+  , indices(std::move(indices))
+{}
+
+MeshGeometry::MeshGeometry(const std::vector<Triangle>& triangles)
+{
+    auto pool = std::make_shared<std::vector<LinearAlgebra::Vec3>>();
+    pool->reserve(3 * triangles.size());
+    indices.reserve(3 * triangles.size());
+    for (auto& triangle : triangles) {
+        for (auto& vertex : { triangle.v1, triangle.v2, triangle.v3 }) {
+            indices.push_back(pool->size());
+            pool->push_back(vertex);
+        }
+    }
+    vertices = std::move(pool);
+}
+
+std::uint32_t
+MeshGeometry::getTriangleCount() const
+{
+    return indices.size() / 3;
+}
+
+const LinearAlgebra::Vec3&
+MeshGeometry::getVertex(std::uint32_t primitiveId, int corner) const
+{
+    return (*vertices)[indices[3 * primitiveId + corner]];
+}
+
+Triangle
+MeshGeometry::getTriangle(std::uint32_t primitiveId) const
+{
+    return { getVertex(primitiveId, 0),
+             getVertex(primitiveId, 1),
+             getVertex(primitiveId, 2) };
+}
+
+LinearAlgebra::Vec3
+MeshGeometry::getNormal(std::uint32_t primitiveId) const
+{
+    auto& v1 = getVertex(primitiveId, 0);
+    auto& v2 = getVertex(primitiveId, 1);
+    auto& v3 = getVertex(primitiveId, 2);
+    return (v2 - v1).cross(v3 - v2).normalize();
+}
+
+bool
+MeshGeometry::hasSameTopology(const MeshGeometry& other) const
+{
+    return indices == other.indices;
+}
+
+const std::shared_ptr<const std::vector<LinearAlgebra::Vec3>>&
+MeshGeometry::getVertices() const
+{
+    return vertices;
+}
+
+std::size_t
+MeshGeometry::getIndexMemoryUsage() const
+{
+    return indices.capacity() * sizeof(std::uint32_t);
+}
+}
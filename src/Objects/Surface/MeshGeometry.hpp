@@ -0,0 +1,132 @@
+/**
+ * @file MeshGeometry.hpp
+ * @author Cem Gundogdu
+ * @brief Indexed triangle storage shared by a mesh and its acceleration
+ * structure
+ * @version 1.0
+ * @date 2021-05-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Objects {
+/**
+ * @brief Triangles of a mesh, stored as indices into a vertex pool
+ *
+ * The vertex pool may be shared by many meshes, e.g. all meshes of a scene
+ * file use the same VertexData. Triangles are identified by 32-bit primitive
+ * IDs, which are their positions in the index buffer divided by three.
+ *
+ */
+class MeshGeometry
+{
+public:
+    /**
+     * @brief Construct a new MeshGeometry object
+     *
+     * @param vertices Vertex pool. May include vertices that are not used by
+     * this mesh.
+     * @param indices Groups of three indices into the vertex pool, one group
+     * for each triangle
+     */
+    MeshGeometry(
+      std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices,
+      std::vector<std::uint32_t> indices);
+
+    /**
+     * @brief Construct a new MeshGeometry object from separate triangles
+     *
+     * Each triangle gets its own three vertices in a new vertex pool.
+     *
+     * @param triangles
+     */
+    MeshGeometry(const std::vector<Triangle>& triangles);
+
+    /**
+     * @brief Number of triangles
+     *
+     * @return std::uint32_t
+     */
+    std::uint32_t getTriangleCount() const;
+
+    /**
+     * @brief A vertex of a triangle
+     *
+     * @param primitiveId
+     * @param corner 0, 1 or 2
+     * @return const LinearAlgebra::Vec3&
+     */
+    const LinearAlgebra::Vec3& getVertex(std::uint32_t primitiveId,
+                                         int corner) const;
+
+    /**
+     * @brief Creates a Triangle object for a triangle
+     *
+     * @param primitiveId
+     * @return Triangle
+     */
+    Triangle getTriangle(std::uint32_t primitiveId) const;
+
+    /**
+     * @brief Normal of a triangle
+     *
+     * Computed in the same way as Triangle::getNormal(), so the results are
+     * the same.
+     *
+     * @param primitiveId
+     * @return LinearAlgebra::Vec3 Unit normal vector, facing the front side
+     */
+    LinearAlgebra::Vec3 getNormal(std::uint32_t primitiveId) const;
+
+    /**
+     * @brief Checks if two geometries have the same triangles, possibly with
+     * different vertex positions
+     *
+     * @param other
+     * @return true Index buffers are the same
+     * @return false
+     */
+    bool hasSameTopology(const MeshGeometry& other) const;
+
+    /**
+     * @brief Vertex pool of this mesh
+     *
+     * @return const std::shared_ptr<const std::vector<LinearAlgebra::Vec3>>&
+     */
+    const std::shared_ptr<const std::vector<LinearAlgebra::Vec3>>&
+    getVertices() const;
+
+    /**
+     * @brief Memory used by the index buffer
+     *
+     * The vertex pool is not included since it may be shared.
+     *
+     * @return std::size_t Size in bytes
+     */
+    std::size_t getIndexMemoryUsage() const;
+
+protected:
+    /**
+     * @brief Vertex pool
+     *
+     */
+    std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices;
+
+    /**
+     * @brief Vertex indices, three for each triangle
+     *
+     */
+    std::vector<std::uint32_t> indices;
+};
+}
@@ -0,0 +1,68 @@
+#include "MeshInstance.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace Objects {
+MeshInstance::MeshInstance(std::shared_ptr<const Mesh> base,
+                           const LinearAlgebra::Transform& transform,
+                           const Material& material)
+  : Surface(material)
+  , base(std::move(base))
+  , transform(transform)
+  , inverse(transform.inverse())
+  , normalTransform(inverse.linear.transpose())
+{}
+
+FloatT
+MeshInstance::intersect(const Ray& ray, LinearAlgebra::Vec3& normalOut) const
+{
+    LinearAlgebra::Vec3 normal;
+    auto t = base->intersect(toObjectSpace(ray), normal);
+    if (t != -1)
+        normalOut = (normalTransform * normal).normalize();
+    return t;
+}
+
+bool
+MeshInstance::occluded(const Ray& ray, FloatT tMax) const
+{
+    return base->occluded(toObjectSpace(ray), tMax);
+}
+
+void
+MeshInstance::getBounds(LinearAlgebra::Vec3& minOut,
+                        LinearAlgebra::Vec3& maxOut) const
+{
+    LinearAlgebra::Vec3 baseMin, baseMax;
+    base->getBounds(baseMin, baseMax);
+
+    minOut = { std::numeric_limits<FloatT>::infinity(),
+               std::numeric_limits<FloatT>::infinity(),
+               std::numeric_limits<FloatT>::infinity() };
+    maxOut = minOut * -1;
+    // bounds of the transformed corners of the box
+    for (int corner = 0; corner < 8; corner++) {
+        LinearAlgebra::Vec3 point{ corner & 1 ? baseMax.x : baseMin.x,
+                                   corner & 2 ? baseMax.y : baseMin.y,
+                                   corner & 4 ? baseMax.z : baseMin.z };
+        point = transform.transformPoint(point);
+        for (int axis = 0; axis < 3; axis++) {
+            minOut[axis] = std::min(minOut[axis], point[axis]);
+            maxOut[axis] = std::max(maxOut[axis], point[axis]);
+        }
+    }
+}
+
+const Mesh&
+MeshInstance::getBase() const
+{
+    return *base;
+}
+
+Ray
+MeshInstance::toObjectSpace(const Ray& ray) const
+{
+    return Ray(inverse.transformPoint(ray.origin),
+               inverse.transformVector(ray.direction));
+}
+}
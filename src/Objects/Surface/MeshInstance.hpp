@@ -0,0 +1,124 @@
+/**
+ * @file MeshInstance.hpp
+ * @author Cem Gundogdu
+ * @brief Transformed copy of a mesh
+ * @version 1.0
+ * @date 2021-05-15
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "Config.hpp"
+#include "Mesh.hpp"
+#include "Ray.hpp"
+#include "Surface.hpp"
+#include "Transform.hpp"
+#include <memory>
+
+namespace Objects {
+/**
+ * @brief A mesh placed in the scene with a transformation
+ *
+ * Instances share the geometry and the acceleration structure of their base
+ * mesh. Rays are transformed to the space of the base mesh instead of
+ * transforming the triangles, so any number of instances use the memory of a
+ * single mesh.
+ *
+ */
+class MeshInstance : public Surface
+{
+public:
+    /**
+     * @brief Construct a new instance of a mesh
+     *
+     * @param base Mesh to instantiate, may be shared by other instances
+     * @param transform Maps the points of the base mesh to the scene. Its
+     * linear part must not be singular.
+     * @param material Material of the instance, which may be different from
+     * the material of the base mesh
+     */
+    MeshInstance(std::shared_ptr<const Mesh> base,
+                 const LinearAlgebra::Transform& transform,
+                 const Material& material);
+
+    /**
+     * @brief Finds the intersection of given ray with the transformed mesh
+     *
+     * The direction of the ray is not normalized after the transformation,
+     * so t values are the same in both spaces.
+     *
+     * @param ray Ray to test intersection with
+     * @param normalOut If return value is not -1, set to the normal of the
+     * intersecting triangle in the scene
+     * @return If there was no intersection in front of the ray, -1.
+     * Else, a positive t value such that origin + t * direction is on the
+     * transformed mesh
+     */
+    FloatT intersect(const Ray& ray,
+                     LinearAlgebra::Vec3& normalOut) const override;
+
+    /**
+     * @brief Checks if the transformed mesh is hit in front of the ray before
+     * tMax
+     *
+     * @param ray
+     * @param tMax
+     * @return true
+     * @return false
+     */
+    bool occluded(const Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Gets the bounds of the transformed bounding box of the base mesh
+     *
+     * @param minOut
+     * @param maxOut
+     */
+    void getBounds(LinearAlgebra::Vec3& minOut,
+                   LinearAlgebra::Vec3& maxOut) const override;
+
+    /**
+     * @brief Mesh that is instantiated
+     *
+     * @return const Mesh&
+     */
+    const Mesh& getBase() const;
+
+protected:
+    /**
+     * @brief Transforms a ray from the scene to the space of the base mesh
+     *
+     * @param ray
+     * @return Ray
+     */
+    Ray toObjectSpace(const Ray& ray) const;
+
+    /**
+     * @brief Mesh that is instantiated
+     *
+     */
+    std::shared_ptr<const Mesh> base;
+
+    /**
+     * @brief Maps the base mesh to the scene
+     *
+     */
+    LinearAlgebra::Transform transform;
+
+    /**
+     * @brief Maps the scene to the space of the base mesh
+     *
+     */
+    LinearAlgebra::Transform inverse;
+
+    /**
+     * @brief Transforms normals of the base mesh to the scene. Transpose of
+     * the linear part of inverse.
+     *
+     */
+    LinearAlgebra::Mat3 normalTransform;
+};
+}
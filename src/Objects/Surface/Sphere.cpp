@@ -11,6 +11,22 @@ Sphere::Sphere(const LinearAlgebra::Vec3& center,
 
 FloatT
 Sphere::intersect(const Ray& ray, LinearAlgebra::Vec3& normalOut) const
+{
+    auto t = intersectionT(ray);
+    if (t != -1)
+        normalOut = (ray.origin + ray.direction * t - center).normalize();
+    return t;
+}
+
+bool
+Sphere::occluded(const Ray& ray, FloatT tMax) const
+{
+    auto t = intersectionT(ray);
+    return t != -1 && t < tMax;
+}
+
+FloatT
+Sphere::intersectionT(const Ray& ray) const
 {
     /**
      * Solve the equation
@@ -42,7 +58,15 @@ Sphere::intersect(const Ray& ray, LinearAlgebra::Vec3& normalOut) const
     if (t <= 0)
         return -1;
 
-    normalOut = (ray.origin + ray.direction * t - center).normalize();
     return t;
 }
-}
\ No newline at end of file
+
+void
+Sphere::getBounds(LinearAlgebra::Vec3& minOut,
+                  LinearAlgebra::Vec3& maxOut) const
+{
+    LinearAlgebra::Vec3 radiusVector(radius, radius, radius);
+    minOut = center - radiusVector;
+    maxOut = center + radiusVector;
+}
+}
@@ -54,7 +54,35 @@ public:
     FloatT intersect(const Ray& ray,
                      LinearAlgebra::Vec3& normalOut) const override;
 
+    /**
+     * @brief Checks if the ray hits this sphere before tMax
+     *
+     * @param ray
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true intersect() would return a t value in (0, tMax)
+     * @return false
+     */
+    bool occluded(const Ray& ray, FloatT tMax) const override;
+
+    /**
+     * @brief Finds the smallest axis-aligned box containing this sphere
+     *
+     * @param minOut Set to the corner with the lowest coordinates
+     * @param maxOut Set to the corner with the highest coordinates
+     */
+    void getBounds(LinearAlgebra::Vec3& minOut,
+                   LinearAlgebra::Vec3& maxOut) const override;
+
 protected:
+    /**
+     * @brief Finds the t value of the closest intersection
+     *
+     * @param ray
+     * @return t for the closest intersection with ray, -1 if there is no
+     * intersection.
+     */
+    FloatT intersectionT(const Ray& ray) const;
+
     /**
      * @brief Center
      *
@@ -49,6 +49,30 @@ public:
     virtual FloatT intersect(const Ray& ray,
                              LinearAlgebra::Vec3& normalOut) const = 0;
 
+    /**
+     * @brief Checks if the ray hits this surface before tMax
+     *
+     * Stops at the first intersection found and doesn't find the normal, so it
+     * is cheaper than intersect() for shadow rays.
+     *
+     * @param ray
+     * @param tMax Intersections at this t value or farther are ignored
+     * @return true intersect() would return a t value in (0, tMax)
+     * @return false
+     */
+    virtual bool occluded(const Ray& ray, FloatT tMax) const = 0;
+
+    /**
+     * @brief Finds the smallest axis-aligned box containing this surface
+     *
+     * Ignores intersectionTestEpsilon.
+     *
+     * @param minOut Set to the corner with the lowest coordinates
+     * @param maxOut Set to the corner with the highest coordinates
+     */
+    virtual void getBounds(LinearAlgebra::Vec3& minOut,
+                           LinearAlgebra::Vec3& maxOut) const = 0;
+
     /**
      * @brief Material of this Surface
      *
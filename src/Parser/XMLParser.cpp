@@ -1,4 +1,6 @@
 #include "XMLParser.hpp"
+#include "AccelerationStructureConstants.hpp"
+#include "AccelerationStructureSelector.hpp"
 #include "BoundingBox.hpp"
 #include "BoundingVolumeHierarchy.hpp"
 #include "BruteForce.hpp"
@@ -6,24 +8,41 @@
 #include "GlobalOptions.hpp"
 #include "KDTree.hpp"
 #include "Mesh.hpp"
+#include "MeshInstance.hpp"
+#include "MortonBoundingVolumeHierarchy.hpp"
 #include "PLYReader.hpp"
 #include "PerspectiveCamera.hpp"
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include "SpatialSplitBoundingVolumeHierarchy.hpp"
 #include "Sphere.hpp"
+#include "ThreadPool.hpp"
 #include "rapidxml.hpp"
 #include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 
 namespace Parser {
-XMLParser::XMLParser() {}
+XMLParser::XMLParser()
+{
+    if (!Options::cacheDirectory.empty())
+        cache =
+          std::make_shared<AccelerationStructures::AccelerationStructureCache>(
+            Options::cacheDirectory);
+}
 
 bool
 XMLParser::parse(std::string fileName)
 {
     auto startTime = std::chrono::system_clock::now();
+    buildTime = std::chrono::system_clock::duration::zero();
+    refitCount = 0;
+    loadCount = 0;
+    meshCount = 0;
 
     std::ifstream file(fileName);
     if (!file.is_open()) {
@@ -46,14 +65,48 @@ XMLParser::parse(std::string fileName)
     auto sceneNode = doc.first_node("Scene");
     parseSceneNode(sceneNode);
     auto endTime = std::chrono::system_clock::now();
-    std::cout << "Scene was created in "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(
-                   endTime - startTime)
-                   .count()
-              << " ms" << std::endl;
+    parseTime = endTime - startTime - buildTime;
+    auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     endTime - startTime)
+                     .count();
+    auto buildMs =
+      std::chrono::duration_cast<std::chrono::milliseconds>(buildTime).count();
+    std::cout << "Scene was created in " << totalMs << " ms (parsing "
+              << totalMs - buildMs << " ms, building acceleration structures "
+              << buildMs << " ms on "
+              << AccelerationStructures::ThreadPool::shared().getThreadCount()
+              << " threads)" << std::endl;
+    if (refitCount)
+        std::cout << "Refit acceleration structures of " << refitCount
+                  << " meshes" << std::endl;
+    if (loadCount)
+        std::cout << "Loaded acceleration structures of " << loadCount
+                  << " meshes from cache" << std::endl;
+    printMeshMemoryUsage();
+    if (Options::accelerationStructureStats != Options::StatsFormat::None)
+        printAccelerationStructureStats(fileName);
+    previousScene.reset();
     return true;
 }
 
+void
+XMLParser::setPreviousScene(std::shared_ptr<Objects::Scene> previous)
+{
+    previousScene = std::move(previous);
+}
+
+std::chrono::system_clock::duration
+XMLParser::getParseTime() const
+{
+    return parseTime;
+}
+
+std::chrono::system_clock::duration
+XMLParser::getBuildTime() const
+{
+    return buildTime;
+}
+
 std::vector<LinearAlgebra::Vec3>
 XMLParser::readVectorArray(std::string text, bool oneIndexed)
 {
@@ -80,6 +133,7 @@ XMLParser::parseSceneNode(rapidxml::xml_node<char>* sceneNode)
     parseLights(sceneNode->first_node("Lights"));
     parseMaterials(sceneNode->first_node("Materials"));
     parseVertexData(sceneNode->first_node("VertexData"));
+    parseTransformations(sceneNode->first_node("Transformations"));
     parseSurfaces(sceneNode->first_node("Objects"));
 }
 
@@ -277,16 +331,73 @@ XMLParser::parseMaterial(rapidxml::xml_node<char>* material)
 void
 XMLParser::parseVertexData(rapidxml::xml_node<char>* vertexData)
 {
-    vertices = readVectorArray(vertexData->value(), true);
+    vertices = std::make_shared<const std::vector<LinearAlgebra::Vec3>>(
+      readVectorArray(vertexData->value(), true));
+}
+
+void
+XMLParser::parseTransformations(rapidxml::xml_node<char>* transformationsNode)
+{
+    if (!transformationsNode)
+        return;
+
+    auto transformation = transformationsNode->first_node();
+    while (transformation) {
+        auto idAttribute = transformation->first_attribute("id");
+        std::string id = idAttribute ? idAttribute->value() : "";
+        auto name = transformation->name();
+        if (strcmp("Translation", name) == 0) {
+            transformations["t" + id] = LinearAlgebra::Transform::translate(
+              readSingleVector(transformation->value()));
+        } else if (strcmp("Scaling", name) == 0) {
+            transformations["s" + id] = LinearAlgebra::Transform::scale(
+              readSingleVector(transformation->value()));
+        } else if (strcmp("Rotation", name) == 0) {
+            // angle x y z
+            auto values = readArray<FloatT>(transformation->value());
+            transformations["r" + id] = LinearAlgebra::Transform::rotate(
+              values[0], { values[1], values[2], values[3] });
+        } else {
+            std::cout << "Unknown transformation in parsing: " << name
+                      << std::endl;
+        }
+        transformation = transformation->next_sibling();
+    }
+}
+
+LinearAlgebra::Transform
+XMLParser::readTransformations(std::string text)
+{
+    LinearAlgebra::Transform result;
+    for (auto& name : readArray<std::string>(text)) {
+        auto transformation = transformations.find(name);
+        if (transformation == transformations.end()) {
+            std::cout << "Unknown transformation " << name << std::endl;
+            continue;
+        }
+        result = transformation->second * result;
+    }
+    return result;
 }
 
 void
 XMLParser::parseSurfaces(rapidxml::xml_node<char>* surfaces)
 {
+    // meshes that are not instanced may not need an acceleration structure,
+    // see addMesh()
+    instancedMeshIds.clear();
+    for (auto instance = surfaces->first_node("MeshInstance"); instance;
+         instance = instance->next_sibling("MeshInstance")) {
+        instancedMeshIds.insert(readSingleValue<int>(
+          instance->first_attribute("baseMeshId")->value()));
+    }
+
     auto surface = surfaces->first_node();
     while (surface) {
         if (strcmp("Mesh", surface->name()) == 0) {
             parseMesh(surface);
+        } else if (strcmp("MeshInstance", surface->name()) == 0) {
+            parseMeshInstance(surface);
         } else if (strcmp("Triangle", surface->name()) == 0) {
             parseTriangle(surface);
         } else if (strcmp("Sphere", surface->name()) == 0) {
@@ -297,48 +408,205 @@ XMLParser::parseSurfaces(rapidxml::xml_node<char>* surfaces)
         }
         surface = surface->next_sibling();
     }
+    addLooseTriangleMeshes();
 }
 
-void
-XMLParser::parseMesh(rapidxml::xml_node<char>* meshNode)
+std::unique_ptr<AccelerationStructures::AccelerationStructure>
+XMLParser::createAccelerationStructure(
+  Options::AccelerationStructureEnum type) const
 {
-    auto materialIndex =
-      readSingleValue<int>(meshNode->first_node("Material")->value());
-    std::unique_ptr<AccelerationStructures::AccelerationStructure> acc;
-    switch (Options::accelerationStructure) {
+    switch (type) {
         case Options::AccelerationStructureEnum::BruteForce:
-            acc = std::make_unique<AccelerationStructures::BruteForce>();
-            break;
+            return std::make_unique<AccelerationStructures::BruteForce>();
         case Options::AccelerationStructureEnum::BoundingBox:
-            acc = std::make_unique<AccelerationStructures::BoundingBox>();
-            break;
+            return std::make_unique<AccelerationStructures::BoundingBox>();
         case Options::AccelerationStructureEnum::BoundingVolumeHierarchy:
-            acc = std::make_unique<
-              AccelerationStructures::BoundingVolumeHierarchy>();
-            break;
+            return std::make_unique<
+              AccelerationStructures::BoundingVolumeHierarchy>(
+              Options::refitThreshold,
+              Options::bvhNodeBits,
+              Options::bvhWidth);
+        case Options::AccelerationStructureEnum::BoundingVolumeHierarchySAH:
+            return std::make_unique<
+              AccelerationStructures::SAHBoundingVolumeHierarchy>(
+              Options::sahTraversalCost,
+              Options::sahIntersectionCost,
+              Options::refitThreshold,
+              Options::bvhNodeBits,
+              Options::bvhWidth);
+        case Options::AccelerationStructureEnum::SpatialSplitBVH:
+            return std::make_unique<
+              AccelerationStructures::SpatialSplitBoundingVolumeHierarchy>(
+              Options::sbvhDuplicationBudget,
+              Options::sahTraversalCost,
+              Options::sahIntersectionCost,
+              Options::refitThreshold,
+              Options::bvhNodeBits,
+              Options::bvhWidth);
+        case Options::AccelerationStructureEnum::LinearBVH:
+            return std::make_unique<
+              AccelerationStructures::MortonBoundingVolumeHierarchy>(
+              AccelerationStructures::LBVH_MORTON_BITS,
+              Options::lbvhClusterCount,
+              Options::refitThreshold,
+              Options::bvhNodeBits,
+              Options::bvhWidth);
         case Options::AccelerationStructureEnum::KDTree:
-            acc = std::make_unique<AccelerationStructures::KDTree>();
+            return std::make_unique<AccelerationStructures::KDTree>();
+        case Options::AccelerationStructureEnum::Auto:
+            // chosen for each mesh by selectAccelerationStructure()
             break;
     }
+    return nullptr;
+}
+
+std::unique_ptr<AccelerationStructures::AccelerationStructure>
+XMLParser::selectAccelerationStructure(
+  const std::shared_ptr<const Objects::MeshGeometry>& geometry) const
+{
+    if (Options::accelerationStructure !=
+        Options::AccelerationStructureEnum::Auto)
+        return createAccelerationStructure(Options::accelerationStructure);
+
+    using AccelerationStructures::SelectableStructure;
+    // meshes that need a BVH get the SAH one, it traces faster than the
+    // others and builds faster than a k-d tree
+    auto create = [this](SelectableStructure structure) {
+        auto type =
+          Options::AccelerationStructureEnum::BoundingVolumeHierarchySAH;
+        if (structure == SelectableStructure::BruteForce)
+            type = Options::AccelerationStructureEnum::BruteForce;
+        else if (structure == SelectableStructure::BoundingBox)
+            type = Options::AccelerationStructureEnum::BoundingBox;
+        else if (structure == SelectableStructure::KDTree)
+            type = Options::AccelerationStructureEnum::KDTree;
+        // trial builds may be loaded from the cache too
+        auto acc = createAccelerationStructure(type);
+        acc->setCache(cache);
+        return acc;
+    };
+    AccelerationStructures::AccelerationStructureSelector selector(
+      create, Options::autoTrialRayCount);
+    auto selection = selector.select(geometry);
+    std::cout << "Mesh " << meshCount << ": "
+              << selector.getName(selection.structure) << ", "
+              << selection.reason << std::endl;
+    if (selection.built)
+        return std::move(selection.built);
+    return create(selection.structure);
+}
+
+void
+XMLParser::parseMesh(rapidxml::xml_node<char>* meshNode)
+{
+    auto materialIndex =
+      readSingleValue<int>(meshNode->first_node("Material")->value());
     auto faceNode = meshNode->first_node("Faces");
     auto plyAttribute = faceNode->first_attribute("plyFile");
-
+    auto meshVertices = vertices;
+    std::vector<std::uint32_t> indices;
     if (plyAttribute) {
         PLYReader reader;
         std::string relativeLocation = plyAttribute->value();
         auto plyData = reader.readMesh(directoryPrefix + relativeLocation);
-        auto mesh = std::shared_ptr<Objects::Surface>(
-          new Objects::Mesh(plyData.vertexPositions,
-                            plyData.indices,
-                            materials[materialIndex],
-                            std::move(acc)));
-        scene->surfaces.push_back(mesh);
+        meshVertices =
+          std::make_shared<const std::vector<LinearAlgebra::Vec3>>(
+            std::move(plyData.vertexPositions));
+        indices.assign(plyData.indices.begin(), plyData.indices.end());
     } else {
-        auto indices = readArray<int>(faceNode->value());
-        auto mesh = std::shared_ptr<Objects::Surface>(new Objects::Mesh(
-          vertices, indices, materials[materialIndex], std::move(acc)));
-        scene->surfaces.push_back(mesh);
+        indices = readArray<std::uint32_t>(faceNode->value());
+    }
+    auto idAttribute = meshNode->first_attribute("id");
+    int id = idAttribute ? readSingleValue<int>(idAttribute->value()) : -1;
+    bool instanced = idAttribute && instancedMeshIds.count(id);
+    auto mesh = addMesh(
+      std::move(meshVertices), std::move(indices), materialIndex, instanced);
+    if (idAttribute)
+        meshes[id] = mesh;
+}
+
+std::shared_ptr<const Objects::Mesh>
+XMLParser::addMesh(
+  std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> meshVertices,
+  std::vector<std::uint32_t> indices,
+  int materialIndex,
+  bool instanced)
+{
+    std::unique_ptr<AccelerationStructures::AccelerationStructure> acc;
+    auto geometry = std::make_shared<const Objects::MeshGeometry>(
+      std::move(meshVertices), std::move(indices));
+    // small meshes are tested triangle by triangle in the scene's hierarchy
+    using AccelerationStructures::SURFACE_BVH_MAX_INLINE_TRIANGLES;
+    bool flattened = !instanced && geometry->getTriangleCount() <=
+                                     SURFACE_BVH_MAX_INLINE_TRIANGLES;
+    if (flattened && Options::accelerationStructure ==
+                       Options::AccelerationStructureEnum::Auto) {
+        std::cout << "Mesh " << meshCount
+                  << ": inlined in the scene hierarchy, "
+                  << geometry->getTriangleCount() << " triangles" << std::endl;
+    }
+
+    // take the structure of the mesh at the same position in the previous
+    // frame. it is refit if the triangles didn't change
+    std::size_t position = scene->surfaces.size();
+    if (!flattened && previousScene &&
+        position < previousScene->surfaces.size()) {
+        auto previousMesh = dynamic_cast<Objects::Mesh*>(
+          previousScene->surfaces[position].get());
+        if (previousMesh)
+            acc = previousMesh->releaseAccelerationStructure();
+    }
+
+    // trial rays of automatic selection count as build time
+    auto buildStartTime = std::chrono::system_clock::now();
+    if (!acc && !flattened)
+        acc = selectAccelerationStructure(geometry);
+    if (acc)
+        acc->setCache(cache);
+    auto mesh = std::make_shared<Objects::Mesh>(
+      std::move(geometry), materials[materialIndex], std::move(acc));
+    buildTime += std::chrono::system_clock::now() - buildStartTime;
+    countUpdate(*mesh);
+    scene->surfaces.push_back(mesh);
+    meshCount++;
+    return mesh;
+}
+
+void
+XMLParser::parseMeshInstance(rapidxml::xml_node<char>* instance)
+{
+    auto baseId =
+      readSingleValue<int>(instance->first_attribute("baseMeshId")->value());
+    auto base = meshes.find(baseId);
+    if (base == meshes.end()) {
+        std::cout << "Unknown base mesh " << baseId << " of mesh instance"
+                  << std::endl;
+        return;
     }
+
+    auto materialNode = instance->first_node("Material");
+    auto material =
+      materialNode
+        ? materials[readSingleValue<int>(materialNode->value())]
+        : base->second->material;
+    auto transformationsNode = instance->first_node("Transformations");
+    auto transform = transformationsNode
+                       ? readTransformations(transformationsNode->value())
+                       : LinearAlgebra::Transform();
+
+    scene->surfaces.push_back(std::make_shared<Objects::MeshInstance>(
+      base->second, transform, material));
+}
+
+void
+XMLParser::countUpdate(const Objects::Mesh& mesh)
+{
+    using UpdateType =
+      AccelerationStructures::AccelerationStructure::UpdateType;
+    if (mesh.getUpdateType() == UpdateType::Refit)
+        refitCount++;
+    else if (mesh.getUpdateType() == UpdateType::Loaded)
+        loadCount++;
 }
 
 void
@@ -346,13 +614,18 @@ XMLParser::parseTriangle(rapidxml::xml_node<char>* triangle)
 {
     auto materialIndex =
       readSingleValue<int>(triangle->first_node("Material")->value());
-    auto indices = readArray<int>(triangle->first_node("Indices")->value());
+    auto indices =
+      readArray<std::uint32_t>(triangle->first_node("Indices")->value());
+    auto& batch = looseTriangles[materialIndex];
+    batch.insert(batch.end(), indices.begin(), indices.end());
+}
 
-    // create a mesh with a single triangle
-    auto acc = std::make_unique<AccelerationStructures::BruteForce>();
-    auto mesh = std::shared_ptr<Objects::Surface>(new Objects::Mesh(
-      vertices, indices, materials[materialIndex], std::move(acc)));
-    scene->surfaces.push_back(mesh);
+void
+XMLParser::addLooseTriangleMeshes()
+{
+    for (auto& [materialIndex, indices] : looseTriangles)
+        addMesh(vertices, std::move(indices), materialIndex);
+    looseTriangles.clear();
 }
 
 void
@@ -366,10 +639,75 @@ XMLParser::parseSphere(rapidxml::xml_node<char>* sphereNode)
       readSingleValue<FloatT>(sphereNode->first_node("Radius")->value());
 
     auto sphere = std::shared_ptr<Objects::Surface>(new Objects::Sphere(
-      vertices[centerIndex], radius, materials[materialIndex]));
+      (*vertices)[centerIndex], radius, materials[materialIndex]));
     scene->surfaces.push_back(sphere);
 }
 
+void
+XMLParser::printMeshMemoryUsage() const
+{
+    std::set<const std::vector<LinearAlgebra::Vec3>*> vertexPools;
+    std::size_t bytes = 0, triangleCount = 0;
+    for (auto& surface : scene->surfaces) {
+        auto mesh = dynamic_cast<const Objects::Mesh*>(surface.get());
+        if (!mesh)
+            continue;
+        auto& geometry = mesh->getGeometry();
+        auto& pool = geometry.getVertices();
+        if (vertexPools.insert(pool.get()).second)
+            bytes += pool->capacity() * sizeof(LinearAlgebra::Vec3);
+        bytes += mesh->getMemoryUsage();
+        triangleCount += geometry.getTriangleCount();
+    }
+    if (!triangleCount)
+        return;
+
+    std::cout << "Meshes have " << triangleCount << " triangles using "
+              << bytes / (1024 * 1024.0) << " MB, " << bytes / triangleCount
+              << " bytes per triangle" << std::endl;
+}
+
+void
+XMLParser::printAccelerationStructureStats(const std::string& fileName) const
+{
+    bool json =
+      Options::accelerationStructureStats == Options::StatsFormat::Json;
+    if (json) {
+        std::cout << "{\"scene\": \"";
+        for (char c : fileName) {
+            if (c == '"' || c == '\\')
+                std::cout << '\\';
+            std::cout << c;
+        }
+        std::cout << "\", \"meshes\": [";
+    }
+
+    int meshIndex = 0, printedCount = 0;
+    for (auto& surface : scene->surfaces) {
+        auto mesh = dynamic_cast<const Objects::Mesh*>(surface.get());
+        if (!mesh)
+            continue;
+        if (!mesh->hasAccelerationStructure()) {
+            // flattened into the scene's hierarchy
+            meshIndex++;
+            continue;
+        }
+        auto stats = mesh->getAccelerationStructure().getStats();
+        if (json) {
+            if (printedCount++)
+                std::cout << ", ";
+            stats.printJson(std::cout);
+        } else {
+            std::cout << "Mesh " << meshIndex << ": ";
+            stats.print(std::cout);
+        }
+        meshIndex++;
+    }
+
+    if (json)
+        std::cout << "]}" << std::endl;
+}
+
 Objects::Material::Type
 XMLParser::getMaterialTypeEnum(const char* typeText) const
 {
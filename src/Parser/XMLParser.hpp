@@ -11,8 +11,17 @@
 
 #pragma once
 
+#include "AccelerationStructure.hpp"
+#include "GlobalOptions.hpp"
+#include "Mesh.hpp"
 #include "Parser.hpp"
+#include "Transform.hpp"
 #include "rapidxml.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
 
 namespace Parser {
 /**
@@ -33,9 +42,10 @@ public:
      * @brief Parse the given XML file to create a Scene object
      *
      * XML file is the format used in METU. It has tags for Scene Epsilon,
-     * Cameras, Point Lights, Vertices, Surfaces (Mesh, Triangle, Sphere),
-     * Materials and things I can't remember now. This can always be extended as
-     * we will be adding more capabilities to the path tracer.
+     * Cameras, Point Lights, Vertices, Transformations, Surfaces (Mesh,
+     * MeshInstance, Triangle, Sphere), Materials and things I can't remember
+     * now. This can always be extended as we will be adding more capabilities
+     * to the path tracer.
      *
      * Also prints the time it took to create the scene. This is useful for
      * measuring the effect of acceleration structures.
@@ -47,6 +57,34 @@ public:
      */
     bool parse(std::string fileName) override;
 
+    /**
+     * @brief Reuse the acceleration structures of the previous frame of an
+     * animation
+     *
+     * The acceleration structure of each mesh is taken from the mesh at the
+     * same position in the previous scene, and is refit if the triangles are
+     * the same. The previous scene can't be rendered afterwards.
+     *
+     * @param previous Scene parsed from the previous file, may be null
+     */
+    void setPreviousScene(std::shared_ptr<Objects::Scene> previous);
+
+    /**
+     * @brief Time the last call to parse() spent on everything except building
+     * acceleration structures
+     *
+     * @return std::chrono::system_clock::duration
+     */
+    std::chrono::system_clock::duration getParseTime() const;
+
+    /**
+     * @brief Time the last call to parse() spent building acceleration
+     * structures of meshes
+     *
+     * @return std::chrono::system_clock::duration
+     */
+    std::chrono::system_clock::duration getBuildTime() const;
+
 protected:
     /**
      * @brief Parse a string with 3 numbers as a 3-component vector
@@ -189,6 +227,30 @@ protected:
      */
     virtual void parseVertexData(rapidxml::xml_node<char>* vertexData);
 
+    /**
+     * @brief Parse \<Transformations\> node
+     *
+     * Saves each \<Translation\>, \<Scaling\> and \<Rotation\> in
+     * transformations with names like "t1", "s2" and "r3", made of the first
+     * letter of the tag and the id attribute. Rotations are given as an angle
+     * in degrees followed by the axis.
+     *
+     * @param transformationsNode Can be nullptr
+     */
+    virtual void parseTransformations(
+      rapidxml::xml_node<char>* transformationsNode);
+
+    /**
+     * @brief Convert a list of transformation names to a single transformation
+     *
+     * Transformations are applied in the order they are listed, so "t1 s1"
+     * translates first and then scales.
+     *
+     * @param text Names of transformations, separated by spaces
+     * @return LinearAlgebra::Transform
+     */
+    LinearAlgebra::Transform readTransformations(std::string text);
+
     /**
      * @brief Parse \<Objects\> node
      *
@@ -196,6 +258,37 @@ protected:
      */
     virtual void parseSurfaces(rapidxml::xml_node<char>* surfaces);
 
+    /**
+     * @brief Creates an empty acceleration structure of the given type
+     *
+     * @param type Any type except Auto
+     * @return std::unique_ptr<AccelerationStructures::AccelerationStructure>
+     */
+    std::unique_ptr<AccelerationStructures::AccelerationStructure>
+    createAccelerationStructure(Options::AccelerationStructureEnum type) const;
+
+    /**
+     * @brief Creates an empty acceleration structure for a new mesh
+     *
+     * The type is Options::accelerationStructure. If it is Auto, the type is
+     * chosen by AccelerationStructures::AccelerationStructureSelector from the
+     * triangles of the mesh, and the choice is printed. If the choice was made
+     * with trial rays, the structure is already built for the geometry.
+     *
+     * @param geometry Triangles of the mesh
+     * @return std::unique_ptr<AccelerationStructures::AccelerationStructure>
+     */
+    std::unique_ptr<AccelerationStructures::AccelerationStructure>
+    selectAccelerationStructure(
+      const std::shared_ptr<const Objects::MeshGeometry>& geometry) const;
+
+    /**
+     * @brief Counts how the acceleration structure of a new mesh was prepared
+     *
+     * @param mesh
+     */
+    void countUpdate(const Objects::Mesh& mesh);
+
     /**
      * @brief Parse \<Mesh\> node
      *
@@ -203,15 +296,57 @@ protected:
      */
     virtual void parseMesh(rapidxml::xml_node<char>* mesh);
 
+    /**
+     * @brief Creates a mesh and adds it to the scene
+     *
+     * The acceleration structure of the surface at the same position in the
+     * previous scene is reused if it is a mesh, otherwise a new one is
+     * created by selectAccelerationStructure(). Meshes with at most
+     * SURFACE_BVH_MAX_INLINE_TRIANGLES triangles get none, since the scene's
+     * hierarchy tests their triangles directly, unless they are instanced.
+     *
+     * @param meshVertices Vertex pool of the mesh
+     * @param indices Three indices for each triangle
+     * @param materialIndex
+     * @param instanced The mesh is the base of mesh instances, which are
+     * tested through its acceleration structure
+     * @return std::shared_ptr<const Objects::Mesh>
+     */
+    std::shared_ptr<const Objects::Mesh> addMesh(
+      std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> meshVertices,
+      std::vector<std::uint32_t> indices,
+      int materialIndex,
+      bool instanced = false);
+
+    /**
+     * @brief Parse \<MeshInstance\> node
+     *
+     * Creates an instance of the mesh given by the baseMeshId attribute, which
+     * shares the geometry and the acceleration structure of that mesh. The
+     * material is the material of the base mesh unless a \<Material\> is
+     * given.
+     *
+     * @param instance
+     */
+    virtual void parseMeshInstance(rapidxml::xml_node<char>* instance);
+
     /**
      * @brief Parse \<Triangle\> node
      *
-     * Creates a mesh with a single triangle
+     * Adds the triangle to looseTriangles. Scenes may have thousands of
+     * them, which would be tested one by one as separate surfaces.
      *
      * @param triangle
      */
     virtual void parseTriangle(rapidxml::xml_node<char>* triangle);
 
+    /**
+     * @brief Creates a mesh with an acceleration structure for the loose
+     * triangles of each material, after the other surfaces
+     *
+     */
+    void addLooseTriangleMeshes();
+
     /**
      * @brief Parse \<Sphere\> node
      *
@@ -219,6 +354,26 @@ protected:
      */
     virtual void parseSphere(rapidxml::xml_node<char>* sphere);
 
+    /**
+     * @brief Prints the memory used by the meshes of the scene
+     *
+     * Includes vertex pools, index buffers and acceleration structures. Shared
+     * vertex pools are counted once.
+     *
+     */
+    void printMeshMemoryUsage() const;
+
+    /**
+     * @brief Prints the statistics of the acceleration structures of meshes
+     * in Options::accelerationStructureStats format
+     *
+     * JSON output is an object with the scene file name and an array with the
+     * stats of each mesh, in the order of meshes in the scene.
+     *
+     * @param fileName Scene file
+     */
+    void printAccelerationStructureStats(const std::string& fileName) const;
+
     /**
      * @brief Convert material type string to type enum
      *
@@ -240,10 +395,11 @@ protected:
     /**
      * @brief Coordinates of vertices
      *
-     * Must be one-indexed due to the format used at METU.
+     * Must be one-indexed due to the format used at METU. Meshes in the scene
+     * file share this vertex pool.
      *
      */
-    std::vector<LinearAlgebra::Vec3> vertices;
+    std::shared_ptr<const std::vector<LinearAlgebra::Vec3>> vertices;
 
     /**
      * @brief Materials in the scene
@@ -253,11 +409,86 @@ protected:
      */
     std::vector<Objects::Material> materials;
 
+    /**
+     * @brief Transformations in the scene by name, see parseTransformations()
+     *
+     */
+    std::map<std::string, LinearAlgebra::Transform> transformations;
+
+    /**
+     * @brief Meshes in the scene by their id attribute, for instancing
+     *
+     */
+    std::map<int, std::shared_ptr<const Objects::Mesh>> meshes;
+
+    /**
+     * @brief Ids of the meshes that are bases of mesh instances in the
+     * \<Objects\> node being parsed
+     *
+     */
+    std::set<int> instancedMeshIds;
+
+    /**
+     * @brief Indices of the \<Triangle\> nodes of the \<Objects\> node being
+     * parsed, by material index
+     *
+     */
+    std::map<int, std::vector<std::uint32_t>> looseTriangles;
+
     /**
      * @brief Directory of the scene file. Either ends with '/' or is empty.
      *
      */
     std::string directoryPrefix;
+
+    /**
+     * @brief Time spent building acceleration structures of meshes in the
+     * last call to parse()
+     *
+     */
+    std::chrono::system_clock::duration buildTime;
+
+    /**
+     * @brief Time spent in the last call to parse(), except buildTime
+     *
+     */
+    std::chrono::system_clock::duration parseTime;
+
+    /**
+     * @brief Scene to take the acceleration structures from, see
+     * setPreviousScene()
+     *
+     */
+    std::shared_ptr<Objects::Scene> previousScene;
+
+    /**
+     * @brief Number of meshes whose acceleration structures were refit in the
+     * last call to parse()
+     *
+     */
+    int refitCount;
+
+    /**
+     * @brief Number of meshes whose acceleration structures were loaded from
+     * the cache in the last call to parse()
+     *
+     */
+    int loadCount;
+
+    /**
+     * @brief Number of meshes created in the last call to parse(), used to
+     * number them when printing the structures chosen for them
+     *
+     */
+    int meshCount;
+
+    /**
+     * @brief Cache for the acceleration structures of meshes. Null if
+     * Options::cacheDirectory is empty.
+     *
+     */
+    std::shared_ptr<const AccelerationStructures::AccelerationStructureCache>
+      cache;
 };
 
 template<typename T>
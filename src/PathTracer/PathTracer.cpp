@@ -10,6 +10,12 @@
 #include <thread>
 
 namespace PathTracer {
+namespace {
+// rays traced by the current thread. each thread adds them to the total when
+// it is done, so that tracing doesn't wait on a shared counter
+thread_local RayCounts threadRayCounts;
+}
+
 PathTracer::PathTracer()
   : image(0, 0)
 {}
@@ -19,6 +25,15 @@ PathTracer::trace(std::shared_ptr<Objects::Scene> scenePtr)
 {
     scene = scenePtr;
     Objects::Surface::intersectionTestEpsilon = scene->intersectionTestEpsilon;
+    auto buildStartTime = std::chrono::system_clock::now();
+    surfaceHierarchy.build(scene->surfaces);
+    hierarchyBuildTime = std::chrono::system_clock::now() - buildStartTime;
+    std::cout << "Scene hierarchy was built in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   hierarchyBuildTime)
+                   .count()
+              << " ms" << std::endl;
+    cameraRecords.clear();
 
     for (auto cam : scene->cameras) {
         auto imageStartTime = std::chrono::system_clock::now();
@@ -27,12 +42,15 @@ PathTracer::trace(std::shared_ptr<Objects::Scene> scenePtr)
         int h = camera->getHeight();
         image = Image::Image<unsigned char>(w, h);
         times = std::vector<std::vector<int>>(h, std::vector<int>(w));
+        rayCounts = {};
 
 #ifdef MULTITHREADED
         tilesX = (w + TILE_SIZE - 1) / TILE_SIZE; // round up
         tilesY = (h + TILE_SIZE - 1) / TILE_SIZE; // round up
         nextTile = 0;
-        int threadCount = std::thread::hardware_concurrency();
+        int threadCount = Options::threadCount;
+        if (threadCount <= 0)
+            threadCount = std::thread::hardware_concurrency();
         std::vector<std::thread> threads(threadCount);
         for (int i = 0; i < threadCount; i++) {
             threads[i] = std::thread(&PathTracer::traceTilesInThread, this);
@@ -45,7 +63,9 @@ PathTracer::trace(std::shared_ptr<Objects::Scene> scenePtr)
                 tracePixel(x, y);
             }
         }
+        addThreadRayCounts();
 #endif
+        auto traceEndTime = std::chrono::system_clock::now();
         auto timeImageNormalized = createTimeImage();
 
         Image::PNGExporter exporter;
@@ -56,6 +76,12 @@ PathTracer::trace(std::shared_ptr<Objects::Scene> scenePtr)
                                "_time.png");
 
         auto imageEndTime = std::chrono::system_clock::now();
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        cameraRecords.push_back(
+          { camera->imageName(),
+            Milliseconds(traceEndTime - imageStartTime).count(),
+            Milliseconds(imageEndTime - traceEndTime).count(),
+            rayCounts });
         std::cout << camera->imageName() << " took "
                   << std::chrono::duration_cast<std::chrono::milliseconds>(
                        imageEndTime - imageStartTime)
@@ -64,24 +90,26 @@ PathTracer::trace(std::shared_ptr<Objects::Scene> scenePtr)
     }
 }
 
+const std::vector<CameraRecord>&
+PathTracer::getCameraRecords() const
+{
+    return cameraRecords;
+}
+
+std::chrono::system_clock::duration
+PathTracer::getHierarchyBuildTime() const
+{
+    return hierarchyBuildTime;
+}
+
 LinearAlgebra::Vec3
 PathTracer::rayColor(const Objects::Ray& ray, int remainingDepth)
 {
-    FloatT minT = std::numeric_limits<FloatT>::infinity();
     LinearAlgebra::Vec3 normal;
     Objects::Surface* closest = nullptr;
+    FloatT minT = surfaceHierarchy.intersect(ray, normal, closest);
 
-    for (auto surface : scene->surfaces) {
-        LinearAlgebra::Vec3 tmpNormal;
-        FloatT t = surface->intersect(ray, tmpNormal);
-        if (t != -1 && t < minT) {
-            minT = t;
-            normal = tmpNormal;
-            closest = surface.get();
-        }
-    }
-
-    if (!closest)
+    if (minT == -1)
         return scene->backgroundColor;
 
     // hit a surface
@@ -117,6 +145,7 @@ PathTracer::rayColor(const Objects::Ray& ray, int remainingDepth)
         auto reflectedDirection =
           ray.direction - normal * (2 * normal.dot(ray.direction));
         auto reflectedRay = Objects::Ray(hitPoint, reflectedDirection);
+        threadRayCounts.secondary++;
         auto reflectedColor = rayColor(reflectedRay, remainingDepth - 1);
         color += reflectedColor * material.mirrorReflectance;
     }
@@ -126,6 +155,7 @@ PathTracer::rayColor(const Objects::Ray& ray, int remainingDepth)
         auto reflectedDirection =
           ray.direction - normal * (2 * normal.dot(ray.direction));
         auto reflectedRay = Objects::Ray(hitPoint, reflectedDirection);
+        threadRayCounts.secondary++;
         auto reflectedColor = rayColor(reflectedRay, remainingDepth - 1);
         auto reflectionRatio =
           conductorReflectionRatio(ray.direction,
@@ -150,6 +180,7 @@ PathTracer::rayColor(const Objects::Ray& ray, int remainingDepth)
         auto reflectedRay =
           Objects::Ray(hitPoint + 2 * scene->shadowRayEpsilon * normal,
                        ray.direction - 2 * normal.dot(ray.direction) * normal);
+        threadRayCounts.secondary++;
         auto reflectedColor = rayColor(reflectedRay, remainingDepth - 1);
         color += reflectionRatio * reflectedColor;
 
@@ -181,6 +212,7 @@ PathTracer::rayColor(const Objects::Ray& ray, int remainingDepth)
                                                     material.refractionIndex,
                                                     VacuumRefractiveIndex);
 
+                threadRayCounts.secondary++;
                 auto baseColor = rayColor(refractedRay, remainingDepth);
 
                 LinearAlgebra::Vec3 attenuationCoefficient = {
@@ -204,17 +236,12 @@ PathTracer::lightVisible(const LinearAlgebra::Vec3& point,
 {
     auto lightDir = light.position - point;
     auto ray = Objects::Ray(point, lightDir);
+    threadRayCounts.shadow++;
 
     // lightDir is not normalized. this way, t < 1 means a surface is closer
     // than the light, t > 1 means the surface is behind the light
 
-    for (auto surface : scene->surfaces) {
-        LinearAlgebra::Vec3 normal;
-        auto t = surface->intersect(ray, normal);
-        if (t != -1 && t < 1)
-            return false;
-    }
-    return true;
+    return !surfaceHierarchy.occluded(ray, 1);
 }
 
 Image::Image<unsigned char>
@@ -289,6 +316,7 @@ PathTracer::tracePixel(int x, int y)
 {
     auto startTime = std::chrono::system_clock::now();
     auto ray = camera->castRay(x, y);
+    threadRayCounts.primary++;
     auto color = rayColor(ray, scene->maxRecursionDepth);
 
     image.setPixel(x,
@@ -309,9 +337,11 @@ PathTracer::traceTilesInThread()
 {
     for (;;) {
         int myTile = nextTile.fetch_add(1);
-        if (myTile >= tilesX * tilesY)
+        if (myTile >= tilesX * tilesY) {
             // no more tiles
+            addThreadRayCounts();
             return;
+        }
 
         int xLeft = (myTile % tilesX) * TILE_SIZE;
         int yTop = (myTile / tilesX) * TILE_SIZE;
@@ -328,6 +358,16 @@ PathTracer::traceTilesInThread()
     }
 }
 
+void
+PathTracer::addThreadRayCounts()
+{
+    std::lock_guard<std::mutex> lock(rayCountMutex);
+    rayCounts.primary += threadRayCounts.primary;
+    rayCounts.secondary += threadRayCounts.secondary;
+    rayCounts.shadow += threadRayCounts.shadow;
+    threadRayCounts = {};
+}
+
 FloatT
 PathTracer::leaveDielectric(Objects::Ray& ray,
                             Objects::Surface* dielectric,
@@ -339,6 +379,7 @@ PathTracer::leaveDielectric(Objects::Ray& ray,
     FloatT distance = 0;
     while (remainingRecursions >= 0) {
         remainingRecursions--;
+        threadRayCounts.secondary++;
         auto t = dielectric->intersect(ray, normal);
         if (t == -1) {
             // normally we must hit the surface but just in case
@@ -13,8 +13,13 @@
 
 #include "Image.hpp"
 #include "Ray.hpp"
+#include "RenderReport.hpp"
 #include "Scene.hpp"
+#include "SurfaceBoundingVolumeHierarchy.hpp"
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
 
 namespace PathTracer {
 /**
@@ -69,6 +74,22 @@ public:
     virtual bool lightVisible(const LinearAlgebra::Vec3& point,
                               const Objects::PointLight& light);
 
+    /**
+     * @brief Timings and ray counts of the cameras rendered by the last call
+     * to trace()
+     *
+     * @return const std::vector<CameraRecord>&
+     */
+    const std::vector<CameraRecord>& getCameraRecords() const;
+
+    /**
+     * @brief Time the last call to trace() spent building the hierarchy of the
+     * scene's surfaces
+     *
+     * @return std::chrono::system_clock::duration
+     */
+    std::chrono::system_clock::duration getHierarchyBuildTime() const;
+
 protected:
     /**
      * @brief Creates an image where the pixel that took the longest time is
@@ -120,6 +141,13 @@ protected:
      */
     void traceTilesInThread();
 
+    /**
+     * @brief Adds the rays counted by the current thread to rayCounts, and
+     * resets the thread's counts
+     *
+     */
+    void addThreadRayCounts();
+
     /**
      * @brief Finds where a ray leaves the dielectric and the distance it
      * travels inside
@@ -210,6 +238,14 @@ protected:
      */
     std::shared_ptr<Objects::Scene> scene;
 
+    /**
+     * @brief Top-level acceleration structure over the surfaces of scene
+     *
+     * Both closest-hit and shadow queries go through it.
+     *
+     */
+    AccelerationStructures::SurfaceBoundingVolumeHierarchy surfaceHierarchy;
+
     /**
      * @brief Camera whose output is currently being rendered
      *
@@ -258,5 +294,29 @@ protected:
      */
     int tilesY;
     ///@}
+
+    /**
+     * @brief Rays traced for the current camera by the threads that are done
+     *
+     */
+    RayCounts rayCounts;
+
+    /**
+     * @brief Guards rayCounts
+     *
+     */
+    std::mutex rayCountMutex;
+
+    /**
+     * @brief Records of the cameras rendered so far
+     *
+     */
+    std::vector<CameraRecord> cameraRecords;
+
+    /**
+     * @brief Time spent building surfaceHierarchy
+     *
+     */
+    std::chrono::system_clock::duration hierarchyBuildTime{};
 };
 }
\ No newline at end of file
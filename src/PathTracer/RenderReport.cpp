@@ -0,0 +1,128 @@
+#include "RenderReport.hpp"
+#include "GlobalOptions.hpp"
+#include "ThreadPool.hpp"
+#include <fstream>
+#include <sys/resource.h>
+
+namespace PathTracer {
+namespace {
+/**
+ * @brief Name of the acceleration structure option, as given to -a
+ *
+ * @return const char*
+ */
+const char*
+structureName()
+{
+    switch (Options::accelerationStructure) {
+        case Options::AccelerationStructureEnum::BruteForce:
+            return "bf";
+        case Options::AccelerationStructureEnum::BoundingBox:
+            return "bb";
+        case Options::AccelerationStructureEnum::BoundingVolumeHierarchy:
+            return "bvh";
+        case Options::AccelerationStructureEnum::BoundingVolumeHierarchySAH:
+            return "bvh-sah";
+        case Options::AccelerationStructureEnum::SpatialSplitBVH:
+            return "sbvh";
+        case Options::AccelerationStructureEnum::LinearBVH:
+            return "lbvh";
+        case Options::AccelerationStructureEnum::Auto:
+            return "auto";
+        case Options::AccelerationStructureEnum::KDTree:
+            return "kd";
+    }
+    return "";
+}
+
+/**
+ * @brief Writes a JSON string, escaping quotes and backslashes
+ *
+ * @param stream
+ * @param text
+ */
+void
+writeString(std::ostream& stream, const std::string& text)
+{
+    stream << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            stream << '\\';
+        stream << c;
+    }
+    stream << '"';
+}
+
+/**
+ * @brief Rays per second
+ *
+ * @param count
+ * @param ms Time it took to trace them
+ * @return double
+ */
+double
+rate(std::uint64_t count, double ms)
+{
+    return ms > 0 ? count * 1000 / ms : 0;
+}
+}
+
+void
+RenderReport::addScene(const std::string& fileName,
+                       double parseMs,
+                       double buildMs)
+{
+    scenes.push_back({ fileName, parseMs, buildMs, {} });
+}
+
+void
+RenderReport::addCamera(const CameraRecord& record)
+{
+    if (!scenes.empty())
+        scenes.back().cameras.push_back(record);
+}
+
+bool
+RenderReport::write(const std::string& fileName) const
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::ofstream stream(fileName);
+    stream << "{\n  \"structure\": \"" << structureName() << "\",\n"
+           << "  \"threads\": "
+           << AccelerationStructures::ThreadPool::shared().getThreadCount()
+           << ",\n  \"bvhNodeBits\": " << Options::bvhNodeBits
+           << ",\n  \"bvhWidth\": " << Options::bvhWidth
+           << ",\n  \"peakRssKb\": " << usage.ru_maxrss
+           << ",\n  \"scenes\": [";
+    for (std::size_t i = 0; i < scenes.size(); i++) {
+        auto& scene = scenes[i];
+        stream << (i ? ",\n" : "\n") << "    {\"file\": ";
+        writeString(stream, scene.fileName);
+        stream << ", \"parseMs\": " << scene.parseMs
+               << ", \"buildMs\": " << scene.buildMs << ", \"cameras\": [";
+        for (std::size_t j = 0; j < scene.cameras.size(); j++) {
+            auto& camera = scene.cameras[j];
+            auto& rays = camera.rays;
+            stream << (j ? ",\n" : "\n") << "      {\"image\": ";
+            writeString(stream, camera.imageName);
+            stream << ", \"traceMs\": " << camera.traceMs
+                   << ", \"encodeMs\": " << camera.encodeMs
+                   << ", \"primaryRays\": " << rays.primary
+                   << ", \"secondaryRays\": " << rays.secondary
+                   << ", \"shadowRays\": " << rays.shadow
+                   << ", \"primaryRaysPerSecond\": "
+                   << rate(rays.primary, camera.traceMs)
+                   << ", \"secondaryRaysPerSecond\": "
+                   << rate(rays.secondary, camera.traceMs)
+                   << ", \"shadowRaysPerSecond\": "
+                   << rate(rays.shadow, camera.traceMs) << '}';
+        }
+        stream << "]}";
+    }
+    stream << "\n  ]\n}\n";
+    stream.close();
+    return bool(stream);
+}
+}
@@ -0,0 +1,133 @@
+/**
+ * @file RenderReport.hpp
+ * @author Cem Gundogdu
+ * @brief Timings and ray counts of a run, saved for comparing versions
+ * @version 1.0
+ * @date 2021-05-14
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PathTracer {
+/**
+ * @brief Rays traced while rendering an image
+ *
+ */
+struct RayCounts
+{
+    /**
+     * @brief Rays from the camera, one for each pixel
+     *
+     */
+    std::uint64_t primary = 0;
+
+    /**
+     * @brief Reflected and refracted rays, including the reflections inside
+     * dielectrics
+     *
+     */
+    std::uint64_t secondary = 0;
+
+    /**
+     * @brief Rays towards lights
+     *
+     */
+    std::uint64_t shadow = 0;
+};
+
+/**
+ * @brief How long an image took to render and how many rays it needed
+ *
+ */
+struct CameraRecord
+{
+    /**
+     * @brief Output file name of the camera
+     *
+     */
+    std::string imageName;
+
+    /**
+     * @brief Time spent tracing rays
+     *
+     */
+    double traceMs = 0;
+
+    /**
+     * @brief Time spent encoding and saving the PNG files
+     *
+     */
+    double encodeMs = 0;
+
+    /**
+     * @brief Rays traced for the image
+     *
+     */
+    RayCounts rays;
+};
+
+/**
+ * @brief Collects the timings of every scene and camera of a run, and writes
+ * them in a JSON file
+ *
+ */
+class RenderReport
+{
+public:
+    /**
+     * @brief Starts the record of a scene
+     *
+     * @param fileName Scene file
+     * @param parseMs Time spent creating the scene, except building the
+     * acceleration structures
+     * @param buildMs Time spent building the acceleration structures of meshes
+     * and the hierarchy of the scene's surfaces
+     */
+    void addScene(const std::string& fileName, double parseMs, double buildMs);
+
+    /**
+     * @brief Adds a camera to the last scene
+     *
+     * @param record
+     */
+    void addCamera(const CameraRecord& record);
+
+    /**
+     * @brief Writes the report as JSON
+     *
+     * Besides the records, the file has the settings of the run and the peak
+     * resident set size of the process.
+     *
+     * @param fileName
+     * @return true
+     * @return false The file could not be written
+     */
+    bool write(const std::string& fileName) const;
+
+protected:
+    /**
+     * @brief Timings of a scene
+     *
+     */
+    struct SceneRecord
+    {
+        std::string fileName;
+        double parseMs;
+        double buildMs;
+        std::vector<CameraRecord> cameras;
+    };
+
+    /**
+     * @brief Scenes in the order they were rendered
+     *
+     */
+    std::vector<SceneRecord> scenes;
+};
+}
@@ -0,0 +1,174 @@
+#include "AccelerationStructureCache.hpp"
+#include "BruteForce.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include "SpatialSplitBoundingVolumeHierarchy.hpp"
+#include "Surface.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <random>
+#include <unistd.h>
+
+namespace AccelerationStructures {
+namespace Test {
+using UpdateType = AccelerationStructure::UpdateType;
+
+class AccelerationStructureCacheTest : public ::testing::Test
+{
+protected:
+    AccelerationStructureCacheTest()
+      : directory(std::filesystem::temp_directory_path() /
+                  ("PathTracerCacheTest" + std::to_string(getpid())))
+      , cache(std::make_shared<AccelerationStructureCache>(directory))
+    {
+        Objects::Surface::intersectionTestEpsilon = 0;
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<FloatT> position(-10, 10);
+        std::vector<Objects::Triangle> triangles;
+        for (int i = 0; i < 1000; i++) {
+            LinearAlgebra::Vec3 center{ position(generator),
+                                        position(generator),
+                                        position(generator) };
+            triangles.push_back({ center,
+                                  center + LinearAlgebra::Vec3{ 1, 0, 0 },
+                                  center + LinearAlgebra::Vec3{ 0, 1, 0 } });
+        }
+        geometry = std::make_shared<const Objects::MeshGeometry>(triangles);
+    }
+
+    ~AccelerationStructureCacheTest()
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    // compares the structure with brute force on rays towards the triangles
+    void expectSameAsBruteForce(const AccelerationStructure& acc)
+    {
+        BruteForce reference;
+        reference.build(geometry);
+        int hits = 0;
+        for (std::uint32_t i = 0; i < geometry->getTriangleCount(); i++) {
+            auto target = geometry->getVertex(i, 0) +
+                          LinearAlgebra::Vec3{ 0.25, 0.25, 0 };
+            Objects::Ray ray(target + LinearAlgebra::Vec3{ 1, 2, 30 },
+                             LinearAlgebra::Vec3{ -1, -2, -30 });
+            LinearAlgebra::Vec3 expectedNormal, normal;
+            auto expected = reference.intersect(ray, expectedNormal);
+            ASSERT_FLOAT_EQ(expected, acc.intersect(ray, normal));
+            if (expected != -1) {
+                hits++;
+                LinearAlgebra::Test::EXPECT_VECTOR_EQ(expectedNormal, normal);
+            }
+        }
+        EXPECT_GT(hits, 500);
+    }
+
+    std::filesystem::path directory;
+    std::shared_ptr<AccelerationStructureCache> cache;
+    std::shared_ptr<const Objects::MeshGeometry> geometry;
+};
+
+TEST_F(AccelerationStructureCacheTest, LoadsWhatWasSaved)
+{
+    SAHBoundingVolumeHierarchy first;
+    first.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, first.update(geometry));
+
+    SAHBoundingVolumeHierarchy second;
+    second.setCache(cache);
+    EXPECT_EQ(UpdateType::Loaded, second.update(geometry));
+    expectSameAsBruteForce(second);
+}
+
+TEST_F(AccelerationStructureCacheTest, DifferentSettingsAreNotShared)
+{
+    SAHBoundingVolumeHierarchy sah;
+    sah.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, sah.update(geometry));
+
+    SAHBoundingVolumeHierarchy cheapTraversal(0.5);
+    cheapTraversal.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, cheapTraversal.update(geometry));
+
+    SpatialSplitBoundingVolumeHierarchy spatial;
+    spatial.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, spatial.update(geometry));
+
+    SAHBoundingVolumeHierarchy quantized(BVH_SAH_TRAVERSAL_COST,
+                                         BVH_SAH_INTERSECTION_COST,
+                                         BVH_REFIT_REBUILD_THRESHOLD,
+                                         8);
+    quantized.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, quantized.update(geometry));
+
+    SAHBoundingVolumeHierarchy wide(BVH_SAH_TRAVERSAL_COST,
+                                    BVH_SAH_INTERSECTION_COST,
+                                    BVH_REFIT_REBUILD_THRESHOLD,
+                                    BVH_FULL_NODE_BITS,
+                                    4);
+    wide.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, wide.update(geometry));
+}
+
+TEST_F(AccelerationStructureCacheTest, LoadsQuantizedNodes)
+{
+    SAHBoundingVolumeHierarchy first(BVH_SAH_TRAVERSAL_COST,
+                                     BVH_SAH_INTERSECTION_COST,
+                                     BVH_REFIT_REBUILD_THRESHOLD,
+                                     16);
+    first.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, first.update(geometry));
+
+    SAHBoundingVolumeHierarchy second(BVH_SAH_TRAVERSAL_COST,
+                                      BVH_SAH_INTERSECTION_COST,
+                                      BVH_REFIT_REBUILD_THRESHOLD,
+                                      16);
+    second.setCache(cache);
+    EXPECT_EQ(UpdateType::Loaded, second.update(geometry));
+    expectSameAsBruteForce(second);
+}
+
+TEST_F(AccelerationStructureCacheTest, LoadsWideNodes)
+{
+    SAHBoundingVolumeHierarchy first(BVH_SAH_TRAVERSAL_COST,
+                                     BVH_SAH_INTERSECTION_COST,
+                                     BVH_REFIT_REBUILD_THRESHOLD,
+                                     BVH_FULL_NODE_BITS,
+                                     8);
+    first.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, first.update(geometry));
+
+    SAHBoundingVolumeHierarchy second(BVH_SAH_TRAVERSAL_COST,
+                                      BVH_SAH_INTERSECTION_COST,
+                                      BVH_REFIT_REBUILD_THRESHOLD,
+                                      BVH_FULL_NODE_BITS,
+                                      8);
+    second.setCache(cache);
+    EXPECT_EQ(UpdateType::Loaded, second.update(geometry));
+    expectSameAsBruteForce(second);
+}
+
+TEST_F(AccelerationStructureCacheTest, DamagedFileIsRebuilt)
+{
+    SAHBoundingVolumeHierarchy first;
+    first.setCache(cache);
+    first.update(geometry);
+
+    // overwrite everything after the header with garbage
+    for (auto& entry : std::filesystem::directory_iterator(directory)) {
+        auto size = std::filesystem::file_size(entry.path());
+        std::fstream file(entry.path(),
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(256);
+        for (auto i = 256u; i < size; i++)
+            file.put(char(0xab));
+    }
+
+    SAHBoundingVolumeHierarchy second;
+    second.setCache(cache);
+    EXPECT_EQ(UpdateType::Built, second.update(geometry));
+    expectSameAsBruteForce(second);
+}
+}
+}
@@ -0,0 +1,114 @@
+#include "AccelerationStructureSelector.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "KDTree.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+namespace AccelerationStructures {
+namespace Test {
+namespace {
+/**
+ * @brief Small triangles on a grid in the z = 0 plane
+ *
+ * @param count Number of triangles
+ * @param size Size of each triangle, relative to the spacing of the grid
+ * @return std::shared_ptr<const Objects::MeshGeometry>
+ */
+std::shared_ptr<const Objects::MeshGeometry>
+gridTriangles(int count, FloatT size)
+{
+    std::vector<Objects::Triangle> triangles;
+    for (int i = 0; i < count; i++) {
+        LinearAlgebra::Vec3 corner{ FloatT(i % 64), FloatT(i / 64), 0 };
+        triangles.push_back({ corner,
+                              corner + LinearAlgebra::Vec3{ size, 0, 0 },
+                              corner + LinearAlgebra::Vec3{ 0, size, 0 } });
+    }
+    return std::make_shared<const Objects::MeshGeometry>(triangles);
+}
+
+std::unique_ptr<AccelerationStructure>
+createStructure(SelectableStructure structure)
+{
+    if (structure == SelectableStructure::KDTree)
+        return std::make_unique<KDTree>();
+    return std::make_unique<BoundingVolumeHierarchy>();
+}
+}
+
+TEST(AccelerationStructureSelectorTest, ChoosesByTriangleCount)
+{
+    AccelerationStructureSelector selector(createStructure);
+    auto single = selector.select(gridTriangles(1, 0.5));
+    EXPECT_EQ(SelectableStructure::BruteForce, single.structure);
+    EXPECT_FALSE(single.reason.empty());
+
+    auto box = selector.select(gridTriangles(12, 0.5));
+    EXPECT_EQ(SelectableStructure::BoundingBox, box.structure)
+      << "a box is too few triangles to divide";
+
+    auto large = selector.select(gridTriangles(AUTO_KD_MAX_TRIANGLES + 1, 0.5));
+    EXPECT_EQ(SelectableStructure::BoundingVolumeHierarchy, large.structure)
+      << large.reason;
+}
+
+TEST(AccelerationStructureSelectorTest, ChoosesByTriangleSize)
+{
+    AccelerationStructureSelector selector(createStructure);
+    auto small = selector.select(gridTriangles(4096, 0.5));
+    EXPECT_EQ(SelectableStructure::KDTree, small.structure) << small.reason;
+
+    // triangles spanning most of the mesh would be cut by most planes
+    std::vector<Objects::Triangle> triangles;
+    for (int i = 0; i < 100; i++) {
+        FloatT z = i;
+        triangles.push_back({ { 0, 0, z }, { 100, 0, z }, { 0, 100, z } });
+    }
+    auto large = selector.select(
+      std::make_shared<const Objects::MeshGeometry>(triangles));
+    EXPECT_EQ(SelectableStructure::BoundingVolumeHierarchy, large.structure)
+      << large.reason;
+}
+
+TEST(AccelerationStructureSelectorTest, TrialBuildsBothStructures)
+{
+    std::vector<SelectableStructure> created;
+    AccelerationStructureSelector selector(
+      [&](SelectableStructure structure) {
+          created.push_back(structure);
+          return createStructure(structure);
+      },
+      100);
+    auto geometry = gridTriangles(1000, 0.5);
+    auto selection = selector.select(geometry);
+    EXPECT_TRUE(selection.structure == SelectableStructure::KDTree ||
+                selection.structure ==
+                  SelectableStructure::BoundingVolumeHierarchy);
+    EXPECT_EQ(
+      (std::vector<SelectableStructure>{
+        SelectableStructure::BoundingVolumeHierarchy,
+        SelectableStructure::KDTree }),
+      created);
+    EXPECT_NE(std::string::npos, selection.reason.find("100 trial rays"));
+
+    // the winner is kept, updating it with the same geometry doesn't build
+    // it again
+    ASSERT_TRUE(selection.built);
+    EXPECT_EQ(selection.structure == SelectableStructure::KDTree,
+              dynamic_cast<KDTree*>(selection.built.get()) != nullptr);
+    auto buildMs = selection.built->getStats().buildMs;
+    EXPECT_EQ(AccelerationStructure::UpdateType::Built,
+              selection.built->update(geometry));
+    EXPECT_EQ(buildMs, selection.built->getStats().buildMs);
+    LinearAlgebra::Vec3 normal;
+    EXPECT_FLOAT_EQ(
+      1, selection.built->intersect({ { 0.1, 0.1, -1 }, { 0, 0, 1 } }, normal));
+
+    // small meshes are chosen without trials
+    created.clear();
+    EXPECT_FALSE(selector.select(gridTriangles(10, 0.5)).built);
+    EXPECT_TRUE(created.empty());
+}
+}
+}
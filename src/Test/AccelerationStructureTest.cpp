@@ -0,0 +1,511 @@
+#include "BoundingBox.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "BruteForce.hpp"
+#include "KDTree.hpp"
+#include "KDTreeNode.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include "MeshGeometry.hpp"
+#include "MortonBoundingVolumeHierarchy.hpp"
+#include "SAHBoundingVolumeHierarchy.hpp"
+#include "SpatialSplitBoundingVolumeHierarchy.hpp"
+#include "Surface.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <utility>
+
+namespace AccelerationStructures {
+namespace Test {
+using Factory = std::function<std::unique_ptr<AccelerationStructure>()>;
+using UpdateType = AccelerationStructure::UpdateType;
+
+/**
+ * @brief Compares the results of an acceleration structure with BruteForce
+ *
+ * Triangles are small and scattered randomly in a cube, so that all structures
+ * have to divide them several times.
+ *
+ */
+class AccelerationStructureTest : public ::testing::TestWithParam<Factory>
+{
+protected:
+    AccelerationStructureTest()
+      : generator(795)
+    {
+        Objects::Surface::intersectionTestEpsilon = 0;
+    }
+
+    std::vector<Objects::Triangle> randomTriangles(int count)
+    {
+        std::uniform_real_distribution<FloatT> position(-10, 10);
+        std::uniform_real_distribution<FloatT> offset(-1, 1);
+        std::vector<Objects::Triangle> triangles;
+        for (int i = 0; i < count; i++) {
+            LinearAlgebra::Vec3 center{ position(generator),
+                                        position(generator),
+                                        position(generator) };
+            LinearAlgebra::Vec3 v1{ offset(generator),
+                                    offset(generator),
+                                    offset(generator) };
+            LinearAlgebra::Vec3 v2{ offset(generator),
+                                    offset(generator),
+                                    offset(generator) };
+            LinearAlgebra::Vec3 v3{ offset(generator),
+                                    offset(generator),
+                                    offset(generator) };
+            triangles.push_back({ center + v1, center + v2, center + v3 });
+        }
+        return triangles;
+    }
+
+    std::vector<Objects::Ray> randomRays(int count)
+    {
+        std::uniform_real_distribution<FloatT> position(-15, 15);
+        std::uniform_real_distribution<FloatT> direction(-1, 1);
+        std::vector<Objects::Ray> rays;
+        for (int i = 0; i < count; i++) {
+            rays.push_back({ { position(generator),
+                               position(generator),
+                               position(generator) },
+                             { direction(generator),
+                               direction(generator),
+                               direction(generator) } });
+        }
+        return rays;
+    }
+
+    /**
+     * @brief Checks that a structure finds the same hits and occlusions as
+     * BruteForce
+     *
+     * @param acc Structure built for the triangles
+     * @param triangles Triangles acc was built for
+     * @param rays Rays to trace
+     * @return int Number of rays hitting a triangle
+     */
+    static int expectSameAsBruteForce(
+      const AccelerationStructure& acc,
+      const std::vector<Objects::Triangle>& triangles,
+      const std::vector<Objects::Ray>& rays)
+    {
+        BruteForce reference;
+        reference.build(std::vector<Objects::Triangle>(triangles));
+        int hits = 0;
+        for (auto& ray : rays) {
+            LinearAlgebra::Vec3 expectedNormal, normal;
+            auto expected = reference.intersect(ray, expectedNormal);
+            auto t = acc.intersect(ray, normal);
+            if (expected == -1) {
+                EXPECT_EQ(-1, t);
+                EXPECT_FALSE(acc.occluded(
+                  ray, std::numeric_limits<FloatT>::infinity()));
+                continue;
+            }
+            hits++;
+            EXPECT_FLOAT_EQ(expected, t);
+            LinearAlgebra::Test::EXPECT_VECTOR_EQ(expectedNormal, normal);
+            EXPECT_TRUE(acc.occluded(ray, expected * 1.01));
+            EXPECT_FALSE(acc.occluded(ray, expected * 0.99));
+        }
+        return hits;
+    }
+
+    std::mt19937 generator;
+};
+
+TEST_P(AccelerationStructureTest, SameAsBruteForce)
+{
+    auto triangles = randomTriangles(2000);
+    auto acc = GetParam()();
+    acc->build(std::vector<Objects::Triangle>(triangles));
+
+    EXPECT_GT(expectSameAsBruteForce(*acc, triangles, randomRays(2000)), 100)
+      << "Rays should hit some of the triangles";
+}
+
+TEST_P(AccelerationStructureTest, OccludedSameAsBruteForce)
+{
+    auto triangles = randomTriangles(2000);
+    BruteForce reference;
+    reference.build(std::vector<Objects::Triangle>(triangles));
+    auto acc = GetParam()();
+    acc->build(std::move(triangles));
+
+    std::uniform_real_distribution<FloatT> tMaxDistribution(0, 20);
+    int occludedCount = 0, visibleCount = 0;
+    for (auto& ray : randomRays(2000)) {
+        LinearAlgebra::Vec3 normal;
+        auto t = reference.intersect(ray, normal);
+        FloatT tMax = tMaxDistribution(generator);
+        bool expected = t != -1 && t < tMax;
+        EXPECT_EQ(expected, acc->occluded(ray, tMax));
+        expected ? occludedCount++ : visibleCount++;
+    }
+    EXPECT_GT(occludedCount, 100);
+    EXPECT_GT(visibleCount, 100);
+}
+
+TEST_P(AccelerationStructureTest, SingleTriangle)
+{
+    auto acc = GetParam()();
+    acc->build({ { { -1, -1, 0 }, { 1, -1, 0 }, { 0, 1, 0 } } });
+
+    LinearAlgebra::Vec3 normal;
+    EXPECT_FLOAT_EQ(3, acc->intersect({ { 0, 0, -3 }, { 0, 0, 1 } }, normal));
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 0, 0, 1 }, normal);
+    EXPECT_EQ(-1, acc->intersect({ { 0, 0, -3 }, { 0, 0, -1 } }, normal));
+    EXPECT_TRUE(acc->occluded({ { 0, 0, -3 }, { 0, 0, 1 } }, 4));
+    EXPECT_FALSE(acc->occluded({ { 0, 0, -3 }, { 0, 0, 1 } }, 2));
+}
+
+TEST_P(AccelerationStructureTest, EmptyMesh)
+{
+    // a <Mesh> with empty <Faces> that is instanced still gets a structure
+    auto acc = GetParam()();
+    acc->build(std::vector<Objects::Triangle>());
+    acc->update(std::make_shared<const Objects::MeshGeometry>(
+      std::vector<Objects::Triangle>()));
+
+    LinearAlgebra::Vec3 normal;
+    for (auto& ray : randomRays(100)) {
+        EXPECT_EQ(-1, acc->intersect(ray, normal));
+        EXPECT_FALSE(
+          acc->occluded(ray, std::numeric_limits<FloatT>::infinity()));
+    }
+    auto stats = acc->getStats();
+    EXPECT_EQ(0, stats.triangleCount);
+    EXPECT_EQ(0, stats.triangleReferences);
+    EXPECT_EQ(1, stats.nodeCount) << "a single empty leaf";
+    EXPECT_EQ(1, stats.leafCount);
+    EXPECT_EQ(0, stats.maxDepth);
+}
+
+TEST_P(AccelerationStructureTest, LongThinTriangles)
+{
+    // slivers crossing the whole scene, like the beams of a building
+    std::uniform_real_distribution<FloatT> position(-10, 10);
+    std::uniform_real_distribution<FloatT> width(0.01, 0.1);
+    std::vector<Objects::Triangle> triangles;
+    for (int i = 0; i < 500; i++) {
+        LinearAlgebra::Vec3 start{ position(generator),
+                                   position(generator),
+                                   position(generator) };
+        LinearAlgebra::Vec3 end{ position(generator),
+                                 position(generator),
+                                 position(generator) };
+        LinearAlgebra::Vec3 offset{ width(generator), width(generator), 0 };
+        triangles.push_back({ start, end, end + offset });
+    }
+    auto acc = GetParam()();
+    acc->build(std::vector<Objects::Triangle>(triangles));
+
+    expectSameAsBruteForce(*acc, triangles, randomRays(2000));
+}
+
+TEST_P(AccelerationStructureTest, UpdateAfterMovingVertices)
+{
+    auto triangles = randomTriangles(2000);
+    auto acc = GetParam()();
+    acc->build(std::make_shared<const Objects::MeshGeometry>(triangles));
+
+    // move every triangle a little, keeping the topology
+    std::uniform_real_distribution<FloatT> offset(-0.5, 0.5);
+    std::vector<Objects::Triangle> moved;
+    for (auto& triangle : triangles) {
+        LinearAlgebra::Vec3 shift{ offset(generator),
+                                   offset(generator),
+                                   offset(generator) };
+        moved.push_back(
+          { triangle.v1 + shift, triangle.v2 + shift, triangle.v3 + shift });
+    }
+    acc->update(std::make_shared<const Objects::MeshGeometry>(moved));
+
+    expectSameAsBruteForce(*acc, moved, randomRays(2000));
+}
+
+TEST_P(AccelerationStructureTest, StatsDescribeTree)
+{
+    auto acc = GetParam()();
+    acc->build(randomTriangles(500));
+    auto stats = acc->getStats();
+
+    EXPECT_EQ(500, stats.triangleCount);
+    EXPECT_LE(stats.nodeCount, 2 * stats.leafCount - 1)
+      << "interior nodes have at least two children";
+    EXPECT_GE(stats.triangleReferences, 500);
+    EXPECT_EQ(stats.leafCount,
+              std::accumulate(
+                stats.leafSizes.begin(), stats.leafSizes.end(), std::size_t()));
+    EXPECT_LE(stats.averageDepth(), stats.maxDepth);
+    EXPECT_EQ(acc->getMemoryUsage(), stats.memoryUsage);
+    EXPECT_GT(stats.sahCost(), 0);
+    EXPECT_LE(stats.sahCost(), 500 * STATS_SAH_INTERSECTION_COST)
+      << "should be no worse than testing every triangle";
+}
+
+TEST_F(AccelerationStructureTest, BruteForceStats)
+{
+    BruteForce acc;
+    acc.build(randomTriangles(10));
+    auto stats = acc.getStats();
+
+    EXPECT_EQ(1, stats.nodeCount);
+    EXPECT_EQ(1, stats.leafCount);
+    EXPECT_EQ(0, stats.maxDepth);
+    ASSERT_EQ(5, stats.leafSizes.size());
+    EXPECT_EQ(1, stats.leafSizes[4]) << "10 is in the bucket 8-15";
+    EXPECT_DOUBLE_EQ(10 * STATS_SAH_INTERSECTION_COST, stats.sahCost());
+}
+
+TEST_F(AccelerationStructureTest, BVHRefitOrRebuild)
+{
+    auto triangles = randomTriangles(2000);
+    BoundingVolumeHierarchy bvh;
+    EXPECT_EQ(
+      UpdateType::Built,
+      bvh.update(std::make_shared<const Objects::MeshGeometry>(triangles)))
+      << "first update should build the tree";
+
+    // a small motion keeps the tree good enough to refit
+    std::vector<Objects::Triangle> moved;
+    for (auto& triangle : triangles) {
+        LinearAlgebra::Vec3 shift{ 0.1, 0, 0 };
+        moved.push_back(
+          { triangle.v1 + shift, triangle.v2 + shift, triangle.v3 + shift });
+    }
+    EXPECT_EQ(
+      UpdateType::Refit,
+      bvh.update(std::make_shared<const Objects::MeshGeometry>(moved)));
+
+    // shuffling the triangles makes the refit tree much worse
+    std::vector<int> order(moved.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), generator);
+    std::vector<Objects::Triangle> shuffled;
+    for (int i : order)
+        shuffled.push_back(moved[i]);
+    EXPECT_EQ(
+      UpdateType::Built,
+      bvh.update(std::make_shared<const Objects::MeshGeometry>(shuffled)));
+
+    // different topology can't be refit
+    shuffled.pop_back();
+    EXPECT_EQ(
+      UpdateType::Built,
+      bvh.update(std::make_shared<const Objects::MeshGeometry>(shuffled)));
+}
+
+TEST_F(AccelerationStructureTest, TreeDeeperThanTraversalStack)
+{
+    // parallel triangles at exponentially growing distances. each split of
+    // the middle-point heuristic separates only the farthest triangle, so the
+    // tree is about as deep as the number of triangles, and a ray along the
+    // x axis hits both children of every node on its way
+    std::vector<Objects::Triangle> triangles;
+    for (int i = 0; i < 96; i++) {
+        FloatT x = std::pow(FloatT(2.5), i);
+        triangles.push_back({ { x, -1, -1 }, { x, 0, 1 }, { x, 1, -1 } });
+    }
+    std::vector<Objects::Ray> rays{
+        { { 0, 0.1, 0.2 }, { 1, 0, 0 } },
+        { { 3, -0.3, 0.1 }, { 1, 0.001, 0 } },
+        { { std::ldexp(FloatT(1), 40), 0.1, -0.2 }, { 1, 0, 0 } },
+    };
+
+    for (auto [bits, width] : { std::pair(32, 2), { 8, 2 }, { 32, 4 } }) {
+        BoundingVolumeHierarchy bvh(BVH_REFIT_REBUILD_THRESHOLD, bits, width);
+        bvh.build(std::vector<Objects::Triangle>(triangles));
+        SCOPED_TRACE(testing::Message() << bits << " bits, width " << width);
+        EXPECT_EQ(rays.size(), expectSameAsBruteForce(bvh, triangles, rays));
+    }
+}
+
+TEST_F(AccelerationStructureTest, QuantizedBoxContainsOriginal)
+{
+    std::uniform_real_distribution<float> position(-3, 7);
+    for (int i = 0; i < 1000; i++) {
+        AxisAlignedBox parentBox, box;
+        parentBox.extend(
+          { position(generator), position(generator), position(generator) });
+        parentBox.extend(
+          { position(generator), position(generator), position(generator) });
+        for (int axis = 0; axis < 3; axis++) {
+            std::uniform_real_distribution<float> inside(parentBox.min[axis],
+                                                         parentBox.max[axis]);
+            box.min[axis] = inside(generator);
+            box.max[axis] = inside(generator);
+            if (box.min[axis] > box.max[axis])
+                std::swap(box.min[axis], box.max[axis]);
+        }
+        LinearBVHNode parent, node;
+        parent.setBounds(parentBox);
+        node.setBounds(box);
+
+        QuantizedBVHNode<std::uint8_t> quantized8;
+        quantized8.encode(node, parent);
+        auto decoded8 = quantized8.decode(parent).getBounds();
+        QuantizedBVHNode<std::uint16_t> quantized16;
+        quantized16.encode(node, parent);
+        auto decoded16 = quantized16.decode(parent).getBounds();
+        for (int axis = 0; axis < 3; axis++) {
+            EXPECT_LE(decoded8.min[axis], box.min[axis]);
+            EXPECT_GE(decoded8.max[axis], box.max[axis]);
+            EXPECT_LE(decoded16.min[axis], box.min[axis]);
+            EXPECT_GE(decoded16.max[axis], box.max[axis]);
+
+            // at most about one step larger on each side
+            FloatT step8 = (parentBox.max[axis] - parentBox.min[axis]) / 255;
+            FloatT step16 = step8 / 257;
+            EXPECT_LE(box.min[axis] - decoded8.min[axis], step8 + 1e-5);
+            EXPECT_LE(decoded8.max[axis] - box.max[axis], step8 + 1e-5);
+            EXPECT_LE(box.min[axis] - decoded16.min[axis], step16 + 1e-5);
+            EXPECT_LE(decoded16.max[axis] - box.max[axis], step16 + 1e-5);
+        }
+    }
+}
+
+TEST_F(AccelerationStructureTest, QuantizedNodesUseLessMemory)
+{
+    auto triangles = randomTriangles(2000);
+    auto geometry = std::make_shared<const Objects::MeshGeometry>(triangles);
+    std::size_t previousUsage = 0;
+    for (int bits : { 32, 16, 8 }) {
+        SAHBoundingVolumeHierarchy bvh(BVH_SAH_TRAVERSAL_COST,
+                                       BVH_SAH_INTERSECTION_COST,
+                                       BVH_REFIT_REBUILD_THRESHOLD,
+                                       bits);
+        bvh.build(geometry);
+        if (previousUsage) {
+            EXPECT_LT(bvh.getMemoryUsage(), previousUsage) << bits << " bits";
+        }
+        previousUsage = bvh.getMemoryUsage();
+    }
+}
+
+TEST_F(AccelerationStructureTest, WideNodesCollapseTree)
+{
+    auto triangles = randomTriangles(2000);
+    BoundingVolumeHierarchy binary;
+    binary.build(std::vector<Objects::Triangle>(triangles));
+    auto binaryStats = binary.getStats();
+    EXPECT_EQ(2 * binaryStats.leafCount - 1, binaryStats.nodeCount)
+      << "binary trees have two children per interior node";
+
+    // wider nodes absorb more of the binary interior nodes
+    std::size_t previousInteriorCount =
+      binaryStats.nodeCount - binaryStats.leafCount;
+    for (int width : { 4, 8 }) {
+        BoundingVolumeHierarchy bvh(
+          BVH_REFIT_REBUILD_THRESHOLD, BVH_FULL_NODE_BITS, width);
+        bvh.build(std::vector<Objects::Triangle>(triangles));
+        auto stats = bvh.getStats();
+
+        // collapsing keeps the leaves and removes interior nodes
+        EXPECT_EQ(binaryStats.leafCount, stats.leafCount) << width;
+        EXPECT_EQ(binaryStats.triangleReferences, stats.triangleReferences);
+        std::size_t interiorCount = stats.nodeCount - stats.leafCount;
+        EXPECT_GE(interiorCount * (width - 1), stats.leafCount - 1)
+          << "at most " << width << " children per node";
+        EXPECT_LT(interiorCount, previousInteriorCount) << width;
+        EXPECT_LT(stats.maxDepth, binaryStats.maxDepth);
+        previousInteriorCount = interiorCount;
+    }
+}
+
+TEST_F(AccelerationStructureTest, KDTreeMailboxRemembersRecentIds)
+{
+    KDTreeNode::Mailbox mailbox;
+    EXPECT_FALSE(mailbox.testedBefore(7));
+    EXPECT_TRUE(mailbox.testedBefore(7));
+    EXPECT_FALSE(mailbox.testedBefore(8));
+    EXPECT_TRUE(mailbox.testedBefore(7)) << "other slots are kept";
+
+    // an ID in the same slot replaces the older one, which is then tested
+    // again
+    EXPECT_FALSE(mailbox.testedBefore(7 + KD_MAILBOX_SIZE));
+    EXPECT_FALSE(mailbox.testedBefore(7));
+    EXPECT_FALSE(KDTreeNode::Mailbox().testedBefore(0));
+}
+
+TEST_F(AccelerationStructureTest, MortonClustersImproveTree)
+{
+    // clumps of triangles straddling the planes where the Morton order
+    // divides the grid, so that the top splits cut every clump in two
+    std::vector<Objects::Triangle> triangles;
+    std::uniform_real_distribution<FloatT> offset(-1, 1);
+    for (int clump = 0; clump < 8; clump++) {
+        LinearAlgebra::Vec3 center{ FloatT(clump % 2 ? 10 : -10),
+                                    FloatT(clump / 2 % 2 ? 10 : -10),
+                                    FloatT(clump / 4 ? 10 : -10) };
+        center[clump % 3] = 0;
+        for (int i = 0; i < 500; i++) {
+            LinearAlgebra::Vec3 position{ offset(generator),
+                                          offset(generator),
+                                          offset(generator) };
+            position = center + position * 2;
+            LinearAlgebra::Vec3 v1{ offset(generator),
+                                    offset(generator),
+                                    offset(generator) };
+            LinearAlgebra::Vec3 v2{ offset(generator),
+                                    offset(generator),
+                                    offset(generator) };
+            triangles.push_back(
+              { position, position + v1 * 0.1, position + v2 * 0.1 });
+        }
+    }
+    MortonBoundingVolumeHierarchy plain(LBVH_MORTON_BITS, 0);
+    plain.build(std::vector<Objects::Triangle>(triangles));
+    MortonBoundingVolumeHierarchy clustered;
+    clustered.build(std::vector<Objects::Triangle>(triangles));
+    auto plainStats = plain.getStats();
+    auto clusteredStats = clustered.getStats();
+
+    EXPECT_EQ(4000, plainStats.triangleReferences);
+    EXPECT_EQ(4000, clusteredStats.triangleReferences);
+    EXPECT_EQ(2 * clusteredStats.leafCount - 1, clusteredStats.nodeCount);
+    EXPECT_LT(clusteredStats.sahCost(), plainStats.sahCost())
+      << "merging the clusters by area should keep the clumps together";
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  AllStructures,
+  AccelerationStructureTest,
+  ::testing::Values(
+    [] { return std::make_unique<BoundingBox>(); },
+    [] { return std::make_unique<BoundingVolumeHierarchy>(); },
+    [] { return std::make_unique<SAHBoundingVolumeHierarchy>(); },
+    [] { return std::make_unique<SpatialSplitBoundingVolumeHierarchy>(); },
+    [] {
+        return std::make_unique<BoundingVolumeHierarchy>(
+          BVH_REFIT_REBUILD_THRESHOLD, 16);
+    },
+    [] {
+        return std::make_unique<SAHBoundingVolumeHierarchy>(
+          BVH_SAH_TRAVERSAL_COST,
+          BVH_SAH_INTERSECTION_COST,
+          BVH_REFIT_REBUILD_THRESHOLD,
+          8);
+    },
+    [] {
+        return std::make_unique<BoundingVolumeHierarchy>(
+          BVH_REFIT_REBUILD_THRESHOLD, BVH_FULL_NODE_BITS, 4);
+    },
+    [] {
+        return std::make_unique<SpatialSplitBoundingVolumeHierarchy>(
+          SBVH_DUPLICATION_BUDGET,
+          BVH_SAH_TRAVERSAL_COST,
+          BVH_SAH_INTERSECTION_COST,
+          BVH_REFIT_REBUILD_THRESHOLD,
+          BVH_FULL_NODE_BITS,
+          8);
+    },
+    [] { return std::make_unique<MortonBoundingVolumeHierarchy>(); },
+    [] { return std::make_unique<MortonBoundingVolumeHierarchy>(63, 0); },
+    [] { return std::make_unique<KDTree>(); }));
+}
+}
@@ -86,5 +86,19 @@ TEST(MatrixTest, Transpose)
     EXPECT_EQ(col2, trans.col2);
     EXPECT_EQ(col3, trans.col3);
 }
+
+TEST(MatrixTest, Inverse)
+{
+    Mat3 mat{ { 1, 8, 4 }, { -4, 5.72, 6 }, { 7, 8, 9 } };
+    auto inverse = mat.inverse();
+    auto identity = mat * inverse;
+    Mat3 expected;
+    for (int axis = 0; axis < 3; axis++) {
+        EXPECT_NEAR(expected.col1[axis], identity.col1[axis], 1e-5);
+        EXPECT_NEAR(expected.col2[axis], identity.col2[axis], 1e-5);
+        EXPECT_NEAR(expected.col3[axis], identity.col3[axis], 1e-5);
+    }
+    EXPECT_FLOAT_EQ(1 / mat.determinant(), inverse.determinant());
+}
 }
 }
\ No newline at end of file
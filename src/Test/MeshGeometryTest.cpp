@@ -0,0 +1,43 @@
+#include "MeshGeometry.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include <gtest/gtest.h>
+
+namespace Objects {
+namespace Test {
+TEST(MeshGeometryTest, SharedVertexPool)
+{
+    auto vertices = std::make_shared<const std::vector<LinearAlgebra::Vec3>>(
+      std::vector<LinearAlgebra::Vec3>{
+        { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } });
+    MeshGeometry first(vertices, { 0, 1, 2 });
+    MeshGeometry second(vertices, { 1, 3, 2, 2, 0, 1 });
+
+    EXPECT_EQ(first.getVertices(), second.getVertices())
+      << "vertices should not be copied";
+    EXPECT_EQ(1, first.getTriangleCount());
+    EXPECT_EQ(2, second.getTriangleCount());
+    EXPECT_EQ(2 * 3 * sizeof(std::uint32_t), second.getIndexMemoryUsage());
+
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 1, 1, 0 }, second.getVertex(0, 1));
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 0, 1, 0 }, second.getVertex(1, 0));
+}
+
+TEST(MeshGeometryTest, SameAsTriangles)
+{
+    std::vector<Triangle> triangles{
+        { { 5, 0, 3 }, { 1, 0, -4 }, { -10, 0, -1 } },
+        { { 4, 1, -1 }, { 4, 1, 1 }, { 4, 0, 1 } },
+    };
+    MeshGeometry geometry(triangles);
+
+    ASSERT_EQ(2, geometry.getTriangleCount());
+    for (std::uint32_t i = 0; i < 2; i++) {
+        auto triangle = geometry.getTriangle(i);
+        LinearAlgebra::Test::EXPECT_VECTOR_EQ(triangles[i].v1, triangle.v1);
+        LinearAlgebra::Test::EXPECT_VECTOR_EQ(triangles[i].v2, triangle.v2);
+        LinearAlgebra::Test::EXPECT_VECTOR_EQ(triangles[i].v3, triangle.v3);
+        EXPECT_EQ(triangles[i].getNormal(), geometry.getNormal(i));
+    }
+}
+}
+}
@@ -0,0 +1,110 @@
+#include "MeshInstance.hpp"
+#include "BruteForce.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+
+namespace Objects {
+namespace Test {
+/**
+ * @brief Compares instances with meshes made of transformed triangles
+ *
+ */
+class MeshInstanceTest : public ::testing::Test
+{
+protected:
+    MeshInstanceTest()
+    {
+        Surface::intersectionTestEpsilon = 0;
+        base = createMesh(LinearAlgebra::Transform());
+    }
+
+    /**
+     * @brief Creates a mesh with two triangles, transformed by the given
+     * transformation
+     *
+     */
+    std::shared_ptr<Mesh> createMesh(const LinearAlgebra::Transform& transform)
+    {
+        std::vector<LinearAlgebra::Vec3> vertices{
+            { -1, -1, 0 }, { 1, -1, 0 }, { 0, 1, 0 },
+            { -1, 0, 1 },  { 1, 0, 1 },  { 0, 1, -1 }
+        };
+        for (auto& vertex : vertices)
+            vertex = transform.transformPoint(vertex);
+        return std::make_shared<Mesh>(
+          vertices,
+          std::vector<int>{ 0, 1, 2, 3, 4, 5 },
+          Material(),
+          std::make_unique<AccelerationStructures::BruteForce>());
+    }
+
+    std::shared_ptr<Mesh> base;
+};
+
+TEST_F(MeshInstanceTest, Translated)
+{
+    MeshInstance instance(
+      base, LinearAlgebra::Transform::translate({ 0, 0, -5 }), Material());
+    LinearAlgebra::Vec3 normal;
+    auto t = instance.intersect(Ray({ 0, -0.5, 5 }, { 0, 0, -2 }), normal);
+    EXPECT_FLOAT_EQ(5, t);
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 0, 0, 1 }, normal);
+
+    EXPECT_TRUE(instance.occluded(Ray({ 0, -0.5, 5 }, { 0, 0, -2 }), 6));
+    EXPECT_FALSE(instance.occluded(Ray({ 0, -0.5, 5 }, { 0, 0, -2 }), 4));
+    EXPECT_EQ(-1, instance.intersect(Ray({ 0, -0.5, 5 }, { 0, 0, 1 }), normal));
+}
+
+TEST_F(MeshInstanceTest, SameAsTransformedMesh)
+{
+    auto transform = LinearAlgebra::Transform::translate({ 3, -1, 2 }) *
+                     LinearAlgebra::Transform::rotate(40, { 1, 2, 3 }) *
+                     LinearAlgebra::Transform::scale({ 2, 0.5, 3 });
+    MeshInstance instance(base, transform, Material());
+    auto transformed = createMesh(transform);
+
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<FloatT> position(-5, 5);
+    int hits = 0;
+    for (int i = 0; i < 1000; i++) {
+        LinearAlgebra::Vec3 origin{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+        LinearAlgebra::Vec3 target{ position(generator) / 2 + 3,
+                                    position(generator) / 2 - 1,
+                                    position(generator) / 2 + 2 };
+        Ray ray(origin, target - origin);
+        LinearAlgebra::Vec3 expectedNormal, normal;
+        auto expected = transformed->intersect(ray, expectedNormal);
+        auto t = instance.intersect(ray, normal);
+        ASSERT_EQ(expected == -1, t == -1);
+        if (t == -1)
+            continue;
+        hits++;
+        EXPECT_NEAR(expected, t, 1e-4);
+        for (int axis = 0; axis < 3; axis++)
+            EXPECT_NEAR(expectedNormal[axis], normal[axis], 1e-4);
+    }
+    EXPECT_GT(hits, 100) << "Rays should hit the mesh";
+
+    LinearAlgebra::Vec3 expectedMin, expectedMax, min, max;
+    transformed->getBounds(expectedMin, expectedMax);
+    instance.getBounds(min, max);
+    for (int axis = 0; axis < 3; axis++) {
+        // bounds of the transformed box of the base mesh contain the mesh
+        EXPECT_LE(min[axis], expectedMin[axis] + 1e-5);
+        EXPECT_GE(max[axis], expectedMax[axis] - 1e-5);
+    }
+}
+
+TEST_F(MeshInstanceTest, SharesBase)
+{
+    Material material({ 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 }, 2);
+    MeshInstance instance(base, LinearAlgebra::Transform(), material);
+    EXPECT_EQ(base.get(), &instance.getBase());
+    EXPECT_EQ(material.diffuse, instance.material.diffuse);
+}
+}
+}
@@ -1,4 +1,5 @@
 #include "../LinearAlgebraTestCommon.hpp"
+#include "MeshInstance.hpp"
 #include "XMLParser.hpp"
 #include "XMLParserMock.hpp"
 #include <fstream>
@@ -44,6 +45,72 @@ TEST(XMLParserTest, Simple)
     }
 }
 
+TEST(XMLParserTest, MeshInstances)
+{
+    XMLParser parser;
+    ASSERT_TRUE(parser.parse("Scenes/InstanceScene.xml"));
+    auto scene = parser.getScene();
+    ASSERT_EQ(3, scene->surfaces.size());
+
+    auto mesh = dynamic_cast<Objects::Mesh*>(scene->surfaces[0].get());
+    auto moved = dynamic_cast<Objects::MeshInstance*>(scene->surfaces[1].get());
+    auto rotated =
+      dynamic_cast<Objects::MeshInstance*>(scene->surfaces[2].get());
+    ASSERT_TRUE(mesh && moved && rotated);
+    EXPECT_EQ(mesh, &moved->getBase());
+    EXPECT_EQ(mesh, &rotated->getBase());
+    EXPECT_TRUE(mesh->hasAccelerationStructure())
+      << "instances are tested through the structure of their base";
+
+    // material of the base mesh unless one is given
+    EXPECT_EQ(LinearAlgebra::Vec3(4, 5, 6), moved->material.diffuse);
+    EXPECT_EQ(LinearAlgebra::Vec3(6, 5, 4), rotated->material.diffuse);
+
+    LinearAlgebra::Vec3 min, max;
+    moved->getBounds(min, max);
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ -0.5, -0.5, -5 }, min);
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 0.5, 0.5, -5 }, max);
+
+    // scaled to (-1, -1, -4) - (1, 1, -4), moved to z = -7 and rotated
+    // around z, which keeps the box the same
+    rotated->getBounds(min, max);
+    for (int axis = 0; axis < 3; axis++) {
+        EXPECT_NEAR(axis == 2 ? -7 : -1, min[axis], 1e-5);
+        EXPECT_NEAR(axis == 2 ? -7 : 1, max[axis], 1e-5);
+    }
+}
+
+TEST(XMLParserTest, LooseTrianglesMergedByMaterial)
+{
+    XMLParser parser;
+    ASSERT_TRUE(parser.parse("Scenes/LooseTriangleScene.xml"));
+    auto scene = parser.getScene();
+
+    // the sphere, then a mesh for each material of the triangles
+    ASSERT_EQ(3, scene->surfaces.size());
+    EXPECT_FALSE(dynamic_cast<Objects::Mesh*>(scene->surfaces[0].get()));
+    auto first = dynamic_cast<Objects::Mesh*>(scene->surfaces[1].get());
+    auto second = dynamic_cast<Objects::Mesh*>(scene->surfaces[2].get());
+    ASSERT_TRUE(first && second);
+    EXPECT_EQ(2, first->getGeometry().getTriangleCount());
+    EXPECT_EQ(LinearAlgebra::Vec3(4, 5, 6), first->material.diffuse);
+    EXPECT_EQ(1, second->getGeometry().getTriangleCount());
+    EXPECT_EQ(LinearAlgebra::Vec3(6, 5, 4), second->material.diffuse);
+    EXPECT_FALSE(first->hasAccelerationStructure())
+      << "small meshes are tested by the scene's hierarchy";
+
+    // both triangles of the first material form the square
+    LinearAlgebra::Vec3 min, max;
+    first->getBounds(min, max);
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ -0.5, -0.5, -2 }, min);
+    LinearAlgebra::Test::EXPECT_VECTOR_EQ({ 0.5, 0.5, -2 }, max);
+    LinearAlgebra::Vec3 normal;
+    EXPECT_FLOAT_EQ(
+      2, first->intersect({ { 0.25, 0.25, 0 }, { 0, 0, -1 } }, normal));
+    EXPECT_FLOAT_EQ(
+      2, first->intersect({ { -0.25, -0.25, 0 }, { 0, 0, -1 } }, normal));
+}
+
 class XMLParserUnitTest
   : public ::testing::Test
   , public XMLParser
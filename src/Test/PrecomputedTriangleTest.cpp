@@ -0,0 +1,78 @@
+#include "PrecomputedTriangle.hpp"
+#include "Surface.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace AccelerationStructures {
+namespace Test {
+
+TEST(PrecomputedTriangleTest, Intersection)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    PrecomputedTriangle tri({ { 4, 1, -1 }, { 4, 1, 1 }, { 4, -1, 0 } });
+    Objects::Ray ray({ 2, -1, -3 }, { 1, 0.5, 1.5 });
+
+    EXPECT_FLOAT_EQ(2, tri.intersect(ray));
+}
+
+TEST(PrecomputedTriangleTest, BehindRay)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    PrecomputedTriangle tri({ { 4, 1, -1 }, { 4, 1, 1 }, { 4, 0, 1 } });
+    Objects::Ray ray({ 2, -1, -3 }, LinearAlgebra::Vec3(1, 0.5, 1.5) * -1.0);
+
+    EXPECT_EQ(-1, tri.intersect(ray));
+}
+
+TEST(PrecomputedTriangleTest, Parallel)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    PrecomputedTriangle tri({ { -1, -1, 0 }, { 1, -1, 0 }, { 0, 1, 0 } });
+    Objects::Ray ray({ -5, 0, 0 }, { 1, 0, 0 });
+
+    EXPECT_EQ(-1, tri.intersect(ray));
+}
+
+TEST(PrecomputedTriangleTest, IntersectionTestEpsilon)
+{
+    PrecomputedTriangle tri({ { -1, -1, 0 }, { 1, -1, 0 }, { 0, 1, 0 } });
+    Objects::Ray ray({ 0, -1.1, -5 }, { 0, 0, 1 });
+
+    Objects::Surface::intersectionTestEpsilon = 0;
+    EXPECT_EQ(-1, tri.intersect(ray));
+
+    Objects::Surface::intersectionTestEpsilon = 1.3;
+    EXPECT_FLOAT_EQ(5, tri.intersect(ray));
+}
+
+TEST(PrecomputedTriangleTest, SameAsTriangle)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    std::mt19937 generator(2021);
+    std::uniform_real_distribution<FloatT> position(-1, 1);
+    auto randomVector = [&] {
+        return LinearAlgebra::Vec3{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+    };
+
+    // results may only differ for rays that pass very close to an edge
+    int mismatches = 0;
+    for (int i = 0; i < 10000; i++) {
+        Objects::Triangle triangle(
+          randomVector(), randomVector(), randomVector());
+        PrecomputedTriangle precomputed(triangle);
+        Objects::Ray ray(randomVector() * 3, randomVector());
+
+        auto expected = triangle.intersect(ray);
+        auto t = precomputed.intersect(ray);
+        if ((expected == -1) != (t == -1)) {
+            mismatches++;
+        } else if (t != -1) {
+            EXPECT_NEAR(expected, t, 1e-3 * expected);
+        }
+    }
+    EXPECT_LE(mismatches, 5);
+}
+}
+}
@@ -27,6 +27,16 @@ TEST(SphereTest, Intersection1)
     LinearAlgebra::Test::EXPECT_VECTOR_EQ({ -.6, .8, 0 }, normal);
 }
 
+TEST(SphereTest, Occluded)
+{
+    Sphere sphere({ 2, 0, 0 }, 5, Material());
+    Ray ray({ -3, 4, 0 }, { 1, 0, 0 }); // hits at t = 2
+    EXPECT_TRUE(sphere.occluded(ray, 3));
+    EXPECT_FALSE(sphere.occluded(ray, 2));
+    EXPECT_FALSE(sphere.occluded(ray, 1));
+    EXPECT_FALSE(sphere.occluded({ { -3, 4, 0 }, { -1, 0, 0 } }, 100));
+}
+
 TEST(SphereTest, BehindRay)
 {
     Sphere sphere({ 2, 2, 2 }, 3, Material());
@@ -0,0 +1,210 @@
+#include "AccelerationStructureConstants.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include "Mesh.hpp"
+#include "Sphere.hpp"
+#include "SurfaceBoundingVolumeHierarchy.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+
+namespace AccelerationStructures {
+namespace Test {
+/**
+ * @brief Compares the hierarchy with testing all surfaces one by one
+ *
+ */
+class SurfaceBoundingVolumeHierarchyTest : public ::testing::Test
+{
+protected:
+    SurfaceBoundingVolumeHierarchyTest()
+      : generator(1234)
+    {
+        Objects::Surface::intersectionTestEpsilon = 0;
+    }
+
+    /**
+     * @brief Closest surface found by testing every surface
+     *
+     */
+    FloatT linearSearch(const Objects::Ray& ray,
+                        LinearAlgebra::Vec3& normalOut,
+                        Objects::Surface*& surfaceOut,
+                        FloatT maxT = std::numeric_limits<FloatT>::infinity())
+    {
+        FloatT minT = maxT;
+        surfaceOut = nullptr;
+        for (auto& surface : surfaces) {
+            LinearAlgebra::Vec3 normal;
+            FloatT t = surface->intersect(ray, normal);
+            if (t != -1 && t < minT) {
+                minT = t;
+                normalOut = normal;
+                surfaceOut = surface.get();
+            }
+        }
+        return surfaceOut ? minT : -1;
+    }
+
+    /**
+     * @brief Compares the hierarchy built over surfaces with linearSearch()
+     * for random rays
+     *
+     * @param tolerance Allowed difference of t values, relative to t. 0
+     * requires them to be equal.
+     * @return int Number of rays that hit a surface
+     */
+    int expectSameAsLinearSearch(FloatT tolerance = 0)
+    {
+        SurfaceBoundingVolumeHierarchy hierarchy;
+        hierarchy.build(surfaces);
+
+        std::uniform_real_distribution<FloatT> position(-10, 10);
+        std::uniform_real_distribution<FloatT> direction(-1, 1);
+        int hits = 0;
+        for (int i = 0; i < 2000; i++) {
+            Objects::Ray ray({ position(generator),
+                               position(generator),
+                               position(generator) },
+                             { direction(generator),
+                               direction(generator),
+                               direction(generator) });
+            // also test shadow rays, which ignore intersections after t = 1
+            FloatT infinity = std::numeric_limits<FloatT>::infinity();
+            for (FloatT maxT : { infinity, FloatT(1) }) {
+                LinearAlgebra::Vec3 expectedNormal, normal;
+                Objects::Surface *expectedSurface, *surface = nullptr;
+                auto expected =
+                  linearSearch(ray, expectedNormal, expectedSurface, maxT);
+                auto t = hierarchy.intersect(ray, normal, surface, maxT);
+                EXPECT_EQ(expected != -1, hierarchy.occluded(ray, maxT));
+                if (expected == -1) {
+                    EXPECT_EQ(-1, t);
+                    continue;
+                }
+                hits++;
+                if (tolerance) {
+                    EXPECT_NEAR(expected, t, tolerance * expected);
+                } else {
+                    EXPECT_EQ(expected, t);
+                }
+                EXPECT_EQ(expectedSurface, surface);
+                LinearAlgebra::Test::EXPECT_VECTOR_EQ(expectedNormal, normal);
+            }
+        }
+        return hits;
+    }
+
+    /**
+     * @brief Adds a mesh of random triangles near a random point
+     *
+     * @param triangleCount
+     * @param withStructure Give the mesh a BVH, otherwise it has no
+     * acceleration structure
+     */
+    void addMesh(int triangleCount, bool withStructure = true)
+    {
+        std::uniform_real_distribution<FloatT> position(-10, 10);
+        std::uniform_real_distribution<FloatT> offset(-2, 2);
+        LinearAlgebra::Vec3 center{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+        std::vector<LinearAlgebra::Vec3> vertices;
+        std::vector<int> indices;
+        for (int i = 0; i < 3 * triangleCount; i++) {
+            LinearAlgebra::Vec3 vertexOffset{ offset(generator),
+                                              offset(generator),
+                                              offset(generator) };
+            vertices.push_back(center + vertexOffset);
+            indices.push_back(i);
+        }
+        surfaces.push_back(std::make_shared<Objects::Mesh>(
+          vertices,
+          indices,
+          Objects::Material(),
+          withStructure ? std::make_unique<BoundingVolumeHierarchy>()
+                        : nullptr));
+    }
+
+    std::vector<std::shared_ptr<Objects::Surface>> surfaces;
+    std::mt19937 generator;
+};
+
+TEST_F(SurfaceBoundingVolumeHierarchyTest, SameAsLinearSearch)
+{
+    std::uniform_real_distribution<FloatT> position(-10, 10);
+    std::uniform_real_distribution<FloatT> radius(0.1, 2);
+    Objects::Material material;
+
+    for (int i = 0; i < 200; i++) {
+        LinearAlgebra::Vec3 center{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+        surfaces.push_back(std::make_shared<Objects::Sphere>(
+          center, radius(generator), material));
+    }
+    for (int i = 0; i < 20; i++) {
+        std::vector<LinearAlgebra::Vec3> vertices;
+        for (int j = 0; j < 3; j++)
+            vertices.push_back({ position(generator),
+                                 position(generator),
+                                 position(generator) });
+        surfaces.push_back(std::make_shared<Objects::Mesh>(
+          vertices,
+          std::vector<int>{ 0, 1, 2 },
+          material,
+          std::make_unique<BoundingVolumeHierarchy>()));
+    }
+
+    int hits = expectSameAsLinearSearch();
+    EXPECT_GT(hits, 100) << "Rays should hit some of the surfaces";
+}
+
+TEST_F(SurfaceBoundingVolumeHierarchyTest, SmallAndLargeMeshes)
+{
+    // small meshes are put in the hierarchy triangle by triangle, large ones
+    // are tested through their own acceleration structures
+    std::uniform_real_distribution<FloatT> position(-10, 10);
+    Objects::Material material;
+    for (int i = 0; i < 50; i++) {
+        LinearAlgebra::Vec3 center{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+        surfaces.push_back(
+          std::make_shared<Objects::Sphere>(center, 0.5, material));
+        if (i % 5 == 0)
+            addMesh(1 + i / 5);
+    }
+    addMesh(SURFACE_BVH_MAX_INLINE_TRIANGLES);
+    addMesh(SURFACE_BVH_MAX_INLINE_TRIANGLES + 1);
+    addMesh(100);
+
+    EXPECT_GT(expectSameAsLinearSearch(), 100)
+      << "Rays should hit some of the surfaces";
+}
+
+TEST_F(SurfaceBoundingVolumeHierarchyTest, MeshesWithoutStructure)
+{
+    // the hierarchy tests their triangles, and they test every triangle when
+    // intersected on their own in linearSearch(). the two use different
+    // triangle tests
+    for (int i = 0; i < 20; i++)
+        addMesh(1 + i % SURFACE_BVH_MAX_INLINE_TRIANGLES, false);
+    addMesh(2 * SURFACE_BVH_MAX_INLINE_TRIANGLES, false);
+
+    EXPECT_GT(expectSameAsLinearSearch(1e-4), 100)
+      << "Rays should hit some of the surfaces";
+}
+
+TEST_F(SurfaceBoundingVolumeHierarchyTest, Empty)
+{
+    SurfaceBoundingVolumeHierarchy hierarchy;
+    hierarchy.build(surfaces);
+
+    LinearAlgebra::Vec3 normal;
+    Objects::Surface* surface;
+    EXPECT_EQ(
+      -1, hierarchy.intersect({ { 0, 0, 0 }, { 0, 0, 1 } }, normal, surface));
+}
+}
+}
@@ -0,0 +1,52 @@
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace AccelerationStructures {
+namespace Test {
+TEST(ThreadPoolTest, ThreadCount)
+{
+    ThreadPool pool(3);
+    EXPECT_EQ(3, pool.getThreadCount());
+}
+
+TEST(ThreadPoolTest, ParallelForCoversRange)
+{
+    ThreadPool pool(4);
+    std::vector<int> visits(1000);
+    std::vector<int> chunkSizes(7);
+    pool.parallelFor(
+      0, visits.size(), 7, [&](int chunk, int chunkBegin, int chunkEnd) {
+          chunkSizes[chunk] = chunkEnd - chunkBegin;
+          for (int i = chunkBegin; i < chunkEnd; i++)
+              visits[i]++;
+      });
+    for (int count : visits)
+        EXPECT_EQ(1, count);
+    for (int size : chunkSizes)
+        EXPECT_NEAR(1000 / 7, size, 1);
+}
+
+TEST(ThreadPoolTest, NestedTasks)
+{
+    // tasks that wait for their own tasks shouldn't deadlock, even on a
+    // single thread
+    for (int threadCount : { 1, 2, 4 }) {
+        ThreadPool pool(threadCount);
+        std::atomic<int> leaves = 0;
+        std::function<void(int)> spawn = [&](int depth) {
+            if (depth == 0) {
+                leaves++;
+                return;
+            }
+            auto future = pool.submit([&, depth] { spawn(depth - 1); });
+            spawn(depth - 1);
+            pool.wait(future);
+        };
+        spawn(8);
+        EXPECT_EQ(256, leaves);
+    }
+}
+}
+}
@@ -0,0 +1,60 @@
+#include "Transform.hpp"
+#include "LinearAlgebraTestCommon.hpp"
+#include <gtest/gtest.h>
+
+namespace LinearAlgebra {
+namespace Test {
+TEST(TransformTest, Identity)
+{
+    Transform transform;
+    Vec3 point{ 1, -2, 3.5 };
+    EXPECT_EQ(point, transform.transformPoint(point));
+    EXPECT_EQ(point, transform.transformVector(point));
+}
+
+TEST(TransformTest, Translate)
+{
+    auto transform = Transform::translate({ 1, 2, 3 });
+    EXPECT_VECTOR_EQ({ 2, 3, 4 }, transform.transformPoint({ 1, 1, 1 }));
+    // directions are not moved
+    EXPECT_VECTOR_EQ({ 1, 1, 1 }, transform.transformVector({ 1, 1, 1 }));
+}
+
+TEST(TransformTest, Scale)
+{
+    auto transform = Transform::scale({ 2, 3, -1 });
+    EXPECT_VECTOR_EQ({ 2, 6, -3 }, transform.transformPoint({ 1, 2, 3 }));
+}
+
+TEST(TransformTest, Rotate)
+{
+    // counterclockwise when looking from the tip of the axis
+    auto transform = Transform::rotate(90, { 0, 0, 2 });
+    auto point = transform.transformPoint({ 1, 0, 5 });
+    EXPECT_NEAR(0, point.x, 1e-6);
+    EXPECT_FLOAT_EQ(1, point.y);
+    EXPECT_FLOAT_EQ(5, point.z);
+}
+
+TEST(TransformTest, Composition)
+{
+    auto translate = Transform::translate({ 1, 0, 0 });
+    auto scale = Transform::scale({ 2, 2, 2 });
+    // translates first, then scales
+    auto transform = scale * translate;
+    EXPECT_VECTOR_EQ({ 4, 2, 2 }, transform.transformPoint({ 1, 1, 1 }));
+}
+
+TEST(TransformTest, Inverse)
+{
+    auto transform = Transform::translate({ 1, -2, 3 }) *
+                     Transform::rotate(30, { 1, 1, 0 }) *
+                     Transform::scale({ 2, 0.5, 4 });
+    auto inverse = transform.inverse();
+    Vec3 point{ 4, 5, -6 };
+    auto result = inverse.transformPoint(transform.transformPoint(point));
+    for (int axis = 0; axis < 3; axis++)
+        EXPECT_NEAR(point[axis], result[axis], 1e-5);
+}
+}
+}
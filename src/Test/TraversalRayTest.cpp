@@ -0,0 +1,80 @@
+#include "TraversalRay.hpp"
+#include <gtest/gtest.h>
+
+namespace AccelerationStructures {
+namespace Test {
+/**
+ * @brief Box tests against the unit cube
+ *
+ */
+FloatT
+intersectUnitCube(const Objects::Ray& ray,
+                  FloatT tLimit = std::numeric_limits<FloatT>::infinity())
+{
+    return TraversalRay(ray).intersectBox(0, 1, 0, 1, 0, 1, tLimit);
+}
+
+TEST(TraversalRayTest, SignsOfDirection)
+{
+    Objects::Ray ray({ 0, 0, 0 }, { 2, -0.0, -4 });
+    TraversalRay traversalRay(ray);
+    EXPECT_FALSE(traversalRay.negative[0]);
+    EXPECT_TRUE(traversalRay.negative[1]) << "-0 should count as negative";
+    EXPECT_TRUE(traversalRay.negative[2]);
+    EXPECT_EQ(0.5, traversalRay.inverseDirection.x);
+    EXPECT_EQ(-std::numeric_limits<FloatT>::infinity(),
+              traversalRay.inverseDirection.y);
+    EXPECT_EQ(-0.25, traversalRay.inverseDirection.z);
+}
+
+TEST(TraversalRayTest, HitsFromBothSides)
+{
+    EXPECT_EQ(5, intersectUnitCube({ { -5, 0.5, 0.5 }, { 1, 0, 0 } }));
+    EXPECT_EQ(4, intersectUnitCube({ { 5, 0.5, 0.5 }, { -1, 0, 0 } }));
+    EXPECT_EQ(2, intersectUnitCube({ { 0.5, 0.5, 3 }, { 0, 0, -1 } }));
+    EXPECT_EQ(0, intersectUnitCube({ { 0.5, 0.5, 0.5 }, { 1, 1, 1 } }))
+      << "origin is inside the box";
+    EXPECT_EQ(-1, intersectUnitCube({ { 5, 0.5, 0.5 }, { 1, 0, 0 } }))
+      << "box is behind the ray";
+    EXPECT_EQ(-1, intersectUnitCube({ { -5, 0.5, 0.5 }, { 1, 1, 0 } }));
+}
+
+TEST(TraversalRayTest, ZeroDirection)
+{
+    for (FloatT zero : { 0.0, -0.0 }) {
+        EXPECT_EQ(5, intersectUnitCube({ { -5, 0.5, 0.5 }, { 1, zero, 0 } }));
+        EXPECT_EQ(-1, intersectUnitCube({ { -5, 2, 0.5 }, { 1, zero, 0 } }));
+        EXPECT_EQ(-1, intersectUnitCube({ { -5, -2, 0.5 }, { 1, zero, 0 } }));
+        EXPECT_EQ(-1,
+                  intersectUnitCube({ { 0.5, 0.5, 2 }, { zero, zero, 1 } }));
+        EXPECT_EQ(0, intersectUnitCube({ { 0.5, 0.5, 0.5 }, { zero, 0, 1 } }));
+
+        // the ray slides along a face of the box
+        EXPECT_EQ(5, intersectUnitCube({ { -5, 1, 0.5 }, { 1, zero, 0 } }));
+        EXPECT_EQ(5, intersectUnitCube({ { -5, 0, 0 }, { 1, zero, zero } }));
+    }
+}
+
+TEST(TraversalRayTest, LimitsEntryPoint)
+{
+    Objects::Ray ray({ -5, 0.5, 0.5 }, { 1, 0, 0 });
+    EXPECT_EQ(-1, intersectUnitCube(ray, 5));
+    EXPECT_EQ(5, intersectUnitCube(ray, 5.5));
+}
+
+TEST(TraversalRayTest, ClipBox)
+{
+    Objects::Ray ray({ -5, 0.5, 0.25 }, { 2, 0, -1 });
+    FloatT tEnter, tExit;
+    TraversalRay(ray).clipBox(0, 1, 0, 1, 0, 1, tEnter, tExit);
+    EXPECT_FLOAT_EQ(2.5, tEnter);
+    EXPECT_FLOAT_EQ(0.25, tExit);
+    EXPECT_LT(tExit, tEnter) << "line misses the box";
+
+    ray.direction = { 1, 0, 0 };
+    TraversalRay(ray).clipBox(0, 1, 0, 1, 0, 1, tEnter, tExit);
+    EXPECT_EQ(5, tEnter);
+    EXPECT_LE(6, tExit) << "exit point should never move inwards";
+}
+}
+}
@@ -0,0 +1,81 @@
+#include "TriangleBlock.hpp"
+#include "Surface.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace AccelerationStructures {
+namespace Test {
+
+TEST(TriangleBlockTest, EmptyBlock)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    TriangleBlock block;
+    Objects::Ray ray({ 0, 0, -1 }, { 0, 0, 1 });
+
+    FloatT t = std::numeric_limits<FloatT>::infinity();
+    EXPECT_EQ(-1, block.intersect(ray, t));
+    EXPECT_FALSE(block.occluded(ray, 10));
+}
+
+TEST(TriangleBlockTest, ClosestLane)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    TriangleBlock block;
+    // parallel triangles at z = 3 and z = 2, the last lane is closer
+    block.set(0, Objects::Triangle({ -1, -1, 3 }, { 1, -1, 3 }, { 0, 1, 3 }));
+    block.set(TriangleBlock::width - 1,
+              Objects::Triangle({ -1, -1, 2 }, { 1, -1, 2 }, { 0, 1, 2 }));
+    Objects::Ray ray({ 0, 0, -1 }, { 0, 0, 1 });
+
+    FloatT t = std::numeric_limits<FloatT>::infinity();
+    EXPECT_EQ(TriangleBlock::width - 1, block.intersect(ray, t));
+    EXPECT_FLOAT_EQ(3, t);
+
+    t = 2;
+    EXPECT_EQ(-1, block.intersect(ray, t)) << "hits after t should be ignored";
+    EXPECT_TRUE(block.occluded(ray, 3.5));
+    EXPECT_FALSE(block.occluded(ray, 3));
+}
+
+TEST(TriangleBlockTest, SameAsPrecomputedTriangle)
+{
+    Objects::Surface::intersectionTestEpsilon = 0;
+    std::mt19937 generator(2021);
+    std::uniform_real_distribution<FloatT> position(-1, 1);
+    auto randomVector = [&] {
+        return LinearAlgebra::Vec3{ position(generator),
+                                    position(generator),
+                                    position(generator) };
+    };
+
+    for (int i = 0; i < 1000; i++) {
+        TriangleBlock block;
+        std::vector<PrecomputedTriangle> triangles;
+        for (int lane = 0; lane < TriangleBlock::width; lane++) {
+            triangles.push_back(Objects::Triangle(
+              randomVector(), randomVector(), randomVector()));
+            block.set(lane, triangles.back());
+        }
+        Objects::Ray ray(randomVector() * 3, randomVector());
+
+        int expectedLane = -1;
+        FloatT expectedT = std::numeric_limits<FloatT>::infinity();
+        for (int lane = 0; lane < TriangleBlock::width; lane++) {
+            FloatT t = triangles[lane].intersect(ray);
+            if (t != -1 && t < expectedT) {
+                expectedT = t;
+                expectedLane = lane;
+            }
+        }
+
+        FloatT t = std::numeric_limits<FloatT>::infinity();
+        ASSERT_EQ(expectedLane, block.intersect(ray, t));
+        if (expectedLane != -1) {
+            EXPECT_EQ(expectedT, t);
+        }
+    }
+}
+}
+}
@@ -197,5 +197,16 @@ TEST(VectorTest, ComponentMultiplication)
     EXPECT_EQ(-17.5, result.y);
     EXPECT_EQ(-20, result.z);
 }
+
+TEST(VectorTest, AxisIndex)
+{
+    Vec3 vec{ 3, -2.5, 4 };
+    EXPECT_EQ(3, vec[0]);
+    EXPECT_EQ(-2.5, vec[1]);
+    EXPECT_EQ(4, vec[2]);
+
+    vec[1] = 7;
+    EXPECT_EQ(7, vec.y);
+}
 }
 }
\ No newline at end of file
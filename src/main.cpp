@@ -1,6 +1,7 @@
 #include "Config.hpp"
 #include "GlobalOptions.hpp"
 #include "PathTracer.hpp"
+#include "ThreadPool.hpp"
 #include "XMLParser.hpp"
 #include <argp.h>
 #include <chrono>
@@ -10,6 +11,22 @@
 
 struct argp argpParser;
 
+// keys for options that only have a long name
+enum LongOption
+{
+    OPTION_SAH_TRAVERSAL_COST = 256,
+    OPTION_SAH_INTERSECTION_COST,
+    OPTION_REFIT_THRESHOLD,
+    OPTION_SBVH_BUDGET,
+    OPTION_LBVH_CLUSTERS,
+    OPTION_AUTO_TRIAL_RAYS,
+    OPTION_CACHE_DIRECTORY,
+    OPTION_BVH_NODE_BITS,
+    OPTION_BVH_WIDTH,
+    OPTION_ACCEL_STATS,
+    OPTION_REPORT
+};
+
 error_t
 parserFunction(int key, char* arg, argp_state* state)
 {
@@ -24,9 +41,21 @@ parserFunction(int key, char* arg, argp_state* state)
             else if (strcmp(arg, "bvh") == 0)
                 Options::accelerationStructure =
                   Options::AccelerationStructureEnum::BoundingVolumeHierarchy;
+            else if (strcmp(arg, "bvh-sah") == 0)
+                Options::accelerationStructure =
+                  Options::AccelerationStructureEnum::BoundingVolumeHierarchySAH;
+            else if (strcmp(arg, "sbvh") == 0)
+                Options::accelerationStructure =
+                  Options::AccelerationStructureEnum::SpatialSplitBVH;
+            else if (strcmp(arg, "lbvh") == 0)
+                Options::accelerationStructure =
+                  Options::AccelerationStructureEnum::LinearBVH;
             else if (strcmp(arg, "kd") == 0)
                 Options::accelerationStructure =
                   Options::AccelerationStructureEnum::KDTree;
+            else if (strcmp(arg, "auto") == 0)
+                Options::accelerationStructure =
+                  Options::AccelerationStructureEnum::Auto;
             else {
                 std::cout << "Unknown accelerator type \"" << arg << '"'
                           << std::endl;
@@ -36,9 +65,66 @@ parserFunction(int key, char* arg, argp_state* state)
         case 'd':
             Options::minDigits = std::stoi(arg);
             break;
+        case 'j':
+            Options::threadCount = std::stoi(arg);
+            break;
         case 'o':
             Options::outputPrefix = arg;
             break;
+        case OPTION_SAH_TRAVERSAL_COST:
+            Options::sahTraversalCost = std::stod(arg);
+            break;
+        case OPTION_SAH_INTERSECTION_COST:
+            Options::sahIntersectionCost = std::stod(arg);
+            break;
+        case OPTION_CACHE_DIRECTORY:
+            Options::cacheDirectory = arg;
+            break;
+        case OPTION_SBVH_BUDGET:
+            Options::sbvhDuplicationBudget = std::stod(arg);
+            break;
+        case OPTION_LBVH_CLUSTERS:
+            Options::lbvhClusterCount = std::stoi(arg);
+            break;
+        case OPTION_AUTO_TRIAL_RAYS:
+            Options::autoTrialRayCount = std::stoi(arg);
+            break;
+        case OPTION_BVH_NODE_BITS:
+            Options::bvhNodeBits = std::stoi(arg);
+            if (Options::bvhNodeBits != 8 && Options::bvhNodeBits != 16 &&
+                Options::bvhNodeBits != 32) {
+                std::cout << "BVH node bits should be 8, 16 or 32"
+                          << std::endl;
+                exit(1);
+            }
+            break;
+        case OPTION_BVH_WIDTH:
+            Options::bvhWidth = std::stoi(arg);
+            if (Options::bvhWidth != 2 && Options::bvhWidth != 4 &&
+                Options::bvhWidth != 8) {
+                std::cout << "BVH width should be 2, 4 or 8" << std::endl;
+                exit(1);
+            }
+            break;
+        case OPTION_ACCEL_STATS:
+            if (!arg || strcmp(arg, "text") == 0)
+                Options::accelerationStructureStats =
+                  Options::StatsFormat::Text;
+            else if (strcmp(arg, "json") == 0)
+                Options::accelerationStructureStats =
+                  Options::StatsFormat::Json;
+            else {
+                std::cout << "Unknown statistics format \"" << arg << '"'
+                          << std::endl;
+                exit(1);
+            }
+            break;
+        case OPTION_REFIT_THRESHOLD:
+            Options::refitThreshold = std::stod(arg);
+            break;
+        case OPTION_REPORT:
+            Options::reportFileName = arg;
+            break;
         case ARGP_KEY_ARG:
             // argument for scene file name
             Options::sceneFileName = arg;
@@ -74,7 +160,11 @@ parseArguments(int argc, char* argv[])
           0,
           "Acceleration structure to use with triangle meshes. Possible values "
           "are bf (brute force), bb (bounding box), bvh (bounding volume "
-          "hierarchy), kd(k-d tree). Default is bvh." },
+          "hierarchy), bvh-sah (bounding volume hierarchy built with the "
+          "surface area heuristic), sbvh (bvh-sah with spatial splits), lbvh "
+          "(linear bounding volume hierarchy, sorted by Morton codes), kd(k-d "
+          "tree), auto (bf, bb, bvh-sah or kd for each mesh, depending on its "
+          "triangles, bf and bb only for instanced meshes). Default is bvh." },
         { "digits",
           'd',
           "number",
@@ -83,23 +173,146 @@ parseArguments(int argc, char* argv[])
           "until there is no scene file with the name. This option sets the "
           "minimum number of digits to use. Current number will be padded with "
           "0's to match the given number of digits. Default is 0." },
+        { "threads",
+          'j',
+          "count",
+          0,
+          "Number of threads to use for building acceleration structures and "
+          "rendering. Default is 0, which uses all cores." },
         { "outdir",
           'o',
           "prefix",
           0,
           "Prefix to add to camera output file names. If this is a directory, "
           "it should end with a '/' character and the directory must exist." },
+        { "sah-traversal-cost",
+          OPTION_SAH_TRAVERSAL_COST,
+          "cost",
+          0,
+          "Cost of traversing an interior node, relative to the intersection "
+          "cost. Used by bvh-sah. Default is 1." },
+        { "sah-intersection-cost",
+          OPTION_SAH_INTERSECTION_COST,
+          "cost",
+          0,
+          "Cost of a ray-triangle intersection test, relative to the "
+          "traversal cost. Used by bvh-sah. Default is 1." },
+        { "sbvh-budget",
+          OPTION_SBVH_BUDGET,
+          "ratio",
+          0,
+          "Maximum number of duplicate triangle references created by spatial "
+          "splits, as a ratio of the triangle count. Used by sbvh. Default is "
+          "0.3." },
+        { "lbvh-clusters",
+          OPTION_LBVH_CLUSTERS,
+          "count",
+          0,
+          "Number of subtrees at the top of an lbvh that are joined by "
+          "agglomerative clustering, which makes a better tree than the "
+          "Morton order alone. 0 disables clustering. Default is 64." },
+        { "auto-trial-rays",
+          OPTION_AUTO_TRIAL_RAYS,
+          "count",
+          0,
+          "Used by auto. Meshes that could use either a BVH or a k-d tree are "
+          "built with both, and the one that traces this many random rays "
+          "faster is kept. 0 chooses from the size of the triangles instead. "
+          "Default is 0." },
+        { "bvh-node-bits",
+          OPTION_BVH_NODE_BITS,
+          "bits",
+          0,
+          "Bits per coordinate of the bounding boxes of BVH nodes. 32 stores "
+          "floats. 16 or 8 store each box relative to its parent's box, "
+          "using less memory for slightly looser boxes. Used by bvh, "
+          "bvh-sah, sbvh and lbvh. Default is 32." },
+        { "bvh-width",
+          OPTION_BVH_WIDTH,
+          "children",
+          0,
+          "Children per BVH node. 4 or 8 collapse the binary tree into wider "
+          "nodes, whose children's boxes are tested together with SIMD "
+          "instructions. Wide nodes are always stored with 32 bits per "
+          "coordinate. Used by bvh, bvh-sah, sbvh and lbvh. Default is 2." },
+        { "cache-dir",
+          OPTION_CACHE_DIRECTORY,
+          "directory",
+          0,
+          "Directory to save built BVH's of meshes in. Later runs with the "
+          "same meshes and settings map them from there instead of building "
+          "them. Created if it doesn't exist. Caching is disabled by "
+          "default." },
+        { "refit-threshold",
+          OPTION_REFIT_THRESHOLD,
+          "ratio",
+          0,
+          "Used with a % in the file name. If only the vertices of a mesh "
+          "changed since the previous scene, its BVH is refit instead of "
+          "being built again, unless this makes the BVH's cost grow by more "
+          "than the given ratio. 0 disables refitting. Default is 1.5." },
+        { "accel-stats",
+          OPTION_ACCEL_STATS,
+          "format",
+          OPTION_ARG_OPTIONAL,
+          "Print node and leaf counts, depths, a histogram of leaf sizes, the "
+          "SAH cost, memory usage and build time of the acceleration "
+          "structure of each mesh. Format is text (default) or json, which "
+          "prints one JSON object per scene on a single line." },
+        { "report",
+          OPTION_REPORT,
+          "file",
+          0,
+          "Write parse, build, trace and PNG encoding times, ray counts, rays "
+          "per second and the peak memory usage of each scene and camera to "
+          "the given JSON file." },
         0
     };
     argpParser = { options, parserFunction, "SCENE-FILE", 0, 0, 0 };
     argp_parse(&argpParser, argc, argv, 0, 0, 0);
+
+    if (Options::bvhWidth != AccelerationStructures::BVH_DEFAULT_WIDTH &&
+        Options::bvhNodeBits != AccelerationStructures::BVH_FULL_NODE_BITS) {
+        std::cout << "Wide BVH nodes can't be quantized, --bvh-node-bits "
+                     "should be 32 with --bvh-width 4 or 8"
+                  << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * @brief Adds the timings of a parsed scene and its rendered cameras to the
+ * report
+ *
+ * @param report
+ * @param fileName
+ * @param parser Parser that read the scene
+ * @param tracer Tracer that rendered it
+ */
+void
+addToReport(PathTracer::RenderReport& report,
+            const std::string& fileName,
+            const Parser::XMLParser& parser,
+            const PathTracer::PathTracer& tracer)
+{
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    report.addScene(fileName,
+                    Milliseconds(parser.getParseTime()).count(),
+                    Milliseconds(parser.getBuildTime() +
+                                 tracer.getHierarchyBuildTime())
+                      .count());
+    for (auto& record : tracer.getCameraRecords())
+        report.addCamera(record);
 }
 
 int
 main(int argc, char* argv[])
 {
     parseArguments(argc, argv);
+    AccelerationStructures::ThreadPool::defaultThreadCount =
+      Options::threadCount;
 
+    PathTracer::RenderReport report;
     auto indexPosition = Options::sceneFileName.find_first_of('%');
     if (indexPosition == std::string::npos) {
         Parser::XMLParser parser;
@@ -113,12 +326,17 @@ main(int argc, char* argv[])
         auto scene = parser.getScene();
         PathTracer::PathTracer tracer;
         tracer.trace(scene);
+        addToReport(report, Options::sceneFileName, parser, tracer);
     } else {
         auto startTime = std::chrono::system_clock::now();
 
         auto fileNameBeginning =
           Options::sceneFileName.substr(0, indexPosition);
         auto fileNameEnd = Options::sceneFileName.substr(indexPosition + 1);
+
+        // acceleration structures of the previous scene are refit for the
+        // next one if possible
+        std::shared_ptr<Objects::Scene> previousScene;
         for (int i = 0;; i++) {
             char fileName[256];
 
@@ -134,6 +352,8 @@ main(int argc, char* argv[])
                      fileNameEnd.c_str());
 
             Parser::XMLParser parser;
+            if (Options::refitThreshold > 0)
+                parser.setPreviousScene(std::move(previousScene));
             bool success = parser.parse(fileName);
             if (!success) {
                 std::cout << "Terminating loop at index " << i << std::endl;
@@ -143,6 +363,8 @@ main(int argc, char* argv[])
             auto scene = parser.getScene();
             PathTracer::PathTracer tracer;
             tracer.trace(scene);
+            addToReport(report, fileName, parser, tracer);
+            previousScene = scene;
         }
 
         auto endTime = std::chrono::system_clock::now();
@@ -153,5 +375,12 @@ main(int argc, char* argv[])
                   << std::endl;
     }
 
+    if (!Options::reportFileName.empty() &&
+        !report.write(Options::reportFileName)) {
+        std::cout << "Could not write report \"" << Options::reportFileName
+                  << '"' << std::endl;
+        exit(1);
+    }
+
     return 0;
 }
\ No newline at end of file